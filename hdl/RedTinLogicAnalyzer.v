@@ -44,8 +44,14 @@ module RedTinLogicAnalyzer(
 	
 	reconfig_din, reconfig_ce,
 	
-	done, reset,
-	read_addr, read_data
+	done, reset, rearm,
+	read_addr, read_data, read_count,
+	
+	trigger_out, trigger_in,
+	
+	rle, changed_out, changed_in,
+	
+	segments, read_stamp
     );
 	
 	///////////////////////////////////////////////////////////////////////////////////////////////
@@ -67,10 +73,40 @@ module RedTinLogicAnalyzer(
 
 	input wire[8:0] read_addr;
 	output reg[DATA_WIDTH-1:0] read_data = 0;
+	
+	//Number of clocks the sample at read_addr lasted (always 1 without run-length encoding)
+	output reg[15:0] read_count = 0;
 
 	input wire reset;
 	output wire done;
 	
+	//Start a new capture with the trigger configuration that's already loaded
+	input wire rearm;
+	
+	//Cross triggering: trigger_out is true when this core's trigger conditions are met, and the capture
+	//starts when trigger_in is true. With several cores, AND all of the trigger_out signals together and
+	//feed that to every core's trigger_in so they all start on the same clock.
+	//A single core should have trigger_in connected straight to trigger_out.
+	output wire trigger_out;
+	input wire trigger_in;
+	
+	//Run-length encoding: when rle is true a new sample is only stored when changed_in is true, and
+	//read_count says how long each one lasted. changed_out is true when din differs from the last clock.
+	//With several cores, OR all of the changed_out signals together and feed that to every core's
+	//changed_in so they store the same samples.
+	//A single core should have changed_in connected straight to changed_out.
+	input wire rle;
+	output wire changed_out;
+	input wire changed_in;
+	
+	//Segmented capture: the buffer is split into 2^segments equal segments (up to 16), each with its own
+	//16 pre-trigger samples. When one segment fills the core re-arms itself on the next, and is done once
+	//the last one is full. Segments are read back in order, segment N starting at read address
+	//N * (512 >> segments). read_stamp is the clock (counted from reset or re-arm) at which the segment
+	//containing read_addr triggered.
+	input wire[2:0] segments;
+	output reg[31:0] read_stamp = 0;
+	
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	// Trigger logic
 	
@@ -206,7 +242,10 @@ module RedTinLogicAnalyzer(
 	end
 	
 	//Trigger if all channels' conditions were met and we're fully configured
-	assign trigger = (trigger_raw == 64'hFFFFFFFFFFFFFFFF) && config_done;
+	assign trigger_out = (trigger_raw == 64'hFFFFFFFFFFFFFFFF) && config_done;
+	assign trigger = trigger_in;
+	
+	assign changed_out = (din != din_buf);
 	
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	// Capture logic
@@ -231,75 +270,140 @@ module RedTinLogicAnalyzer(
 	reg[8:0] capture_end =   9'h1FF;
 	reg[8:0] capture_waddr = 9'h010;
 	
+	//With several segments each one is its own ring buffer, so the pointers above only count within the
+	//current segment and are masked down to its size.
+	reg[3:0] segment = 0;
+	wire[8:0] seg_mask = 9'h1FF >> segments;
+	wire[8:0] seg_base = {5'h0, segment} << (4'd9 - segments);
+	wire[3:0] last_segment = 4'hF >> (3'd4 - segments);
+	wire[8:0] write_addr = seg_base | (capture_waddr & seg_mask);
+	wire at_end = ((capture_waddr ^ capture_end) & seg_mask) == 0;
+	
+	//Where each segment started and when it triggered
+	reg[8:0] seg_start[15:0];
+	reg[31:0] seg_stamp[15:0];
+	reg[31:0] clock_count = 0;
+	
 	//We're actually reading offsets in the circular buffer, not raw memory addresses.
 	//Keep that in mind!
+	wire[3:0] read_segment = read_addr >> (4'd9 - segments);
 	wire[8:0] real_read_addr;
-	assign real_read_addr = read_addr + capture_start;
+	assign real_read_addr = (read_addr & ~seg_mask) | ((read_addr + seg_start[read_segment]) & seg_mask);
 	
 	reg[1:0] state = 2'b11;	//00 = idle
 									//01 = capturing
 									//10 = done, wait for reset
 									//11 = uninitialized, wait for reset
+									//Reset and rearm restart the capture from any state
 	assign done = (state == 2'b10);
 	
+	//Run-length encoding. Each entry of count_buf is the number of clocks the sample in the same place in
+	//capture_buf lasted. A new sample is stored when the inputs change or the count would overflow; until
+	//then the newest sample (the one before capture_waddr) just gets longer.
+	reg[15:0] count_buf[511:0];
+	reg[15:0] run_count = 16'hFFFF;
+	wire store = !rle || changed_in || (run_count == 16'hFFFF);
+	wire[8:0] run_addr = capture_waddr - 9'h001;
+	wire[8:0] run_write_addr = seg_base | (run_addr & seg_mask);
+	
+	//The segment is full and the last sample just ended
+	wire full = rle && store && (state == 2'b01) && (((run_addr ^ capture_end) & seg_mask) == 0);
+	
+	//The segment is full, so move to the next one or stop
+	wire seg_done = (state == 2'b01) && (rle ? full : at_end);
+	
 	always @(posedge clk) begin
 		
 		//If in idle or capture state, write to the buffer
-		if(!state[1])
-			capture_buf[capture_waddr] <= din;
+		if(!state[1] && !full) begin
+			if(store) begin
+				capture_buf[write_addr] <= din;
+				count_buf[write_addr] <= 16'h0001;
+			end
+			else
+				count_buf[run_write_addr] <= run_count + 16'h0001;
+		end
+		
+		clock_count <= clock_count + 32'h1;
 		
-		case(state)
+		//Restart whatever we're doing, so several cores can be started in lockstep.
+		//The first clock always stores a sample.
+		if(reset || rearm) begin
+			state <= 2'b00;
+			run_count <= 16'hFFFF;
+			segment <= 0;
+			clock_count <= 0;
+			
+			capture_start <= 9'h000;
+			capture_end <= 9'h1FF;
+			capture_waddr <= 9'h010;
+		end
+		
+		//End of a segment. Remember where it started, then either start over in the next one
+		//(which always stores a sample on its first clock, like a re-arm) or stop.
+		else if(seg_done) begin
+			seg_start[segment] <= capture_start & seg_mask;
+			if(segment == last_segment)
+				state <= 2'b10;
+			else begin
+				state <= 2'b00;
+				run_count <= 16'hFFFF;
+				segment <= segment + 4'h1;
+				
+				capture_start <= 9'h000;
+				capture_end <= 9'h1FF;
+				capture_waddr <= 9'h010;
+			end
+		end
+		
+		else case(state)
 			
 			//Idle - capture data anyway so we can grab stuff before the trigger event
 			//and then bump pointers
 			2'b00: begin
 				
+				run_count <= store ? 16'h0001 : (run_count + 16'h0001);
+				
 				//If triggering, go on (but don't move window)
-				if(trigger)
+				if(trigger) begin
 					state <= 2'b01;
+					seg_stamp[segment] <= clock_count;
+				end
 					
 				//otherwise move the window
-				else begin
+				else if(store) begin
 					capture_start <= capture_start + 9'h001;
 					capture_end <= capture_end + 9'h001;
 				end
 				
-				//In any case move our write address
-				capture_waddr <= capture_waddr + 9'h001;
+				//Move our write address if we stored a sample
+				if(store)
+					capture_waddr <= capture_waddr + 9'h001;
 				
 			end
 			
-			//Capturing - bump write pointer and stop if we're at the end, otherwise keep going
+			//Capturing - bump write pointer and stop if we're at the end, otherwise keep going.
+			//With run-length encoding the last sample keeps getting longer until the next change.
 			2'b01: begin
-				if(capture_waddr == capture_end)
-					state <= 2'b10;
-				else
+				if(!rle)
 					capture_waddr <= capture_waddr + 9'h001;
+				
+				else begin
+					run_count <= store ? 16'h0001 : (run_count + 16'h0001);
+					if(store)
+						capture_waddr <= capture_waddr + 9'h001;
+				end
 			end
 			
 			//Read stuff and wait for reset
 			2'b10: begin
 				read_data <= capture_buf[real_read_addr];
-								
-				if(reset) begin
-					state <= 2'b00;
-					
-					capture_start <= 9'h000;
-					capture_end <= 9'h1FF;
-					capture_waddr <= 9'h010;
-					
-				end
+				read_count <= count_buf[real_read_addr];
+				read_stamp <= seg_stamp[read_segment];
 			end
 			
+			//Uninitialized, wait for reset
 			2'b11: begin
-				if(reset) begin
-					state <= 2'b00;
-					
-					capture_start <= 9'h000;
-					capture_end <= 9'h1FF;
-					capture_waddr <= 9'h010;
-					
-				end
 			end
 			
 		endcase
@@ -42,38 +42,82 @@ module RedTinUARTWrapper(clk, din, uart_tx, uart_rx);
 	////////////////////////////////////////////////////////////////////////////////////////////////
 	// IO declarations
 	
+	//Number of 128-channel capture cores (1 to 8). Core N captures din[128*N + 127 : 128*N].
+	parameter NUM_CORES = 1;
+	localparam DATA_WIDTH = 128 * NUM_CORES;
+	
 	input wire clk;
-	input wire[127:0] din;
+	input wire[DATA_WIDTH-1:0] din;
 	
 	output wire uart_tx;
 	input wire uart_rx;
 	
 	////////////////////////////////////////////////////////////////////////////////////////////////
 	// The actual LA
-	wire capture_done;
+	wire[NUM_CORES-1:0] core_done;
+	wire capture_done = &core_done;
 	reg la_reset = 0;
+	reg la_rearm = 0;
 	reg[8:0] read_addr = 0;
-	wire[127:0] read_data;
+	wire[DATA_WIDTH-1:0] read_data;
 	
 	reg[7:0] reconfig_din = 0;
 	reg reconfig_ce = 0;
 	
-	RedTinLogicAnalyzer capture (
-		.clk(clk), 
-		.din(din), 
-		.reconfig_din(reconfig_din), 
-		.reconfig_ce(reconfig_ce), 
-		.done(capture_done), 
-		.reset(la_reset), 
-		.read_addr(read_addr), 
-		.read_data(read_data)//,
-		//.leds(leds)
-		);
+	//Core being loaded with a trigger configuration
+	reg[2:0] load_core = 0;
+	
+	//Cross trigger: every core starts capturing once all of their trigger conditions are met.
+	//With several cores nothing triggers between loads, while some cores still have the old trigger.
+	reg armed = 0;
+	wire[NUM_CORES-1:0] core_trigger;
+	wire trigger = (&core_trigger) && armed;
+	
+	//Run-length encoding: every core stores a sample when any of them sees a change, so the counts match
+	reg rle = 0;
+	wire[NUM_CORES-1:0] core_changed;
+	wire changed = |core_changed;
+	wire[16*NUM_CORES-1:0] read_count;
+	
+	//Segmented capture: log2 of the number of segments. The cores run in lockstep, so their segment
+	//timestamps are all the same and only core 0's are sent.
+	reg[2:0] segments = 0;
+	wire[32*NUM_CORES-1:0] read_stamp;
+	
+	genvar ncore;
+	generate
+		for(ncore=0; ncore<NUM_CORES; ncore = ncore + 1) begin: cores
+		
+			RedTinLogicAnalyzer capture (
+				.clk(clk), 
+				.din(din[ncore*128 +: 128]), 
+				.reconfig_din(reconfig_din), 
+				.reconfig_ce(reconfig_ce && (load_core == ncore)), 
+				.done(core_done[ncore]), 
+				.reset(la_reset && (load_core == ncore)), 
+				.rearm(la_rearm), 
+				.read_addr(read_addr), 
+				.read_data(read_data[ncore*128 +: 128]),
+				.read_count(read_count[ncore*16 +: 16]),
+				.trigger_out(core_trigger[ncore]),
+				.trigger_in(trigger),
+				.rle(rle),
+				.changed_out(core_changed[ncore]),
+				.changed_in(changed),
+				.segments(segments),
+				.read_stamp(read_stamp[ncore*32 +: 32])
+				);
+				
+		end
+	endgenerate
 	
 	////////////////////////////////////////////////////////////////////////////////////////////////
 	// UART 
 	
-	reg[15:0] uart_clkdiv = 16'd694;		//115.2 kbaud @ 80 MHz
+	//Clock divider for the UART. The default is 115.2 kbaud @ 80 MHz.
+	//Faster links should use framed readback so corrupted data can be retransmitted.
+	parameter UART_CLKDIV = 16'd694;
+	reg[15:0] uart_clkdiv = UART_CLKDIV;
 	
 	reg[7:0] uart_txdata = 8'hEE;
 	reg uart_txen = 0;
@@ -102,24 +146,107 @@ module RedTinUARTWrapper(clk, din, uart_tx, uart_rx);
 	/*
 		New packet structure:
 		Magic number: 4 bytes, 0xFEEDFACE
-		One dummy byte, 0x00
-		256 bytes of data
+		One opcode byte
+			0x00 = load trigger into the selected core: 256 bytes of data follow.
+			       Restarts that core; with several cores send a re-arm afterwards to start them all together.
+			0x01 = re-arm all cores with the trigger that's already loaded, no data
+			0x02, 0x03 = same as 0x00 and 0x01 but with framed readback (see below)
+			0x08 to 0x0B = same as 0x00 to 0x03 but with run-length encoding
+			0x10 to 0x1B = same as 0x00 to 0x0B but segmented: one byte follows before any trigger data,
+			       log2 of the number of segments (0 to 4). The other opcodes turn segmenting off.
+			0x04 = read block: one byte follows, core number in the high 3 bits and block number in the low 5
+			0x05 = select core for loading: one byte of core number follows
+			0x06 = identify: replies 0x5A then the number of cores
+			0x07 = send the segment timestamps of a finished segmented capture again
 	 */
 	
 	reg loading = 0;
+	reg reading_block_num = 0;
+	reg reading_core_num = 0;
+	reg reading_segments = 0;
+	
+	//Load or re-arm opcode, acted on once the segment count (if any) has arrived
+	reg[7:0] start_op = 0;
+	reg start_pending = 0;
 	reg[31:0] magic = 0;
 	reg[7:0] count = 0;
 	
+	//Framed readback: only the sync byte is sent when the capture is done, then the host requests blocks
+	reg framed = 0;
+	
+	//Block requested by the host. One request can be pending while another block is being sent.
+	reg block_req = 0;
+	reg block_ack = 0;
+	reg[7:0] block_req_num = 0;
+	
+	//Identify request
+	reg ident_req = 0;
+	reg ident_ack = 0;
+	
+	//Segment timestamp request
+	reg stamp_req = 0;
+	reg stamp_ack = 0;
+	
 	always @(posedge clk) begin
 	
 		la_reset <= 0;
+		la_rearm <= 0;
 		reconfig_ce <= 0;
 		reconfig_din <= 0;
+		
+		if(block_ack)
+			block_req <= 0;
+		if(ident_ack)
+			ident_req <= 0;
+		if(stamp_ack)
+			stamp_req <= 0;
+		
+		//Starting a new capture, forget any old requests
+		if(start_pending) begin
+			start_pending <= 0;
+			framed <= start_op[1];
+			rle <= start_op[3];
+			block_req <= 0;
+			stamp_req <= 0;
+		
+			//Re-arm, nothing else to read
+			if(start_op[0]) begin
+				la_rearm <= 1;
+				armed <= 1;
+			end
+			
+			//Load trigger, next clock data starts arriving
+			else begin
+				loading <= 1;
+				la_reset <= 1;
+				armed <= (NUM_CORES == 1);
+			end
+		end
 	
 		if(uart_rxrdy) begin
+			
+			//Block number for a read
+			if(reading_block_num) begin
+				reading_block_num <= 0;
+				block_req <= 1;
+				block_req_num <= uart_rxout;
+			end
+			
+			//Core to load
+			else if(reading_core_num) begin
+				reading_core_num <= 0;
+				load_core <= uart_rxout[2:0];
+			end
+			
+			//Segment count, then the load or re-arm can go ahead
+			else if(reading_segments) begin
+				reading_segments <= 0;
+				segments <= (uart_rxout[2:0] > 3'd4) ? 3'd4 : uart_rxout[2:0];
+				start_pending <= 1;
+			end
 					
 			//Actual loading of data
-			if(loading) begin
+			else if(loading) begin
 				reconfig_ce <= 1;
 				reconfig_din <= uart_rxout;
 				count <= count + 8'h1;
@@ -131,13 +258,37 @@ module RedTinUARTWrapper(clk, din, uart_tx, uart_rx);
 			//Wait for the magic number
 			else begin
 				
-				//Magic number just arrived, we're reading the dummy byte now
-				//Next clock data starts arriving
+				//Magic number just arrived, we're reading the opcode now
 				if(magic == 32'hfeedface) begin
-					loading <= 1;
-					la_reset <= 1;
 					magic <= 0;
 					count <= 0;
+					
+					//Block read, block number is next
+					if(uart_rxout == 8'h04)
+						reading_block_num <= 1;
+					
+					//Core select, core number is next
+					else if(uart_rxout == 8'h05)
+						reading_core_num <= 1;
+					
+					//Identify
+					else if(uart_rxout == 8'h06)
+						ident_req <= 1;
+					
+					//Segment timestamps again
+					else if(uart_rxout == 8'h07)
+						stamp_req <= 1;
+					
+					//Load or re-arm, segmented ones wait for the segment count
+					else begin
+						start_op <= uart_rxout;
+						if(uart_rxout[4])
+							reading_segments <= 1;
+						else begin
+							segments <= 0;
+							start_pending <= 1;
+						end
+					end
 				end
 			
 				//Read the next bytes of the magic number
@@ -152,85 +303,248 @@ module RedTinUARTWrapper(clk, din, uart_tx, uart_rx);
 	////////////////////////////////////////////////////////////////////////////////////////////////
 	// Transmit logic
 	
+	/*
+		When a capture completes a 0x55 sync byte is sent.
+		
+		In unframed mode the whole buffer follows, 512 samples of 16 bytes per core each, MSB (of the
+		highest core) first.
+		
+		In framed mode nothing more is sent until the host asks for a block of 16 samples from one core.
+		The reply is
+			0xAA
+			Core and block number, as in the request
+			256 bytes of sample data from that core, MSB first
+			CRC-32 (as in zlib) of the core/block number and data, LSB first
+		
+		With run-length encoding every sample (each row when dumping, each sample of a block) starts with
+		the 16-bit count of clocks it lasted, MSB first. The counts are the same in every core.
+		
+		A segmented capture sends its segment timestamps right after the sync byte, before any samples:
+			0xA5
+			32-bit trigger clock of each segment, MSB first, first segment first
+			CRC-32 of the timestamps, LSB first
+		The same packet is sent again whenever the host asks for it.
+	 */
+	
+	//CRC-32 of one more byte, reflected polynomial 0xEDB88320
+	function [31:0] crc32_byte;
+		input[31:0] crc;
+		input[7:0] data;
+		integer i;
+		reg[31:0] c;
+		begin
+			c = crc ^ {24'h0, data};
+			for(i=0; i<8; i=i+1)
+				c = c[0] ? ((c >> 1) ^ 32'hEDB88320) : (c >> 1);
+			crc32_byte = c;
+		end
+	endfunction
+	
 	reg done_buf = 0;
-	reg[3:0] bpos = 0;
+	reg[7:0] bpos = 0;
+	
+	reg sending_sync_header = 0;
+	reg dumping = 0;
+	
+	reg sending_ident = 0;
+	
+	reg sending_block = 0;
+	reg[8:0] block_pos = 0;
+	reg[7:0] block_num = 0;
+	reg[31:0] block_crc = 0;
+	wire[31:0] block_crc_out = ~block_crc;
+	wire[2:0] block_core = block_num[7:5];
+	
+	reg sending_stamps = 0;
+	reg[6:0] stamp_pos = 0;
+	reg[31:0] stamp_crc = 0;
+	wire[31:0] stamp_crc_out = ~stamp_crc;
+	wire[6:0] stamp_bytes = 7'd4 << segments;
+	wire[5:0] stamp_byte = stamp_pos - 7'd1;
+	wire[7:0] stamp_data = read_stamp[31 - stamp_byte[1:0]*8 -: 8];
+	wire[6:0] stamp_crc_pos = stamp_pos - stamp_bytes - 7'd1;
+
+	//Bytes per sample: one core when sending a block, all of them when dumping, plus the count
+	wire[7:0] row_len = (sending_block ? 8'd16 : NUM_CORES*16) + (rle ? 8'd2 : 8'd0);
+	wire[8:0] block_data_end = rle ? 9'd290 : 9'd258;
+	wire[8:0] block_crc_pos = block_pos - block_data_end;
+	wire[7:0] data_pos = rle ? (bpos - 8'd2) : bpos;
 
 	//Mux out the current byte from the output
 	reg[7:0] current_byte = 0;
-	always @(bpos, read_data) begin
-		case(bpos)
-			0: current_byte <= read_data[127:120];
-			1: current_byte <= read_data[119:112];
-			2: current_byte <= read_data[111:104];
-			3: current_byte <= read_data[103:96];
-			4: current_byte <= read_data[95:88];
-			5: current_byte <= read_data[87:80];
-			6: current_byte <= read_data[79:72];
-			7: current_byte <= read_data[71:64];
-			8: current_byte <= read_data[63:56];
-			9: current_byte <= read_data[55:48];
-			10: current_byte <= read_data[47:40];
-			11: current_byte <= read_data[39:32];
-			12: current_byte <= read_data[31:24];
-			13: current_byte <= read_data[23:16];
-			14: current_byte <= read_data[15:8];
-			15: current_byte <= read_data[7:0];
-		endcase
+	always @(bpos, data_pos, rle, read_data, read_count, sending_block, block_core) begin
+		if(rle && (bpos == 0))
+			current_byte <= read_count[15:8];
+		else if(rle && (bpos == 1))
+			current_byte <= read_count[7:0];
+		else if(sending_block)
+			current_byte <= read_data[block_core*128 + 127 - data_pos*8 -: 8];
+		else
+			current_byte <= read_data[DATA_WIDTH - 1 - data_pos*8 -: 8];
 	end
 
-	reg sending_sync_header = 0;
-
 	always @(posedge clk) begin
 		
 		done_buf <= capture_done;
 		uart_txen <= 0;
+		block_ack <= 0;
+		ident_ack <= 0;
+		stamp_ack <= 0;
 		
-		if(capture_done) begin
+		//Capture just finished! Start reading
+		if(capture_done && !done_buf) begin
+			read_addr <= 0;
+			bpos <= 0;
+			sending_sync_header <= 1;
+			sending_stamps <= (segments != 0);
+			stamp_pos <= 0;
+			dumping <= !framed;
+			sending_block <= 0;
+		end
 		
-			//Capture just finished! Start reading
-			if(!done_buf) begin
-				read_addr <= 0;
-				bpos <= 0;
-				sending_sync_header <= 1;
+		//If UART is busy, skip
+		else if(uart_txen || uart_txactive) begin
+			//nothing to do
+		end
+		
+		//Identify can be done at any time, except in the middle of a block
+		else if(ident_req && !ident_ack && !sending_block) begin
+			ident_ack <= 1;
+			uart_txen <= 1;
+			uart_txdata <= 8'h5A;
+			sending_ident <= 1;
+		end
+		else if(sending_ident) begin
+			uart_txen <= 1;
+			uart_txdata <= NUM_CORES;
+			sending_ident <= 0;
+		end
+		
+		//Everything else waits for the capture
+		else if(!capture_done) begin
+			//nothing to do
+		end
+
+		//Send sync header
+		else if(sending_sync_header) begin
+			uart_txen <= 1;
+			uart_txdata <= 8'h55;
+			sending_sync_header <= 0;
+		end			
+		
+		//Sending a block
+		else if(sending_block) begin
+			uart_txen <= 1;
+			block_pos <= block_pos + 9'h1;
+			
+			//Header
+			if(block_pos == 0) begin
+				uart_txdata <= 8'hAA;
+				block_crc <= 32'hFFFFFFFF;
+			end
+			else if(block_pos == 1) begin
+				uart_txdata <= block_num;
+				block_crc <= crc32_byte(block_crc, block_num);
 			end
 			
-			//If UART is busy, skip
-			else if(uart_txen || uart_txactive) begin
-				//nothing to do
+			//Data
+			else if(block_pos < block_data_end) begin
+				uart_txdata <= current_byte;
+				block_crc <= crc32_byte(block_crc, current_byte);
+				bpos <= bpos + 8'h1;
+				if(bpos == (row_len - 1)) begin
+					bpos <= 0;
+					read_addr <= read_addr + 9'h1;
+				end
 			end
-
-			//Send sync header
-			else if(sending_sync_header) begin
-				uart_txen <= 1;
-				uart_txdata <= 8'h55;
-				sending_sync_header <= 0;
-			end			
 			
-			//Dumping data
+			//Checksum
 			else begin
+				case(block_crc_pos)
+					0: uart_txdata <= block_crc_out[7:0];
+					1: uart_txdata <= block_crc_out[15:8];
+					2: uart_txdata <= block_crc_out[23:16];
+					3: begin
+						uart_txdata <= block_crc_out[31:24];
+						sending_block <= 0;
+					end
+				endcase
+			end
+		end
+		
+		//Sending segment timestamps. read_addr points into each segment in turn to get its timestamp.
+		else if(sending_stamps) begin
+			uart_txen <= 1;
+			stamp_pos <= stamp_pos + 7'h1;
 			
-				//Dump this byte out the UART
-				uart_txen <= 1;
-				uart_txdata <= current_byte;
-				bpos <= bpos + 4'h1;
-				
-				//If we're at the end of the byte, load the next word
-				if(bpos == 15) begin
-				
-					bpos <= 0;
-				
-					//but if we're at the end of the buffer, stop
-					if(read_addr == 511) begin
+			if(stamp_pos == 0) begin
+				uart_txdata <= 8'hA5;
+				stamp_crc <= 32'hFFFFFFFF;
+			end
+			
+			else if(stamp_pos <= stamp_bytes) begin
+				uart_txdata <= stamp_data;
+				stamp_crc <= crc32_byte(stamp_crc, stamp_data);
+				if(stamp_byte[1:0] == 2'h3)
+					read_addr <= ({5'h0, stamp_byte[5:2]} + 9'h1) << (4'd9 - segments);
+			end
+			
+			else begin
+				case(stamp_crc_pos)
+					0: uart_txdata <= stamp_crc_out[7:0];
+					1: uart_txdata <= stamp_crc_out[15:8];
+					2: uart_txdata <= stamp_crc_out[23:16];
+					3: begin
+						uart_txdata <= stamp_crc_out[31:24];
+						sending_stamps <= 0;
 						read_addr <= 0;
 					end
-					
-					else begin
-						read_addr <= read_addr + 9'h1;
-					end
-				end
-			
+				endcase
 			end
+		end
+		
+		//Send the segment timestamps again if the host asks
+		else if(stamp_req && !stamp_ack && !dumping && (segments != 0)) begin
+			stamp_ack <= 1;
+			sending_stamps <= 1;
+			stamp_pos <= 0;
+			read_addr <= 0;
+		end
+		
+		//Start on the next block the host asked for
+		else if(block_req && !block_ack && !dumping) begin
+			block_ack <= 1;
+			sending_block <= 1;
+			block_pos <= 0;
+			block_num <= block_req_num;
+			read_addr <= {block_req_num[4:0], 4'h0};
+			bpos <= 0;
+		end
+		
+		//Dumping data
+		else if(dumping) begin
+		
+			//Dump this byte out the UART
+			uart_txen <= 1;
+			uart_txdata <= current_byte;
+			bpos <= bpos + 8'h1;
+			
+			//If we're at the end of the row, load the next one
+			if(bpos == (row_len - 1)) begin
+			
+				bpos <= 0;
 			
+				//but if we're at the end of the buffer, stop
+				if(read_addr == 511) begin
+					read_addr <= 0;
+					dumping <= 0;
+				end
+				
+				else begin
+					read_addr <= read_addr + 9'h1;
+				end
+			end
+		
 		end
 	end
 
@@ -0,0 +1,701 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file main.cpp
+	@author Andrew D. Zonenberg
+	@brief Command line interface for scripting captures and working with the capture history
+ */
+
+#include "CaptureArchive.h"
+#include "CaptureClient.h"
+#include "CaptureExporter.h"
+#include "CaptureMeasurements.h"
+#include "CaptureOverlay.h"
+#include "CapturePlugins.h"
+#include "CaptureQuery.h"
+#include "CaptureStatistics.h"
+#include "RecordingTransport.h"
+#include "RedTinDevice.h"
+#include "RedTinModel.h"
+#include "ReplayTransport.h"
+#include "SignalConditioner.h"
+#include "UARTTransport.h"
+#include "VCDImporter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int ShowUsage();
+bool GetAllIDs(CaptureArchive& archive, vector<int>& ids);
+int DoCapture(CaptureArchive& archive, vector<string>& args);
+bool CompileConditioner(SignalConditioner& conditioner, const CaptureConfig& config, int width);
+bool StoreCapture(CaptureArchive& archive, Capture& cap, const CaptureConfig& config, const CapturePlugins& plugins,
+	const SignalConditioner& conditioner, CaptureMeasurements& measurements, int& failures);
+int DoList(CaptureArchive& archive, vector<string>& args);
+int DoExport(CaptureArchive& archive, vector<string>& args);
+int DoPrune(CaptureArchive& archive, vector<string>& args);
+int DoStats(CaptureArchive& archive, vector<string>& args);
+int DoMeasure(CaptureArchive& archive, vector<string>& args);
+int DoOverlay(CaptureArchive& archive, vector<string>& args);
+int DoSearch(CaptureArchive& archive, vector<string>& args);
+int DoImport(CaptureArchive& archive, vector<string>& args);
+
+int main(int argc, char* argv[])
+{
+	//Global options come before the command
+	string archivepath = CaptureArchive::GetDefaultPath();
+	int i = 1;
+	for(; i<argc; i++)
+	{
+		string s = argv[i];
+		if( (s == "--archive") && (i+1 < argc) )
+			archivepath = argv[++i];
+		else
+			break;
+	}
+	if(i >= argc)
+		return ShowUsage();
+	
+	string cmd = argv[i];
+	vector<string> args;
+	for(i++; i<argc; i++)
+		args.push_back(argv[i]);
+		
+	CaptureArchive archive(archivepath);
+	if(cmd == "capture")
+		return DoCapture(archive, args);
+	else if(cmd == "list")
+		return DoList(archive, args);
+	else if(cmd == "export")
+		return DoExport(archive, args);
+	else if(cmd == "prune")
+		return DoPrune(archive, args);
+	else if(cmd == "stats")
+		return DoStats(archive, args);
+	else if(cmd == "measure")
+		return DoMeasure(archive, args);
+	else if(cmd == "overlay")
+		return DoOverlay(archive, args);
+	else if(cmd == "search")
+		return DoSearch(archive, args);
+	else if(cmd == "import")
+		return DoImport(archive, args);
+	
+	printf("unrecognized command \"%s\"\n", cmd.c_str());
+	return ShowUsage();
+}
+
+/**
+	@brief Gets the ID of every capture in the archive, oldest first
+ */
+bool GetAllIDs(CaptureArchive& archive, vector<int>& ids)
+{
+	if(!archive.Refresh())
+		return false;
+	const vector<ArchiveEntry>& entries = archive.GetEntries();
+	for(size_t i=0; i<entries.size(); i++)
+		ids.push_back(entries[i].id);
+	return true;
+}
+
+int ShowUsage()
+{
+	printf(
+		"Usage: redtin-cli [--archive dir] command [args]\n"
+		"\n"
+		"Commands:\n"
+		"    capture <config> [--count N] [--device path] [--baud N] [--model cores]\n"
+		"            [--record file] [--replay file] [--realtime]\n"
+		"                                         Capture with a .scfg config and archive the results,\n"
+		"                                         through redtind if it's running. --model uses a\n"
+		"                                         software model of a board instead of a real one.\n"
+		"                                         --record saves the serial traffic, which --replay\n"
+		"                                         plays back as fast as possible or, with --realtime,\n"
+		"                                         at the original timing\n"
+		"    list                                 List archived captures\n"
+		"    export <id> <format> <file>          Write an archived capture to a file\n"
+		"    import <file.vcd>...                 Archive value change dumps from simulations or other\n"
+		"                                         tools so they can be searched and exported\n"
+		"    prune [--max-mb N] [--max-days N]    Delete archived captures over the given limits\n"
+		"    stats [--json] [id...]               Signal statistics summed over archived captures\n"
+		"                                         (all of them if no IDs are given)\n"
+		"    measure <config> [--json] [id...]    Delays between edges, from the measure lines of a\n"
+		"                                         config, over archived captures\n"
+		"    overlay [--columns N] [--mask] [id...]\n"
+		"                                         Heat map of how often each channel was high or toggled\n"
+		"                                         at each sample, or with --mask the bits that ever\n"
+		"                                         differed, over trigger-aligned archived captures\n"
+		"    search <query> [--captures] [id...]  Find samples matching a pattern, e.g.\n"
+		"                                         \"addr == 0x3c && !we_n && posedge clk\", or with\n"
+		"                                         --captures just the captures with matches\n"
+		);
+	return 1;
+}
+
+/**
+	@brief Captures with a signal configuration and stores the results in the archive
+	
+	Goes through redtind if it's running, so the capture waits its turn with everybody else's. Otherwise
+	the device is opened directly.
+ */
+int DoCapture(CaptureArchive& archive, vector<string>& args)
+{
+	if(args.empty())
+		return ShowUsage();
+	
+	int count = 1;
+	string devpath = UARTTransport::GetDefaultPath();
+	int baud = 0;
+	int modelcores = 0;
+	string recordpath;
+	string replaypath;
+	bool realtime = false;
+	for(size_t i=1; i<args.size(); i++)
+	{
+		if( (args[i] == "--count") && (i+1 < args.size()) )
+			count = atoi(args[++i].c_str());
+		else if( (args[i] == "--device") && (i+1 < args.size()) )
+			devpath = args[++i];
+		else if( (args[i] == "--baud") && (i+1 < args.size()) )
+			baud = atoi(args[++i].c_str());
+		else if( (args[i] == "--model") && (i+1 < args.size()) )
+			modelcores = atoi(args[++i].c_str());
+		else if( (args[i] == "--record") && (i+1 < args.size()) )
+			recordpath = args[++i];
+		else if( (args[i] == "--replay") && (i+1 < args.size()) )
+			replaypath = args[++i];
+		else if(args[i] == "--realtime")
+			realtime = true;
+		else
+			return ShowUsage();
+	}
+	
+	CaptureConfig config;
+	if(!config.Load(args[0]) || !config.CheckStateClock())
+		return 1;
+	if(baud == 0)
+		baud = atoi(config.GetParameter("UART_BAUD", "115200").c_str());
+	
+	//Plugins that fail a capture make the whole run fail, once every capture is done
+	CapturePlugins plugins;
+	if(!plugins.Load(config))
+		return 1;
+	int failures = 0;
+	
+	//Filters are checked against the widest board before capturing, then compiled again once the real
+	//width is known
+	SignalConditioner conditioner;
+	if(!CompileConditioner(conditioner, config, RedTinDevice::MAX_CORES * CORE_WIDTH))
+		return 1;
+	
+	//Measurements are summed over the whole run and shown at the end
+	CaptureMeasurements measurements;
+	measurements.SetMeasurements(config.measurements);
+	
+	//Checked up front so a bad count can't go to the server and come back as no results at all
+	if(!RedTinDevice::IsValidSegmentCount(config.GetSegmentCount()))
+	{
+		printf("segment count must be a power of two from 1 to %d\n", RedTinDevice::MAX_SEGMENTS);
+		return 1;
+	}
+	
+	CaptureClient client;
+	bool direct = (modelcores != 0) || !recordpath.empty() || !replaypath.empty();
+	if(!direct && client.Connect())
+	{
+		//One request, or a stream for as many as we want
+		bool sent = (count == 1) ? client.RequestCapture(config) : client.Subscribe(config);
+		if(!sent)
+		{
+			printf("capture failed: %s\n", client.GetError().c_str());
+			return 1;
+		}
+		
+		//Segmented captures come back one segment at a time
+		for(int i=0; i<count * config.GetSegmentCount(); i++)
+		{
+			CaptureResult result;
+			if(!client.WaitResult(result))
+			{
+				printf("capture failed: %s\n", client.GetError().c_str());
+				return 1;
+			}
+			Capture cap;
+			result.ToCapture(cap);
+			if( (i == 0) && !CompileConditioner(conditioner, config, cap.GetWidth()) )
+				return 1;
+			if(!StoreCapture(archive, cap, config, plugins, conditioner, measurements, failures))
+				return 1;
+		}
+		if(!config.measurements.empty())
+			printf("\n%s", measurements.FormatSummary().c_str());
+		return (failures == 0) ? 0 : 1;
+	}
+	
+	//No server, do it ourselves
+	UARTTransport uart;
+	RedTinModel model(modelcores);
+	ReplayTransport replay;
+	Transport* transport = &model;
+	if(!replaypath.empty())
+	{
+		if(!replay.Open(replaypath, realtime))
+			return 1;
+		transport = &replay;
+	}
+	else if(modelcores == 0)
+	{
+		if(!uart.Open(devpath, baud))
+			return 1;
+		transport = &uart;
+	}
+	
+	//Tap whatever we're talking to
+	RecordingTransport recorder(transport);
+	if(!recordpath.empty())
+	{
+		if(!recorder.Open(recordpath))
+			return 1;
+		transport = &recorder;
+	}
+	
+	RedTinDevice device(transport);
+	device.SetRunLengthEncoding(config.IsRunLengthEncoded());
+	if(!device.SetSegmentCount(config.GetSegmentCount()) || !device.Identify())
+		return 1;
+	
+	//Signals are laid out over however many channels the board has
+	vector<Signal> signals = config.signals;
+	vector<unsigned char> bitstream(device.GetCoreCount() * TRIGGER_BITSTREAM_SIZE);
+	if(!AssignSignalBits(signals, device.GetWidth()) ||
+		!CompileTriggers(signals, config.triggers, device.GetWidth(), &bitstream[0]) ||
+		!CompileConditioner(conditioner, config, device.GetWidth()))
+	{
+		return 1;
+	}
+	
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int i=0; i<count; i++)
+	{
+		vector<Capture> caps;
+		if(!device.RunCapture(&bitstream[0], caps))
+			return 1;
+		for(size_t j=0; j<caps.size(); j++)
+		{
+			caps[j].SetSampleRate(config.GetSampleRate());
+			caps[j].SetTimestamp(time(NULL));
+			if(!StoreCapture(archive, caps[j], config, plugins, conditioner, measurements, failures))
+				return 1;
+		}
+	}
+	
+	//Replays are for benchmarking, so say how long it took
+	if(!replaypath.empty())
+	{
+		timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("replayed %d captures in %.3f ms%s\n", count,
+			(end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0,
+			replay.HasDiverged() ? " (diverged from the recording)" : "");
+	}
+	if(!config.measurements.empty())
+		printf("\n%s", measurements.FormatSummary().c_str());
+	return (failures == 0) ? 0 : 1;
+}
+
+/**
+	@brief Compiles the config's filters for captures of a given width
+ */
+bool CompileConditioner(SignalConditioner& conditioner, const CaptureConfig& config, int width)
+{
+	vector<Signal> signals = config.signals;
+	if(!AssignSignalBits(signals, width))
+		return false;
+	if(!conditioner.Compile(config, signals, width))
+	{
+		printf("%s\n", conditioner.GetError().c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Cleans up a fresh capture with the config's filters, attaches the signals from the config, resamples
+	it on the state clock if there is one, and archives it. Then runs any plugins on it, counting the failures,
+	and adds it to the measurements.
+ */
+bool StoreCapture(CaptureArchive& archive, Capture& cap, const CaptureConfig& config, const CapturePlugins& plugins,
+	const SignalConditioner& conditioner, CaptureMeasurements& measurements, int& failures)
+{
+	vector<Signal> signals = config.signals;
+	AssignSignalBits(signals, cap.GetWidth());
+	
+	conditioner.Apply(cap);
+	
+	cap.SetSignals(signals);
+	
+	//Boil it down to a state listing if asked. SampleOnClock says why if it can't, and the whole capture is
+	//kept instead so the run carries on, hashed as the timing capture it is.
+	string clockname;
+	int edge;
+	bool resampled = config.GetStateClock(clockname, edge) && cap.SampleOnClock(clockname, edge);
+	cap.SetConfigHash(config.GetHash(resampled));
+	
+	int id = archive.Store(cap);
+	if(id < 0)
+		return false;
+	if(config.GetSegmentCount() > 1)
+		printf("stored capture %d (triggered at clock %llu)\n", id, static_cast<unsigned long long>(cap.GetTriggerClock()));
+	else
+		printf("stored capture %d\n", id);
+	
+	vector<PluginResult> results;
+	plugins.Analyze(cap, config, config.GetParameter("EXPORT_PATH", "/tmp/redtin_capture"), results);
+	printf("%s", CapturePlugins::FormatResults(cap, results).c_str());
+	for(size_t i=0; i<results.size(); i++)
+	{
+		if(results[i].verdict == REDTIN_VERDICT_FAIL)
+		{
+			failures ++;
+			break;
+		}
+	}
+	
+	measurements.Accumulate(cap);
+	return true;
+}
+
+/**
+	@brief Lists the capture history
+ */
+int DoList(CaptureArchive& archive, vector<string>& /*args*/)
+{
+	if(!archive.Refresh())
+		return 1;
+		
+	const vector<ArchiveEntry>& entries = archive.GetEntries();
+	printf("%6s  %-19s  %-16s  %10s  %5s  %6s  %8s\n", "id", "time", "config", "MHz", "width", "depth", "bytes");
+	for(size_t i=0; i<entries.size(); i++)
+	{
+		const ArchiveEntry& entry = entries[i];
+		struct tm split;
+		localtime_r(&entry.timestamp, &split);
+		printf("%6d  %4d-%02d-%02d %02d:%02d:%02d  %016llx  %10.3f  %5d  %6d  %8ld\n",
+			entry.id,
+			split.tm_year+1900, split.tm_mon+1, split.tm_mday,
+			split.tm_hour, split.tm_min, split.tm_sec,
+			static_cast<unsigned long long>(entry.confighash),
+			entry.samplerate,
+			entry.width,
+			entry.depth,
+			entry.filesize);
+	}
+	return 0;
+}
+
+/**
+	@brief Re-exports an archived capture
+ */
+int DoExport(CaptureArchive& archive, vector<string>& args)
+{
+	if(args.size() != 3)
+		return ShowUsage();
+	
+	CaptureExporter* exporter = CaptureExporter::CreateExporter(args[1]);
+	if(exporter == NULL)
+	{
+		printf("unrecognized export format \"%s\"\n", args[1].c_str());
+		return 1;
+	}
+	
+	Capture cap;
+	bool ok = archive.Load(atoi(args[0].c_str()), cap) && exporter->Export(cap, args[2]);
+	delete exporter;
+	return ok ? 0 : 1;
+}
+
+/**
+	@brief Overlays archived captures
+ */
+int DoOverlay(CaptureArchive& archive, vector<string>& args)
+{
+	int columns = 0;
+	bool mask = false;
+	vector<int> ids;
+	for(size_t i=0; i<args.size(); i++)
+	{
+		if( (args[i] == "--columns") && (i+1 < args.size()) )
+			columns = atoi(args[++i].c_str());
+		else if(args[i] == "--mask")
+			mask = true;
+		else
+			ids.push_back(atoi(args[i].c_str()));
+	}
+	
+	if(ids.empty() && !GetAllIDs(archive, ids))
+		return 1;
+	
+	CaptureOverlay overlay;
+	uint64_t hash = 0;
+	for(size_t i=0; i<ids.size(); i++)
+	{
+		Capture cap;
+		if(!archive.Load(ids[i], cap))
+			return 1;
+		
+		if( (i != 0) && (cap.GetConfigHash() != hash) )
+			printf("capture %d has a different configuration, overlay restarted\n", ids[i]);
+		hash = cap.GetConfigHash();
+		
+		overlay.Accumulate(cap);
+	}
+	
+	if(mask)
+		overlay.WriteDifferMask(stdout);
+	else
+		overlay.WriteHeatMap(stdout, columns);
+	return 0;
+}
+
+/**
+	@brief Reads VCD files into the archive
+ */
+int DoImport(CaptureArchive& archive, vector<string>& args)
+{
+	if(args.empty())
+		return ShowUsage();
+	
+	for(size_t i=0; i<args.size(); i++)
+	{
+		VCDImporter importer;
+		Capture cap;
+		if(!importer.Import(args[i], cap))
+			return 1;
+		
+		int id = archive.Store(cap);
+		if(id < 0)
+			return 1;
+		printf("stored capture %d (%zu signals, %d samples)\n", id, cap.GetSignals().size(), cap.GetDepth());
+	}
+	return 0;
+}
+
+/**
+	@brief Applies new size and age limits to the archive
+ */
+int DoPrune(CaptureArchive& archive, vector<string>& args)
+{
+	long maxbytes = archive.GetMaxBytes();
+	long maxage = archive.GetMaxAge();
+	for(size_t i=0; i<args.size(); i++)
+	{
+		if( (args[i] == "--max-mb") && (i+1 < args.size()) )
+			maxbytes = atol(args[++i].c_str()) * 1024 * 1024;
+		else if( (args[i] == "--max-days") && (i+1 < args.size()) )
+			maxage = atol(args[++i].c_str()) * 24 * 60 * 60;
+		else
+			return ShowUsage();
+	}
+	
+	archive.SetLimits(maxbytes, maxage);
+	return archive.Prune() ? 0 : 1;
+}
+
+/**
+	@brief Sums signal statistics over archived captures
+ */
+int DoStats(CaptureArchive& archive, vector<string>& args)
+{
+	bool json = false;
+	vector<int> ids;
+	for(size_t i=0; i<args.size(); i++)
+	{
+		if(args[i] == "--json")
+			json = true;
+		else
+			ids.push_back(atoi(args[i].c_str()));
+	}
+	
+	if(ids.empty() && !GetAllIDs(archive, ids))
+		return 1;
+	
+	CaptureStatistics stats;
+	uint64_t hash = 0;
+	for(size_t i=0; i<ids.size(); i++)
+	{
+		Capture cap;
+		if(!archive.Load(ids[i], cap))
+			return 1;
+		
+		//Statistics restart whenever the configuration changes, so warn if that happens
+		if( (i != 0) && (cap.GetConfigHash() != hash) )
+			printf("capture %d has a different configuration, statistics restarted\n", ids[i]);
+		hash = cap.GetConfigHash();
+		
+		stats.Accumulate(cap);
+	}
+	
+	if(json)
+		stats.WriteJSON(stdout);
+	else
+		printf("%s", stats.FormatSummary().c_str());
+	return 0;
+}
+
+/**
+	@brief Makes the measurements from a config on archived captures
+ */
+int DoMeasure(CaptureArchive& archive, vector<string>& args)
+{
+	if(args.empty())
+		return ShowUsage();
+	
+	bool json = false;
+	vector<int> ids;
+	for(size_t i=1; i<args.size(); i++)
+	{
+		if(args[i] == "--json")
+			json = true;
+		else
+			ids.push_back(atoi(args[i].c_str()));
+	}
+	
+	CaptureConfig config;
+	if(!config.Load(args[0]))
+		return 1;
+	if(config.measurements.empty())
+	{
+		printf("%s has no measurements\n", args[0].c_str());
+		return 1;
+	}
+	
+	if(ids.empty() && !GetAllIDs(archive, ids))
+		return 1;
+	
+	CaptureMeasurements measurements;
+	measurements.SetMeasurements(config.measurements);
+	uint64_t hash = 0;
+	bool ok = true;
+	for(size_t i=0; i<ids.size(); i++)
+	{
+		Capture cap;
+		if(!archive.Load(ids[i], cap))
+			return 1;
+		
+		if( (i != 0) && (cap.GetConfigHash() != hash) )
+			printf("capture %d has a different configuration, measurements restarted\n", ids[i]);
+		hash = cap.GetConfigHash();
+		
+		if(!measurements.Accumulate(cap))
+			ok = false;
+	}
+	
+	if(json)
+		measurements.WriteJSON(stdout);
+	else
+		printf("%s", measurements.FormatSummary().c_str());
+	return ok ? 0 : 1;
+}
+
+/**
+	@brief Searches archived captures for a pattern
+ */
+int DoSearch(CaptureArchive& archive, vector<string>& args)
+{
+	if(args.empty())
+		return ShowUsage();
+	string query = args[0];
+	
+	bool listonly = false;
+	vector<int> ids;
+	for(size_t i=1; i<args.size(); i++)
+	{
+		if(args[i] == "--captures")
+			listonly = true;
+		else
+			ids.push_back(atoi(args[i].c_str()));
+	}
+	if(ids.empty() && !GetAllIDs(archive, ids))
+		return 1;
+	if(ids.empty())
+		return 0;
+	
+	//Check the query once up front so typos get a useful message
+	CaptureSummary summary;
+	if(!archive.LoadSummary(ids[0], summary))
+		return 1;
+	CaptureQuery check;
+	if(!check.Compile(query, summary.signals, summary.width))
+	{
+		printf("%s\n", check.GetError().c_str());
+		return 1;
+	}
+	
+	vector<ArchiveSearchResult> results;
+	CaptureQuery::SearchArchive(query, archive, ids, results);
+	
+	long total = 0;
+	size_t nmatched = 0;
+	size_t nscanned = 0;
+	for(size_t i=0; i<results.size(); i++)
+	{
+		const ArchiveSearchResult& result = results[i];
+		if(result.scanned)
+			nscanned ++;
+		if(result.samples.empty())
+			continue;
+		nmatched ++;
+		total += result.samples.size();
+		
+		if(listonly)
+		{
+			printf("capture %d: %zu matches\n", result.id, result.samples.size());
+			continue;
+		}
+		double period = 1000.0 / result.samplerate;
+		for(size_t j=0; j<result.samples.size(); j++)
+			printf("capture %d: sample %d (%.3f ns)\n", result.id, result.samples[j], result.times[j] * period);
+	}
+	printf("%ld matches in %zu of %zu captures (%zu searched, the rest ruled out by their summaries)\n",
+		total, nmatched, ids.size(), nscanned);
+	return 0;
+}
@@ -0,0 +1,183 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file PtyBoard.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of PtyBoard
+ */
+
+#include "PtyBoard.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+PtyBoard::PtyBoard(int cores, int baud)
+: m_model(cores)
+, m_baud(baud)
+, m_master(-1)
+, m_slave(-1)
+, m_running(false)
+, m_stop(false)
+{
+}
+
+PtyBoard::~PtyBoard()
+{
+	Close();
+}
+
+/**
+	@brief Creates the pseudo-terminal and starts serving the model on it
+ */
+bool PtyBoard::Open()
+{
+	Close();
+	
+	m_master = posix_openpt(O_RDWR | O_NOCTTY);
+	if( (m_master < 0) || (0 != grantpt(m_master)) || (0 != unlockpt(m_master)) )
+	{
+		perror("couldn't create pty");
+		Close();
+		return false;
+	}
+	const char* path = ptsname(m_master);
+	if(path == NULL)
+	{
+		perror("couldn't get pty name");
+		Close();
+		return false;
+	}
+	m_path = path;
+	
+	//Raw mode from the start, so nothing is echoed back before the host sets the port up
+	m_slave = open(m_path.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+	termios flags;
+	if( (m_slave < 0) || (0 != tcgetattr(m_slave, &flags)) )
+	{
+		perror("couldn't open pty");
+		Close();
+		return false;
+	}
+	cfmakeraw(&flags);
+	if(0 != tcsetattr(m_slave, TCSANOW, &flags))
+	{
+		perror("couldn't set up pty");
+		Close();
+		return false;
+	}
+	
+	m_stop = false;
+	if(0 != pthread_create(&m_thread, NULL, ThreadProc, this))
+	{
+		printf("couldn't start pty thread\n");
+		Close();
+		return false;
+	}
+	m_running = true;
+	return true;
+}
+
+void PtyBoard::Close()
+{
+	if(m_running)
+	{
+		m_stop = true;
+		pthread_join(m_thread, NULL);
+		m_running = false;
+	}
+	if(m_slave >= 0)
+		close(m_slave);
+	if(m_master >= 0)
+		close(m_master);
+	m_slave = -1;
+	m_master = -1;
+}
+
+void* PtyBoard::ThreadProc(void* arg)
+{
+	reinterpret_cast<PtyBoard*>(arg)->Run();
+	return NULL;
+}
+
+void PtyBoard::Run()
+{
+	unsigned char buf[4096];
+	while(!m_stop)
+	{
+		//Commands from the host. The model does a whole capture as soon as it's armed.
+		pollfd pfd;
+		pfd.fd = m_master;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if(poll(&pfd, 1, 50) > 0)
+		{
+			int len = read(m_master, buf, sizeof(buf));
+			if(len > 0)
+				m_model.Write(buf, len);
+		}
+		
+		//Replies, a buffer at a time
+		while(!m_stop && m_model.WaitReadable(0))
+		{
+			int len = m_model.Read(buf, (m_baud > 0) ? 64 : sizeof(buf));
+			for(int done = 0; done < len; )
+			{
+				int x = write(m_master, buf + done, len - done);
+				if(x <= 0)
+				{
+					perror("couldn't write to pty");
+					return;
+				}
+				done += x;
+			}
+			
+			if(m_baud > 0)
+			{
+				long ns = 10LL * 1000000000LL * len / m_baud;
+				timespec delay;
+				delay.tv_sec = ns / 1000000000L;
+				delay.tv_nsec = ns % 1000000000L;
+				nanosleep(&delay, NULL);
+			}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file PtyBoard.h
+	@author Andrew D. Zonenberg
+	@brief A software model of a board behind a pseudo-terminal
+ */
+
+#ifndef PtyBoard_h
+#define PtyBoard_h
+
+#include "RedTinModel.h"
+
+#include <string>
+
+#include <pthread.h>
+
+/**
+	@brief Serves a RedTinModel on a pseudo-terminal, so the host software can open it like a real serial port.
+	
+	A thread passes bytes between the master side and the model. With a baud rate set, replies are held back
+	to the rate a real UART would send them at (10 bits per byte); otherwise they go out as fast as the pty
+	takes them.
+ */
+class PtyBoard
+{
+public:
+	PtyBoard(int cores, int baud);
+	~PtyBoard();
+	
+	bool Open();
+	void Close();
+	
+	///Path of the slave side, for UARTTransport::Open()
+	std::string GetPath() const
+	{ return m_path; }
+	
+	static void* ThreadProc(void* arg);
+	
+protected:
+	void Run();
+
+	RedTinModel m_model;
+	int m_baud;
+	
+	int m_master;
+	
+	///Slave side, kept open so the master doesn't see a hangup between opens
+	int m_slave;
+	std::string m_path;
+	
+	pthread_t m_thread;
+	bool m_running;
+	volatile bool m_stop;
+};
+
+#endif
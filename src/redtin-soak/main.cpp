@@ -0,0 +1,465 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file main.cpp
+	@author Andrew D. Zonenberg
+	@brief Soak test: runs capture cycles over and over and reports how long each part of them takes
+ */
+
+#include "CaptureArchive.h"
+#include "CaptureConfig.h"
+#include "CaptureExporter.h"
+#include "CapturePlugins.h"
+#include "PtyBoard.h"
+#include "RedTinDevice.h"
+#include "RedTinModel.h"
+#include "SignalConditioner.h"
+#include "UARTTransport.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+using namespace std;
+
+/**
+	@brief Parts of a capture cycle that are timed separately
+ */
+enum SoakPhase
+{
+	PHASE_ARM,			//sending the trigger bitstream or re-arm command
+	PHASE_TRIGGER,		//waiting for the sync byte
+	PHASE_READBACK,		//reading the sample buffer
+	PHASE_DECODE,		//filtering, attaching signals (building the columns) and state resampling
+	PHASE_ANALYZE,		//plugins
+	PHASE_EXPORT,		//writing the export files
+	PHASE_ARCHIVE,		//storing in the archive
+	PHASE_TOTAL,
+	
+	PHASE_COUNT
+};
+
+static const char* g_phasenames[PHASE_COUNT] =
+{
+	"arm",
+	"trigger",
+	"readback",
+	"decode",
+	"analyze",
+	"export",
+	"archive",
+	"total"
+};
+
+/**
+	@brief One of the configs being cycled through, set up for the board
+ */
+class SoakConfig
+{
+public:
+	CaptureConfig config;
+	std::vector<Signal> signals;
+	std::vector<unsigned char> bitstream;
+	std::vector<std::string> formats;
+	CapturePlugins plugins;
+	SignalConditioner conditioner;
+};
+
+int ShowUsage();
+int RunSoak(
+	RedTinDevice& device,
+	vector<SoakConfig*>& configs,
+	int cycles,
+	string exportpath,
+	string archivepath,
+	string csvpath);
+bool RunCycle(
+	RedTinDevice& device,
+	SoakConfig& sc,
+	bool rearm,
+	string exportpath,
+	CaptureArchive* archive,
+	double* times,
+	int& captures);
+double ElapsedMs(const timespec& start, const timespec& end);
+double Percentile(const vector<double>& sorted, double p);
+
+int main(int argc, char* argv[])
+{
+	int cycles = 1000;
+	string devpath = UARTTransport::GetDefaultPath();
+	int baud = 0;
+	int modelcores = 0;
+	int ptycores = 0;
+	bool pace = false;
+	bool setformats = false;
+	string formats;
+	string exportpath;
+	string archivepath;
+	string csvpath;
+	vector<string> fnames;
+	for(int i=1; i<argc; i++)
+	{
+		string s = argv[i];
+		if( (s == "--cycles") && (i+1 < argc) )
+			cycles = atoi(argv[++i]);
+		else if( (s == "--device") && (i+1 < argc) )
+			devpath = argv[++i];
+		else if( (s == "--baud") && (i+1 < argc) )
+			baud = atoi(argv[++i]);
+		else if( (s == "--model") && (i+1 < argc) )
+			modelcores = atoi(argv[++i]);
+		else if( (s == "--pty") && (i+1 < argc) )
+			ptycores = atoi(argv[++i]);
+		else if(s == "--pace")
+			pace = true;
+		else if( (s == "--export") && (i+1 < argc) )
+		{
+			formats = argv[++i];
+			setformats = true;
+		}
+		else if( (s == "--export-path") && (i+1 < argc) )
+			exportpath = argv[++i];
+		else if( (s == "--archive") && (i+1 < argc) )
+			archivepath = argv[++i];
+		else if( (s == "--csv") && (i+1 < argc) )
+			csvpath = argv[++i];
+		else if( (s.length() > 0) && (s[0] == '-') )
+			return ShowUsage();
+		else
+			fnames.push_back(s);
+	}
+	if(fnames.empty() || (cycles <= 0))
+		return ShowUsage();
+	
+	//Log lines should show up as they happen even when redirected
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	
+	vector<SoakConfig*> configs;
+	for(size_t i=0; i<fnames.size(); i++)
+		configs.push_back(new SoakConfig);
+	
+	int ret = 1;
+	bool ok = true;
+	for(size_t i=0; (i < fnames.size()) && ok; i++)
+	{
+		SoakConfig& sc = *configs[i];
+		ok = sc.config.Load(fnames[i]) && sc.config.CheckStateClock() && sc.plugins.Load(sc.config);
+		if(ok)
+		{
+			string list = setformats ? formats : sc.config.GetParameter("EXPORT_FORMATS");
+			for(size_t pos = 0; pos < list.length(); )
+			{
+				size_t end = list.find(' ', pos);
+				if(end == string::npos)
+					end = list.length();
+				if(end > pos)
+					sc.formats.push_back(list.substr(pos, end - pos));
+				pos = end + 1;
+			}
+		}
+	}
+	if(baud == 0)
+		baud = ok ? atoi(configs[0]->config.GetParameter("UART_BAUD", "115200").c_str()) : 115200;
+	if(exportpath.empty())
+		exportpath = ok ? configs[0]->config.GetParameter("EXPORT_PATH", "/tmp/redtin_soak") : "";
+	
+	//Whatever we're talking to
+	RedTinModel model(modelcores);
+	PtyBoard pty(ptycores, pace ? baud : 0);
+	UARTTransport uart;
+	Transport* transport = &model;
+	if(ok && (modelcores == 0))
+	{
+		if(ptycores != 0)
+		{
+			ok = pty.Open();
+			devpath = pty.GetPath();
+		}
+		ok = ok && uart.Open(devpath, baud);
+		transport = &uart;
+	}
+	
+	if(ok)
+	{
+		RedTinDevice device(transport);
+		ret = RunSoak(device, configs, cycles, exportpath, archivepath, csvpath);
+	}
+	
+	uart.Close();
+	pty.Close();
+	for(size_t i=0; i<configs.size(); i++)
+		delete configs[i];
+	return ret;
+}
+
+int ShowUsage()
+{
+	printf(
+		"Usage: redtin-soak [options] config.scfg...\n"
+		"\n"
+		"Runs capture cycles (arm, trigger, readback, decode, plugins, export, archive) one after another,\n"
+		"going round the configs in turn, and reports the p50, p99 and worst time of each part.\n"
+		"\n"
+		"Options:\n"
+		"    --cycles N             Number of cycles (default 1000)\n"
+		"    --device path          Serial port of the board\n"
+		"    --baud N               Baud rate (default from UART_BAUD in the first config, or 115200)\n"
+		"    --model cores          Use a software model of a board, in-process\n"
+		"    --pty cores            Use a software model of a board behind a pseudo-terminal, so the\n"
+		"                           serial port code is exercised too\n"
+		"    --pace                 Hold the pty's replies to the baud rate\n"
+		"    --export \"formats\"     Export formats (default EXPORT_FORMATS from each config)\n"
+		"    --export-path path     Export file name without extension (default EXPORT_PATH from the\n"
+		"                           first config, or /tmp/redtin_soak)\n"
+		"    --archive dir          Store every capture in an archive\n"
+		"    --csv file             Write the phase times of every cycle to a file\n"
+		);
+	return 1;
+}
+
+/**
+	@brief Runs the cycles and prints the report
+	
+	@return 0 if every cycle worked
+ */
+int RunSoak(
+	RedTinDevice& device,
+	vector<SoakConfig*>& configs,
+	int cycles,
+	string exportpath,
+	string archivepath,
+	string csvpath)
+{
+	if(!device.Identify())
+		return 1;
+	
+	//Signals are laid out over however many channels the board has
+	for(size_t i=0; i<configs.size(); i++)
+	{
+		SoakConfig& sc = *configs[i];
+		int count = sc.config.GetSegmentCount();
+		sc.signals = sc.config.signals;
+		sc.bitstream.resize(device.GetCoreCount() * TRIGGER_BITSTREAM_SIZE);
+		if(!AssignSignalBits(sc.signals, device.GetWidth()) ||
+			!CompileTriggers(sc.signals, sc.config.triggers, device.GetWidth(), &sc.bitstream[0]) ||
+			!device.SetSegmentCount(count))
+		{
+			return 1;
+		}
+		if(!sc.conditioner.Compile(sc.config, sc.signals, device.GetWidth()))
+		{
+			printf("%s\n", sc.conditioner.GetError().c_str());
+			return 1;
+		}
+	}
+	
+	CaptureArchive archive(archivepath);
+	
+	FILE* csv = NULL;
+	if(!csvpath.empty())
+	{
+		csv = fopen(csvpath.c_str(), "w");
+		if(csv == NULL)
+		{
+			perror("couldn't create csv file");
+			return 1;
+		}
+		fprintf(csv, "cycle,config,captures");
+		for(int i=0; i<PHASE_COUNT; i++)
+			fprintf(csv, ",%s_ms", g_phasenames[i]);
+		fprintf(csv, "\n");
+	}
+	
+	vector<double> times[PHASE_COUNT];
+	int failures = 0;
+	int captures = 0;
+	int last = -1;
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int cycle=0; cycle<cycles; cycle++)
+	{
+		//Only re-arm if the bitstream is already there, as the other tools do
+		int nconfig = cycle % configs.size();
+		double t[PHASE_COUNT];
+		int n = 0;
+		if(!RunCycle(device, *configs[nconfig], (nconfig == last), exportpath,
+			archivepath.empty() ? NULL : &archive, t, n))
+		{
+			printf("cycle %d failed\n", cycle);
+			failures ++;
+			device.Invalidate();
+			last = -1;
+			continue;
+		}
+		last = nconfig;
+		captures += n;
+		
+		for(int i=0; i<PHASE_COUNT; i++)
+			times[i].push_back(t[i]);
+		if(csv != NULL)
+		{
+			fprintf(csv, "%d,%d,%d", cycle, nconfig, n);
+			for(int i=0; i<PHASE_COUNT; i++)
+				fprintf(csv, ",%.3f", t[i]);
+			fprintf(csv, "\n");
+		}
+		
+		if( (cycles >= 10) && ((cycle + 1) % (cycles / 10) == 0) )
+			printf("%d of %d cycles done\n", cycle + 1, cycles);
+	}
+	timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(csv != NULL)
+		fclose(csv);
+	
+	double seconds = ElapsedMs(start, end) / 1000;
+	printf("\n%d cycles (%d failed), %d captures in %.3f s: %.1f captures/s\n\n",
+		cycles, failures, captures, seconds, captures / seconds);
+	if(times[PHASE_TOTAL].empty())
+		return 1;
+	printf("%-10s %10s %10s %10s %10s\n", "phase", "mean ms", "p50 ms", "p99 ms", "max ms");
+	for(int i=0; i<PHASE_COUNT; i++)
+	{
+		vector<double>& v = times[i];
+		sort(v.begin(), v.end());
+		double sum = 0;
+		for(size_t j=0; j<v.size(); j++)
+			sum += v[j];
+		printf("%-10s %10.3f %10.3f %10.3f %10.3f\n", g_phasenames[i], sum / v.size(),
+			Percentile(v, 50), Percentile(v, 99), v[v.size() - 1]);
+	}
+	return (failures == 0) ? 0 : 1;
+}
+
+/**
+	@brief Does one capture cycle, timing each phase
+	
+	@param rearm		True if the board already has this config's trigger loaded
+	@param archive		Archive to store the captures in, or NULL
+	@param times		Set to the time taken by each phase, in ms
+	@param captures		Set to the number of captures (segments) taken
+ */
+bool RunCycle(
+	RedTinDevice& device,
+	SoakConfig& sc,
+	bool rearm,
+	string exportpath,
+	CaptureArchive* archive,
+	double* times,
+	int& captures)
+{
+	timespec t[PHASE_COUNT];
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_ARM]);
+	
+	device.SetRunLengthEncoding(sc.config.IsRunLengthEncoded());
+	device.SetSegmentCount(sc.config.GetSegmentCount());
+	if(rearm ? !device.Rearm() : !device.LoadTrigger(&sc.bitstream[0]))
+		return false;
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_TRIGGER]);
+	
+	//The device notes when the capture finished and readback started
+	vector<Capture> caps;
+	if(!device.ReadCapture(caps))
+		return false;
+	t[PHASE_READBACK] = device.GetSyncTime();
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_DECODE]);
+	
+	string clockname;
+	int edge;
+	bool state = sc.config.GetStateClock(clockname, edge);
+	for(size_t i=0; i<caps.size(); i++)
+	{
+		sc.conditioner.Apply(caps[i]);
+		caps[i].SetSignals(sc.signals);
+		caps[i].SetSampleRate(sc.config.GetSampleRate());
+		caps[i].SetTimestamp(time(NULL));
+		bool resampled = state && caps[i].SampleOnClock(clockname, edge);
+		caps[i].SetConfigHash(sc.config.GetHash(resampled));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_ANALYZE]);
+	
+	for(size_t i=0; i<caps.size(); i++)
+	{
+		vector<PluginResult> results;
+		sc.plugins.Analyze(caps[i], sc.config, exportpath, results);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_EXPORT]);
+	
+	//Like the UI, only the last segment is exported
+	vector<ExportJob> jobs;
+	for(size_t i=0; i<sc.formats.size(); i++)
+	{
+		CaptureExporter* exporter = CaptureExporter::CreateExporter(sc.formats[i]);
+		if(exporter == NULL)
+			printf("unrecognized export format \"%s\"\n", sc.formats[i].c_str());
+		else
+			jobs.push_back(ExportJob(exporter, exportpath + exporter->GetFileExtension()));
+	}
+	bool ok = ExportCaptureParallel(caps[caps.size() - 1], jobs);
+	for(size_t i=0; i<jobs.size(); i++)
+		delete jobs[i].exporter;
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_ARCHIVE]);
+	
+	for(size_t i=0; (i < caps.size()) && (archive != NULL); i++)
+		ok = ok && (archive->Store(caps[i]) >= 0);
+	clock_gettime(CLOCK_MONOTONIC, &t[PHASE_TOTAL]);
+	
+	for(int i=0; i<PHASE_TOTAL; i++)
+		times[i] = ElapsedMs(t[i], t[i+1]);
+	times[PHASE_TOTAL] = ElapsedMs(t[PHASE_ARM], t[PHASE_TOTAL]);
+	captures = caps.size();
+	return ok;
+}
+
+double ElapsedMs(const timespec& start, const timespec& end)
+{
+	return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+/**
+	@brief Nearest-rank percentile of a sorted list
+ */
+double Percentile(const vector<double>& sorted, double p)
+{
+	size_t rank = ceil(p / 100 * sorted.size());
+	if(rank < 1)
+		rank = 1;
+	return sorted[rank - 1];
+}
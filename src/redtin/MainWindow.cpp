@@ -39,35 +39,26 @@
  */
 
 #include "MainWindow.h"
+#include "CaptureClient.h"
+#include "CaptureExporter.h"
+#include "CaptureQuery.h"
+#include "SignalConditioner.h"
 #include <gtkmm/messagedialog.h>
 #include <gtkmm/stock.h>
 #include <iostream>
+#include <set>
 
-#include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <fcntl.h>
-#include <termios.h>
-#include <memory.h>
+#include <string.h>
 
 using namespace std;
 
-int bit_test_pair(int state_0, int state_1, int current_1, int old_1, int current_0, int old_0);
-int bit_test(int state, int current, int old);
-int MakeTruthTable(int state_0, int state_1);
-
-static const char* g_edgenames[] = 
-{
-	"= 0",
-	"= 1",
-	"falling edge",
-	"rising edge",
-	"changes"
-};
-
 MainWindow::MainWindow(std::string fname)
-: m_signallist(2)
-, m_triggerlist(3)
+: m_searchresults(2)
+, m_archive(CaptureArchive::GetDefaultPath())
+, m_device(&m_uart)
+, m_baud(115200)
 {
 	//Initial setup
 	set_title("RED TIN Logic Analyzer");
@@ -84,6 +75,8 @@ MainWindow::MainWindow(std::string fname)
 		//Load the config file, if any
 		if(!fname.empty())
 			LoadConfig(fname);
+			
+		RefreshHistory();
 	}
 	catch(std::string err)
 	{
@@ -151,13 +144,29 @@ void MainWindow::CreateWidgets()
 			
 				m_rightbox.pack_start(m_viewflagsframe, Gtk::PACK_SHRINK);
 					m_viewflagsframe.add(m_viewflagspanel);
-					m_viewflagsframe.set_label("Additional viewer command line arguments");
+					m_viewflagsframe.set_label("Viewer mode and additional viewer command line arguments");
+						m_viewflagspanel.pack_start(m_viewermodebox, Gtk::PACK_SHRINK);
 						m_viewflagspanel.pack_start(m_viewflagsbox);
 			
 				m_rightbox.pack_start(m_samplefreqframe, Gtk::PACK_SHRINK);
 					m_samplefreqframe.add(m_samplefreqpanel);
 					m_samplefreqframe.set_label("Sampling frequency (MHz, must match \"clk\" input to LA core)");
 						m_samplefreqpanel.pack_start(m_samplefreqbox);
+						m_samplefreqpanel.pack_start(m_rlebutton, Gtk::PACK_SHRINK);
+							m_rlebutton.set_label("Only store changes (RLE)");
+						m_samplefreqpanel.pack_start(m_segmentsbox, Gtk::PACK_SHRINK);
+				
+				m_rightbox.pack_start(m_stateframe, Gtk::PACK_SHRINK);
+					m_stateframe.add(m_statepanel);
+					m_stateframe.set_label("State mode: keep one sample per edge of this signal (blank for every sample)");
+						m_statepanel.pack_start(m_stateclockbox);
+						m_statepanel.pack_start(m_stateedgebox, Gtk::PACK_SHRINK);
+						
+				m_rightbox.pack_start(m_exportframe, Gtk::PACK_SHRINK);
+					m_exportframe.add(m_exportpanel);
+					m_exportframe.set_label("Additional export formats (sr, csv, bin) and output file name");
+						m_exportpanel.pack_start(m_exportformatsbox, Gtk::PACK_SHRINK);
+						m_exportpanel.pack_start(m_exportpathbox);
 				m_rightbox.pack_start(m_triggereditframe, Gtk::PACK_SHRINK);
 					m_triggereditframe.add(m_triggereditpanel);
 					m_triggereditframe.set_label("Trigger when");
@@ -172,28 +181,68 @@ void MainWindow::CreateWidgets()
 						m_triggereditbuttons.pack_start(m_triggereditbutton, Gtk::PACK_SHRINK);
 						m_triggereditbuttons.pack_start(m_triggerdeletebutton, Gtk::PACK_SHRINK);
 						m_triggereditbuttons.pack_end(m_capturebutton, Gtk::PACK_SHRINK);
+						m_triggereditbuttons.pack_end(m_rearmbutton, Gtk::PACK_SHRINK);
 						m_triggereditbutton.set_label("Edit");
 						m_triggerdeletebutton.set_label("Delete");
 						m_capturebutton.set_label("Start Capture");
+						m_rearmbutton.set_label("Re-arm after each capture");
+				m_rightbox.pack_start(m_historyframe, Gtk::PACK_SHRINK);
+					m_historyframe.add(m_historypanel);
+					m_historyframe.set_label("Capture history");
+						m_historypanel.pack_start(m_historybox);
+						m_historypanel.pack_start(m_historyopenbutton, Gtk::PACK_SHRINK);
+						m_historyopenbutton.set_label("Open");
+				m_rightbox.pack_start(m_statsframe, Gtk::PACK_SHRINK);
+					m_statsframe.add(m_statspanel);
+					m_statsframe.set_label("Signal statistics");
+						m_statspanel.pack_start(m_statsview);
+						m_statspanel.pack_start(m_statsbuttons, Gtk::PACK_SHRINK);
+							m_statsbuttons.pack_end(m_statsresetbutton, Gtk::PACK_SHRINK);
+							m_statsresetbutton.set_label("Reset");
+							m_statsbuttons.pack_end(m_overlaysavebutton, Gtk::PACK_SHRINK);
+							m_overlaysavebutton.set_label("Save overlay...");
+				m_rightbox.pack_start(m_searchframe);
+					m_searchframe.add(m_searchpanel);
+					m_searchframe.set_label("Search capture (e.g. addr == 0x3c && !we_n && posedge clk)");
+						m_searchpanel.pack_start(m_searchbar, Gtk::PACK_SHRINK);
+							m_searchbar.pack_start(m_searchbox);
+							m_searchbar.pack_start(m_searchbutton, Gtk::PACK_SHRINK);
+							m_searchbutton.set_label("Find");
+						m_searchpanel.pack_start(m_searchresults);
 	m_rootSplitter.set_position(375);
 		
 	//Turn off scrollbars if not necessary
 	m_leftpanel.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
 	m_rightpanel.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
 	
-	//Populate signal width combo box
-	for(int i=0; i<128; i++)
+	//Signals can be as wide as every channel of the biggest board
+	m_signalwidthbox.set_range(1, RedTinDevice::MAX_CORES * CORE_WIDTH);
+	m_signalwidthbox.set_increments(1, 8);
+	m_signalwidthbox.set_value(1);
+	
+	//Bit range is set once a signal is chosen
+	m_triggerbitbox.set_range(0, 0);
+	m_triggerbitbox.set_increments(1, 8);
+	m_triggerbitbox.set_sensitive(false);
+	
+	//Segment counts are powers of two, so row N is 2^N segments
+	for(int i=1; i<=RedTinDevice::MAX_SEGMENTS; i *= 2)
 	{
-		if(i == 0)
-			m_signalwidthbox.append_text("wire");
-		else
-		{
-			char str[16];
-			snprintf(str, 15, "wire[%d:0]", i);
-			m_signalwidthbox.append_text(str);
-		}
+		char str[32];
+		snprintf(str, sizeof(str), "%d segment%s", i, (i == 1) ? "" : "s");
+		m_segmentsbox.append_text(str);
 	}
-	m_signalwidthbox.set_active(0);
+	m_segmentsbox.set_active(0);
+	
+	m_stateedgebox.append_text("RISING");
+	m_stateedgebox.append_text("FALLING");
+	m_stateedgebox.append_text("BOTH");
+	m_stateedgebox.set_active(0);
+	
+	m_viewermodebox.append_text("New viewer per capture");
+	m_viewermodebox.append_text("Reload running viewer");
+	m_viewermodebox.append_text("No viewer");
+	m_viewermodebox.set_active(WaveformViewer::VIEWER_MODE_SPAWN);
 	
 	m_triggeredgebox.append_text("is low");
 	m_triggeredgebox.append_text("is high");
@@ -201,14 +250,25 @@ void MainWindow::CreateWidgets()
 	m_triggeredgebox.append_text("has a rising edge");
 	m_triggeredgebox.append_text("changes");
 	
-	//Set column titles
-	m_signallist.set_column_title(0, "Width");
-	m_signallist.set_column_title(1, "Name");
-	m_triggerlist.set_column_title(0, "Signal");
-	m_triggerlist.set_column_title(1, "Bit");
-	m_triggerlist.set_column_title(2, "Edge");
+	//Signal and trigger views all read straight from our own tables
+	m_signalmodel = SignalListModel::create(m_signals);
+	m_signallist.set_model(m_signalmodel);
+	m_signallist.append_column("Width", m_signalmodel->GetColumn(SignalListModel::COLUMN_WIDTH));
+	m_signallist.append_column("Name", m_signalmodel->GetColumn(SignalListModel::COLUMN_NAME));
+	m_triggersignalbox.set_model(m_signalmodel);
+	m_triggersignalbox.pack_start(m_signalmodel->GetColumn(SignalListModel::COLUMN_NAME));
+	m_triggermodel = TriggerListModel::create(m_triggers);
+	m_triggerlist.set_model(m_triggermodel);
+	m_triggerlist.append_column("Signal", m_triggermodel->GetColumn(TriggerListModel::COLUMN_SIGNAL));
+	m_triggerlist.append_column("Bit", m_triggermodel->GetColumn(TriggerListModel::COLUMN_BIT));
+	m_triggerlist.append_column("Edge", m_triggermodel->GetColumn(TriggerListModel::COLUMN_CONDITION));
+	m_searchresults.set_column_title(0, "Sample");
+	m_searchresults.set_column_title(1, "Time (ns)");
 	
 	m_samplefreqbox.set_text("20.000");
+	m_statsview.set_editable(false);
+	m_statsview.modify_font(Pango::FontDescription("monospace"));
+	m_exportpathbox.set_text("/tmp/redtin_capture");
 				
 	//Set up signals
 	m_signalupdatebutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnSignalUpdate));
@@ -217,6 +277,12 @@ void MainWindow::CreateWidgets()
 	m_triggerupdatebutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnTriggerUpdate));
 	m_capturebutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnCapture));
 	m_triggerdeletebutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnTriggerDelete));
+	m_viewermodebox.signal_changed().connect(sigc::mem_fun(*this, &MainWindow::OnViewerModeChanged));
+	m_historyopenbutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnHistoryOpen));
+	m_statsresetbutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnStatsReset));
+	m_overlaysavebutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnOverlaySave));
+	m_searchbutton.signal_clicked().connect(sigc::mem_fun(*this, &MainWindow::OnSearch));
+	m_searchbox.signal_activate().connect(sigc::mem_fun(*this, &MainWindow::OnSearch));
 	
 	signal_delete_event().connect(sigc::mem_fun(*this, &MainWindow::OnClose));
 				
@@ -238,26 +304,11 @@ void MainWindow::OnSignalUpdate()
 	}
 	else
 	{
-		int width = m_signalwidthbox.get_active_row_number() + 1;
+		int width = m_signalwidthbox.get_value_as_int();
 		Glib::ustring name = m_signalnameentry.get_text();
-		//printf("add new signal - width %d, name %s\n", width, name.c_str());
-			
-		//format name
-		char str[16] = "wire";
-		if(width > 1)
-			snprintf(str, 15, "wire[%d:0]", width-1);
-			
-		//Add signal to list
-		int rowid = m_signallist.append_text();
-		m_signallist.set_text(rowid, 0, str);
-		m_signallist.set_text(rowid, 1, name);
-		
-		m_signals.push_back(Signal(width, name));
 		
-		//Update triggersignalbox with new signal list
-		m_triggersignalbox.clear_items();
-		for(size_t i=0; i<m_signals.size(); i++)
-			m_triggersignalbox.append_text(m_signals[i].name);
+		//The signal list and trigger signal box both pick it up from the model
+		m_signalmodel->Append(Signal(width, name));
 	}
 }
 
@@ -265,24 +316,16 @@ void MainWindow::OnTriggerSignalChanged()
 {
 	int sel = m_triggersignalbox.get_active_row_number();
 	
-	m_triggerbitbox.clear_items();
-	
 	//no selection
 	if(sel == -1)
 	{
+		m_triggerbitbox.set_range(0, 0);
+		m_triggerbitbox.set_sensitive(false);
 	}
 	else
-	{	
-		//Look up this item
-		Signal& sig = m_signals[sel];
-		
-		//Generate bits
-		for(int i=0; i<sig.width; i++)
-		{
-			char str[16];
-			snprintf(str, 15, "bit %d", i);
-			m_triggerbitbox.append_text(str);
-		}
+	{
+		m_triggerbitbox.set_range(0, m_signals[sel].width - 1);
+		m_triggerbitbox.set_sensitive(true);
 	}
 }
 
@@ -290,357 +333,302 @@ void MainWindow::OnTriggerUpdate()
 {
 	//Get trigger parameters
 	int signal = m_triggersignalbox.get_active_row_number();
-	int nbit = m_triggerbitbox.get_active_row_number();
+	int nbit = m_triggerbitbox.get_value_as_int();
 	int edge = m_triggeredgebox.get_active_row_number();
 	
 	//If no selection for any of them, quit
-	if( (edge == -1) || (signal == -1) || (nbit == -1) )
+	if( (edge == -1) || (signal == -1) )
 		return;
-		
-	Signal& sig = m_signals[signal];
 	
-	//Add to internal trigger list
-	m_triggers.push_back(Trigger(sig.name, nbit, edge));
-	
-	//string formatting
-	char sbit[16] = "";
-	if(sig.width > 1)
-		snprintf(sbit, 15, "[%d]", nbit);
-	
-	//Add to triggerlist
-	int row = m_triggerlist.append_text();
-	m_triggerlist.set_text(row, 0, sig.name.c_str());
-	m_triggerlist.set_text(row, 1, sbit);
-	m_triggerlist.set_text(row, 2, g_edgenames[edge]);
+	m_triggermodel->Append(Trigger(m_signals[signal].name, nbit, edge));
 }
 
 void MainWindow::OnCapture()
 {
 	printf("capture\n");	
 	
-	int state_vector[128];
-	for(int i=0; i<128; i++)
-		state_vector[i] = Trigger::TRIGGER_TYPE_DONTCARE;
+	CaptureConfig config;
+	GetConfig(config);
+	if(!config.CheckStateClock() || !m_plugins.Load(config))
+		return;
+	m_measurements.SetMeasurements(config.measurements);
 	
-	std::map<string, Signal*> signalmap;
+	//One capture per segment
+	std::vector<Capture> caps;
 	
-	//Update the bit positions of each signal
-	int bitpos = 127;
-	for(size_t i=0; i<m_signals.size(); i++)
+	//If there's a capture server, wait our turn with everybody else
+	CaptureClient client;
+	if(client.Connect())
 	{
-		Signal& sig = m_signals[i];
-		sig.highbit = bitpos;
-		sig.lowbit = bitpos - sig.width + 1;
-		bitpos -= sig.width;
+		m_uart.Close();
+		m_device.Invalidate();
 		
-		if((bitpos+1) < 0)
+		printf("Capturing through redtind...\n");
+		if(!client.RunCapture(config, caps))
 		{
-			printf("Too many signals specified!\n");
+			printf("capture failed: %s\n", client.GetError().c_str());
 			return;
 		}
-		
-		signalmap[sig.name] = &sig;
 	}
 	
-	//Set up the trigger array
-	for(size_t i=0; i<m_triggers.size(); i++)
+	//Otherwise talk to the board ourselves. The port stays open so re-arming can reuse the trigger.
+	else
 	{
-		Trigger& trig = m_triggers[i];
-		Signal& sig = *signalmap[trig.signalname];
-		
-		if(trig.triggertype > 5)
+		if(!m_uart.IsOpen() && !m_uart.Open(UARTTransport::GetDefaultPath(), m_baud))
+			return;
+		if(!m_device.Identify())
 		{
-			printf("Invalid trigger type\n");
+			m_uart.Close();
+			m_device.Invalidate();
 			return;
 		}
 		
-		//Get the bit number for the signal
-		int nbit = sig.lowbit + trig.nbit;
-		state_vector[nbit] = trig.triggertype;
-	}
-	
-	//Build the full bitmask set
-	int truth_tables[64] = {0};
-	for(int i=0; i<64; i++)
-		truth_tables[i] = MakeTruthTable(state_vector[2*i], state_vector[2*i + 1]);
-	
-	/*	
-	printf("Bitmask: \n");
-	for(int i=0; i<64; i++)
-	{
-		printf("%08x ", truth_tables[i]);
-		if( (i & 0x7) == 0x7)
-			printf("\n");
-	}
-	*/
-	
-	/*
-		128 channels packed into 64 LUTs (two bits for each).
-		Configuration is done in eight columns of 8 LUTs (16 channels) each.
-		
-		Channels [0,1]....[14,15] are loaded at once, with one bit of data per clock.
-		[16,17]...[30,31] are in the next row, etc.
-		
-		Only the low 16 bits of each LUT are meaningful; 16 "don't care" bytes must be clocked
-		into the high half.
-		
-		In total the configuration bitstream is 256 bytes (256 bits per column).
+		//Update the bit positions of each signal for however many channels the board has
+		int width = m_device.GetWidth();
+		if(!AssignSignalBits(m_signals, width))
+			return;
+		std::vector<unsigned char> bitstream(m_device.GetCoreCount() * TRIGGER_BITSTREAM_SIZE);
+		if(!CompileTriggers(m_signals, m_triggers, width, &bitstream[0]))
+			return;
 		
-		The first configuration word is bit masks 56...63.
-	*/
-	
-	//Generate the configuration bitstream for the proper column format
-	unsigned char bitstream[256];
-	for(int i=0; i<256; i++)
-	{
-		int flipped_bitnum = 255 - i;				//index from the start of the shift register
-		int bitnum = flipped_bitnum & 0x1F;			//Index of the current bit in this LUT
-		int lutnum = flipped_bitnum >> 5;			//Index of the current LUT
-			
-		//Find the appropriate truth tables and pull bits out	
-		unsigned char cword = 0;
-		for(int col=0; col<8; col++)
+		m_device.SetRunLengthEncoding(config.IsRunLengthEncoded());
+		if(!m_device.SetSegmentCount(config.GetSegmentCount()))
+			return;
+		if(!m_device.RunCapture(&bitstream[0], caps))
 		{
-			int masknum = 8*lutnum + col;
-			int bitval = (truth_tables[masknum] >> bitnum) & 0x1;
-			cword |= (bitval << col);
+			m_uart.Close();
+			m_device.Invalidate();
+			return;
 		}
 		
-		bitstream[i] = cword;
-	}
-	
-	/*
-	printf("Bitstream: \n");
-	for(int i=0; i<256; i++)
-	{
-		printf("%02x ", bitstream[i] & 0xFF);
-		if( (i & 0xF) == 0xF)
-			printf("\n");
-	}
-	*/
-	
-	//Connect to the UART
-	int hfile = open("/dev/ttyUSB0", O_RDWR);
-	if(hfile < 0)
-	{
-		perror("couldn't open uart");
-		return;
+		for(size_t i=0; i<caps.size(); i++)
+		{
+			caps[i].SetSignals(m_signals);
+			caps[i].SetSampleRate(config.GetSampleRate());
+			caps[i].SetTimestamp(time(NULL));
+		}
 	}
 	
-	//Set flags
-	termios flags;
-	memset(&flags, 0, sizeof(flags));
-	tcgetattr(hfile, &flags);
-	flags.c_cflag = B115200 | CS8 | CLOCAL | CREAD;
-	flags.c_iflag = 0;
-	flags.c_cc[VMIN] = 1;
-	if(0 != tcflush(hfile, TCIFLUSH))
+	//Every segment is cleaned up, then goes into the history and statistics, and through the plugins
+	SignalConditioner conditioner;
+	if(!conditioner.Compile(config, caps[0].GetSignals(), caps[0].GetWidth()))
 	{
-		perror("fail to flush tty");
+		Gtk::MessageDialog msg(conditioner.GetError(), false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
+		msg.run();
 		return;
 	}
-	if(0 != tcsetattr(hfile, TCSANOW, &flags))
+	string plugintext;
+	string clockname;
+	int edge;
+	bool state = config.GetStateClock(clockname, edge);
+	for(size_t i=0; i<caps.size(); i++)
 	{
-		perror("fail to set attr");
-		return;
+		Capture& cap = caps[i];
+		conditioner.Apply(cap);
+		
+		//Boil it down to a state listing if asked; on failure the whole capture is shown, hashed as a timing
+		//capture so it isn't mixed up with state listings
+		bool resampled = state && cap.SampleOnClock(clockname, edge);
+		cap.SetConfigHash(config.GetHash(resampled));
+		
+		//Keep it in the history
+		if(m_archive.Store(cap) < 0)
+			printf("failed to archive capture\n");
+		
+		//Update statistics for the run so far
+		m_stats.Accumulate(cap);
+		m_overlay.Accumulate(cap);
+		m_measurements.Accumulate(cap);
+		
+		std::vector<PluginResult> results;
+		m_plugins.Analyze(cap, config, m_exportpathbox.get_text(), results);
+		plugintext += CapturePlugins::FormatResults(cap, results);
 	}
+	RefreshHistory();
+	printf("%s", plugintext.c_str());
+	string stats = m_stats.FormatSummary();
+	if(!m_measurementdefs.empty())
+		stats += "\n" + m_measurements.FormatSummary();
+	m_statsview.get_buffer()->set_text(stats + plugintext);
+	
+	//Only the last segment is shown
+	ProcessCapture(caps[caps.size() - 1]);
+	
+	//Go again once the UI has caught up
+	if(m_rearmbutton.get_active())
+		Glib::signal_idle().connect(sigc::mem_fun(*this, &MainWindow::OnRearm));
+}
+
+bool MainWindow::OnRearm()
+{
+	if(m_rearmbutton.get_active())
+		OnCapture();
 	
-	//Send trigger header to the board
-	unsigned char header[5] = {0xfe, 0xed, 0xfa, 0xce, 0x00};
-	if(5 != write_looped(hfile, header, 5))
-	{
-		perror("couldn't send header");
-		return;
-	}
+	//one shot
+	return false;
+}
+
+/**
+	@brief Lists every sample of the last capture matching the search query
+ */
+void MainWindow::OnSearch()
+{
+	m_searchresults.clear_items();
 	
-	//Send bitstream to the board
-	if(256 != write_looped(hfile, bitstream, 256))
+	CaptureQuery query;
+	if(!query.Compile(m_searchbox.get_text(), m_lastcapture.GetSignals(), m_lastcapture.GetWidth()))
 	{
-		perror("couldn't send bitstream");
+		Gtk::MessageDialog msg(query.GetError(), false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
+		msg.run();
 		return;
 	}
 	
-	//Wait for data to come back, then read it
-	printf("Waiting for sync header...\n");
-	char ch = 0;
-	while(ch != 0x55)
-	{
-		if(1 != read(hfile, &ch, 1))
-		{
-			perror("couldn't read sync byte");
-			return;
-		}
-		//printf("%c %02x\n", ch, ch & 0xFF);
-	}
-	unsigned char read_data[512][16];
-	for(int i=0; i<512; i++)
-	{
-		if(16 != read_looped(hfile, read_data[i], 16))
-			return;
-		//printf("Got %d samples so far!\n", i);
-	}
-	printf("Got the data\n");
-	
-	//Done with the UART
-	close(hfile);
+	std::vector<int> matches;
+	query.Search(m_lastcapture, matches);
 	
-	//Create the VCD file
-	FILE* stemp = fopen("/tmp/redtin_temp.vcd", "w+");
-	if(stemp == NULL)
+	double period = 1000.0 / m_lastcapture.GetSampleRate();
+	for(size_t i=0; i<matches.size(); i++)
 	{
-		perror("couldn't create temp file");
-		return;
+		char sample[32];
+		char time[32];
+		snprintf(sample, sizeof(sample), "%d", matches[i]);
+		snprintf(time, sizeof(time), "%.3f", m_lastcapture.GetSampleTime(matches[i]) * period);
+		int row = m_searchresults.append_text();
+		m_searchresults.set_text(row, 0, sample);
+		m_searchresults.set_text(row, 1, time);
 	}
-		
-	//Get the current time
-	time_t now;
-	time(&now);
-	struct tm now_split;
-	localtime_r(&now, &now_split);
-	
-	//Get sampling frequency
-	string strRate = m_samplefreqbox.get_text();
-	float frequency = atof(strRate.c_str());	//in MHz
-	float period = 1000000 / frequency;			//in picoseconds
-	
-	//Format the VCD header
-	fprintf(stemp, "$timescale %.0fps $end\n", period/2);	//period of 1/2 clock cycle
-														//so we can show falling edges
-	fprintf(stemp, "$date %4d-%02d-%02d %02d:%02d:%d $end\n",
-		now_split.tm_year+1900, now_split.tm_mon, now_split.tm_mday,
-		now_split.tm_hour, now_split.tm_min, now_split.tm_sec);
-	fprintf(stemp, "$version RED TIN v0.1 $end\n");
-	//The special signal "capture_clk" is the clock of our sampling module
-	fprintf(stemp, "$var reg 1 * capture_clk $end\n");
-	for(size_t i=0; i<m_signals.size(); i++)
-		fprintf(stemp, "$var wire %d %c %s $end\n", m_signals[i].width, static_cast<char>('A' + i), m_signals[i].name.c_str());
-	fprintf(stemp, "$enddefinition $end\n");
-	
-	//Write the data to the VCD
-	for(int i=0; i<512; i++)
-	{
-		//Clock goes high
-		fprintf(stemp,
-				"#%d\n"
-				"1*\n",
-				i*2
-			);
-			
-		//Everything changes on the rising edge		
-		for(size_t j=0; j<m_signals.size(); j++)
-		{
-			Signal& sig = m_signals[j];
-			
-			std::string value = signal_to_binary(read_data[i], sig.lowbit, sig.highbit);
-			
-			//1-bit signal
-			if(sig.lowbit == sig.highbit)
-				fprintf(stemp, "%s%c\n", value.c_str(), static_cast<char>('A' + j));
-			
-			//Multi-bit signal
-			else
-				fprintf(stemp, "b%s %c\n", value.c_str(), static_cast<char>('A' + j) );
-		}
-		fprintf(stemp, "\n");
-		
-		//then clock goes low
-		fprintf(stemp,
-				"#%d\n"
-				"0*\n"
-				"\n",
-				i*2 + 1);
-	}
-	
-	fflush(stemp);
-	fclose(stemp);
+}
+
+void MainWindow::OnStatsReset()
+{
+	m_stats.Clear();
+	m_overlay.Clear();
+	m_measurements.Clear();
+	m_statsview.get_buffer()->set_text("");
+}
+
+/**
+	@brief Writes the overlay of the run so far as a heat map, with the mask of bits that differed next to it
+ */
+void MainWindow::OnOverlaySave()
+{
+	if(m_overlay.GetCaptureCount() == 0)
+		return;
 	
-	//Get command line arguments
-	string sargs = m_viewflagsbox.get_text();
-	char* psargs = new char[sargs.length() + 1];
-	strcpy(psargs, sargs.c_str());
+	Gtk::FileChooserDialog dlg("Save overlay heat map", Gtk::FILE_CHOOSER_ACTION_SAVE);
+	dlg.set_select_multiple(false);
+	dlg.set_create_folders(true);
+	dlg.add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
+	dlg.add_button("Save", Gtk::RESPONSE_OK);
+	if(dlg.run() != Gtk::RESPONSE_OK)
+		return;
+	string fname = dlg.get_filename();
+	if(fname == "")
+		return;
 	
-	//Parse arguments
-	std::vector<const char*> args;
-	args.push_back("/usr/bin/gtkwave");
-	args.push_back("/tmp/redtin_temp.vcd");
-	char* s = strtok(psargs, " ");
-	if(s != NULL)
+	FILE* fp = fopen(fname.c_str(), "w");
+	if(fp == NULL)
 	{
-		args.push_back(s);
-		while(NULL != (s = strtok(NULL, " ")))
-			args.push_back(s);
+		perror("couldn't create overlay file");
+		return;
 	}
-	args.push_back(NULL);
+	m_overlay.WriteHeatMap(fp, 0);
+	fclose(fp);
 	
-	//Spawn gtkwave
-	pid_t gtkwave_pid = fork();
-	if(gtkwave_pid == 0)
+	string maskname = fname + ".mask";
+	fp = fopen(maskname.c_str(), "w");
+	if(fp == NULL)
 	{
-		execv("/usr/bin/gtkwave", (char**)&args[0]);
-		perror("child: failed to spawn gtkwave");
+		perror("couldn't create overlay mask file");
+		return;
 	}
-	else if(gtkwave_pid == -1)
-		perror("failed to spawn gtkwave");
-		
-	delete[] psargs;
+	m_overlay.WriteDifferMask(fp);
+	fclose(fp);
 }
 
-int MainWindow::write_looped(int fd, unsigned char* buf, int count)
+/**
+	@brief Shows a capture in the viewer and writes it out in all of the configured export formats
+ */
+void MainWindow::ProcessCapture(const Capture& cap)
 {
-	unsigned char* p = buf;
-	int bytes_left = count;
-	int x = 0;
-	while( (x = write(fd, p, bytes_left)) > 0)
+	m_lastcapture = cap;
+	
+	//Get it in front of the user first
+	m_viewer.SetArguments(m_viewflagsbox.get_text());
+	m_viewer.ShowCapture(cap);
+	
+	//Then write whatever other formats were asked for
+	std::vector<ExportJob> jobs;
+	string formats = m_exportformatsbox.get_text();
+	string exportpath = m_exportpathbox.get_text();
+	char* psformats = new char[formats.length() + 1];
+	strcpy(psformats, formats.c_str());
+	for(char* f = strtok(psformats, " ,"); f != NULL; f = strtok(NULL, " ,"))
 	{
-		if(x < 0)
+		CaptureExporter* exporter = CaptureExporter::CreateExporter(f);
+		if(exporter == NULL)
 		{
-			perror("fail to write");
-			return -1;
+			printf("unrecognized export format \"%s\"\n", f);
+			continue;
 		}
-		bytes_left -= x;
-		p += x;
+		jobs.push_back(ExportJob(exporter, exportpath + exporter->GetFileExtension()));
 	}
+	delete[] psformats;
 	
-	return count;
-}
-
-int MainWindow::read_looped(int fd, unsigned char* buf, int count)
-{
-	unsigned char* p = buf;
-	int bytes_left = count;
-	int x = 0;
-	while( (x = read(fd, p, bytes_left)) > 0)
+	//Encode everything at once
+	if(!jobs.empty())
+		ExportCaptureParallel(cap, jobs);
+	for(size_t i=0; i<jobs.size(); i++)
 	{
-		if(x < 0)
-		{
-			perror("fail to read");
-			return -1;
-		}
-		bytes_left -= x;
-		p += x;
+		if(!jobs[i].ok)
+			printf("failed to write %s\n", jobs[i].fname.c_str());
+		delete jobs[i].exporter;
 	}
-	
-	return count;
 }
 
 /**
-	@brief Converts a signal to a binary string
+	@brief Reloads the capture history list, newest first
  */
-std::string MainWindow::signal_to_binary(unsigned char* data, int lowbit, int highbit)
+void MainWindow::RefreshHistory()
 {
-	string ret;
+	m_archive.Refresh();
+	const std::vector<ArchiveEntry>& entries = m_archive.GetEntries();
 	
-	for(int i=highbit; i>=lowbit; i--)
+	m_historybox.clear_items();
+	for(size_t i=entries.size(); i>0; i--)
 	{
-		int nword = 15 - (i >> 3);
-		int col = i & 7;
-		
-		int j = (data[nword] >> col) & 1;
-		char c = j + '0';
-		ret += c;
+		const ArchiveEntry& entry = entries[i-1];
+		struct tm split;
+		localtime_r(&entry.timestamp, &split);
+		char str[128];
+		snprintf(str, sizeof(str), "#%d  %4d-%02d-%02d %02d:%02d:%02d  (%d samples at %.3f MHz)",
+			entry.id,
+			split.tm_year+1900, split.tm_mon+1, split.tm_mday,
+			split.tm_hour, split.tm_min, split.tm_sec,
+			entry.depth, entry.samplerate);
+		m_historybox.append_text(str);
 	}
+	if(!entries.empty())
+		m_historybox.set_active(0);
+}
+
+void MainWindow::OnHistoryOpen()
+{
+	int row = m_historybox.get_active_row_number();
+	const std::vector<ArchiveEntry>& entries = m_archive.GetEntries();
+	if( (row < 0) || (row >= static_cast<int>(entries.size())) )
+		return;
 	
-	return ret;
+	Capture cap;
+	if(m_archive.Load(entries[entries.size() - 1 - row].id, cap))
+		ProcessCapture(cap);
+}
+
+void MainWindow::OnViewerModeChanged()
+{
+	int mode = m_viewermodebox.get_active_row_number();
+	if(mode >= 0)
+		m_viewer.SetMode(mode);
 }
 
 void MainWindow::OnSignalDelete()
@@ -649,14 +637,9 @@ void MainWindow::OnSignalDelete()
 	Glib::RefPtr<Gtk::TreeSelection> sel = m_signallist.get_selection();
 	if(sel->count_selected_rows() == 0)
 		return;
-	Glib::RefPtr<Gtk::ListStore> model = Glib::RefPtr<Gtk::ListStore>::cast_static(m_signallist.get_model());
-	Gtk::TreeModel::iterator it = sel->get_selected();
-	
-	//Delete from our internal store
-	m_signals.erase(m_signals.begin() + model->get_path(it)[0]);
-	
-	//Delete from tree model
-	model->erase( it );
+	int row = m_signalmodel->GetRowNumber(sel->get_selected());
+	if(row >= 0)
+		m_signalmodel->Erase(row);
 }
 
 void MainWindow::OnTriggerDelete()
@@ -665,14 +648,9 @@ void MainWindow::OnTriggerDelete()
 	Glib::RefPtr<Gtk::TreeSelection> sel = m_triggerlist.get_selection();
 	if(sel->count_selected_rows() == 0)
 		return;
-	Glib::RefPtr<Gtk::ListStore> model = Glib::RefPtr<Gtk::ListStore>::cast_static(m_triggerlist.get_model());
-	Gtk::TreeModel::iterator it = sel->get_selected();
-	
-	//Delete from our internal store
-	m_triggers.erase(m_triggers.begin() + model->get_path(it)[0]);
-	
-	//Delete from tree model
-	model->erase( it );
+	int row = m_triggermodel->GetRowNumber(sel->get_selected());
+	if(row >= 0)
+		m_triggermodel->Erase(row);
 }
 
 bool MainWindow::OnClose(GdkEventAny* /*event*/)
@@ -696,226 +674,159 @@ bool MainWindow::OnClose(GdkEventAny* /*event*/)
 		if(dlg.run() != Gtk::RESPONSE_OK)
 			return true;
 		
-		//Create the file
+		//Save everything
 		string fname = dlg.get_filename();
 		if(fname == "")
 			return true;
-		FILE* fp = fopen(fname.c_str(), "w");
-		
-		//Save everything
-		//Config file format is mostly a subset of Verilog to make it nice and readable.
-		
-		//Sample rate
-		string sample_rate = m_samplefreqbox.get_text();
-		fprintf(fp, "parameter SAMPLE_RATE_MHZ = %s;\n", sample_rate.c_str());
-		
-		//Arguments
-		string sargs = m_viewflagsbox.get_text();
-		fprintf(fp, "parameter VIEWER_ARGS = %s;\n", sargs.c_str());
-		
-		//Signals
-		for(size_t i=0; i<m_signals.size(); i++)
-		{
-			Signal& sig = m_signals[i];
-			fprintf(fp, "wire[%d:0] %s;\n", sig.width-1, sig.name.c_str());
-		}
-		
-		//Triggers
-		//add_trigger_condition(posedge foobar[3]);
-		for(size_t i=0; i<m_triggers.size(); i++)
-		{
-			Trigger& trig = m_triggers[i];
-			fprintf(fp, "add_trigger_condition(");
-			switch(trig.triggertype)
-			{
-				case Trigger::TRIGGER_TYPE_LOW:
-					fprintf(fp, "!%s[%d]", trig.signalname.c_str(), trig.nbit);
-					break;
-				case Trigger::TRIGGER_TYPE_HIGH:
-					fprintf(fp, "%s[%d]", trig.signalname.c_str(), trig.nbit);
-					break;
-				case Trigger::TRIGGER_TYPE_RISING:
-					fprintf(fp, "posedge %s[%d]", trig.signalname.c_str(), trig.nbit);
-					break;
-				case Trigger::TRIGGER_TYPE_FALLING:
-					fprintf(fp, "negedge %s[%d]", trig.signalname.c_str(), trig.nbit);
-					break;
-				case Trigger::TRIGGER_TYPE_CHANGE:
-					fprintf(fp, "posedge %s[%d] or negedge %s[%d]", trig.signalname.c_str(), trig.nbit, trig.signalname.c_str(), trig.nbit);
-					break;
-			}
-			fprintf(fp, ");\n");
-		}
-		
-		fclose(fp);
+		CaptureConfig config;
+		GetConfig(config);
+		config.Save(fname);
 	}
 	
 	//keep going
 	return false;
 }
 
+/**
+	@brief Collects the current settings, signals and triggers into a config
+ */
+void MainWindow::GetConfig(CaptureConfig& config)
+{
+	config.SetParameter("SAMPLE_RATE_MHZ", m_samplefreqbox.get_text());
+	config.SetParameter("CAPTURE_MODE", m_rlebutton.get_active() ? "RLE" : "NORMAL");
+	char segments[32];
+	snprintf(segments, sizeof(segments), "%d", 1 << m_segmentsbox.get_active_row_number());
+	config.SetParameter("SEGMENTS", segments);
+	if(!m_stateclockbox.get_text().empty())
+	{
+		config.SetParameter("STATE_CLOCK", m_stateclockbox.get_text());
+		config.SetParameter("STATE_EDGE", m_stateedgebox.get_active_text());
+	}
+	config.SetParameter("VIEWER_ARGS", m_viewflagsbox.get_text());
+	config.SetParameter("VIEWER_MODE", WaveformViewer::GetModeName(m_viewer.GetMode()));
+	config.SetParameter("EXPORT_FORMATS", m_exportformatsbox.get_text());
+	config.SetParameter("EXPORT_PATH", m_exportpathbox.get_text());
+	
+	char str[32];
+	config.SetParameter("HISTORY_PATH", m_archive.GetPath());
+	snprintf(str, sizeof(str), "%ld", m_archive.GetMaxBytes() / (1024 * 1024));
+	config.SetParameter("HISTORY_MAX_MB", str);
+	snprintf(str, sizeof(str), "%ld", m_archive.GetMaxAge() / (24 * 60 * 60));
+	config.SetParameter("HISTORY_MAX_DAYS", str);
+	snprintf(str, sizeof(str), "%d", m_baud);
+	config.SetParameter("UART_BAUD", str);
+	
+	for(size_t i=0; i<m_extraparams.size(); i++)
+		config.SetParameter(m_extraparams[i].first, m_extraparams[i].second);
+	
+	config.signals = m_signals;
+	config.triggers = m_triggers;
+	config.measurements = m_measurementdefs;
+	config.filters = m_filters;
+}
+
 void MainWindow::LoadConfig(std::string fname)
 {
 	//Read the config file
-	FILE* fp = fopen(fname.c_str(), "r");
-	char line[1024];
-	while(fgets(line, 1023, fp))
+	CaptureConfig config;
+	if(!config.Load(fname))
+		return;
+	
+	//Parameters - global settings of some sort
+	for(size_t i=0; i<config.parameters.size(); i++)
 	{
-		//Read the opcode
-		char word[256];
-		sscanf(line, "%255[a-z_]", word);
-		std::string sw = word;
-		
-		//Parameters - global settings of some sort
-		if(sw == "parameter")
+		string sname = config.parameters[i].first;
+		const char* value = config.parameters[i].second.c_str();
+		
+		if(sname == "SAMPLE_RATE_MHZ")
+			m_samplefreqbox.set_text(value);
+		else if(sname == "CAPTURE_MODE")
+			m_rlebutton.set_active(config.IsRunLengthEncoded());
+		else if(sname == "SEGMENTS")
 		{
-			char name[256];
-			char value[1024];
-			sscanf(line, "parameter %255[^ =] = %1023[^;];", name, value);
-			string sname = name;
-			
-			if(sname == "SAMPLE_RATE_MHZ")
-				m_samplefreqbox.set_text(value);
-			else if(sname == "VIEWER_ARGS")
-				m_viewflagsbox.set_text(value);
-			else
-				printf("unrecognized parameter \"%s\"\n", name);
+			int row = 0;
+			while( ((1 << row) < config.GetSegmentCount()) && ((1 << row) < RedTinDevice::MAX_SEGMENTS) )
+				row ++;
+			m_segmentsbox.set_active(row);
 		}
-		
-		//Wires - signals
-		else if(sw == "wire")
+		else if(sname == "STATE_CLOCK")
+			m_stateclockbox.set_text(value);
+		else if(sname == "STATE_EDGE")
+			m_stateedgebox.set_active_text(value);
+		else if(sname == "VIEWER_ARGS")
+			m_viewflagsbox.set_text(value);
+		else if(sname == "VIEWER_MODE")
 		{
-			char name[256];
-			int maxbit;
-			sscanf(line, "wire[%d:0] %255[^;];", &maxbit, name);
-			
-			m_signals.push_back(Signal(maxbit+1, name));
-			
-			char swidth[128] = "wire";
-			if(maxbit != 0)
-				snprintf(swidth, 127, "wire[%d:0]", maxbit);
-			
-			int rowid = m_signallist.append_text();
-			m_signallist.set_text(rowid, 0, swidth);
-			m_signallist.set_text(rowid, 1, name);
+			int mode = WaveformViewer::ParseModeName(value);
+			if(mode < 0)
+				printf("unrecognized viewer mode \"%s\"\n", value);
+			else
+				m_viewermodebox.set_active(mode);
 		}
-		
-		//Triggers
-		else if(sw == "add_trigger_condition")
+		else if(sname == "EXPORT_FORMATS")
+			m_exportformatsbox.set_text(value);
+		else if(sname == "EXPORT_PATH")
+			m_exportpathbox.set_text(value);
+		else if(sname == "HISTORY_PATH")
+			m_archive.SetPath(value);
+		else if(sname == "UART_BAUD")
 		{
-			char body[256];
-			sscanf(line, "add_trigger_condition( %255[^)] );", body);
-			
-			bool posedge = (strstr(body, "posedge") != NULL);
-			bool negedge = (strstr(body, "negedge") != NULL);
-			bool found_or = (strstr(body, "or") != NULL);
-			
-			// !foo
-			int type = 0;
-			char* namestart = body;
-			if(body[0] == '!')
-			{
-				type = Trigger::TRIGGER_TYPE_LOW;
-				namestart ++;
-			}
-			
-			//posedge foo
-			else if(posedge && !negedge)
-			{
-				type = Trigger::TRIGGER_TYPE_RISING;
-				namestart += strlen("posedge");
-			}
-			
-			//negedge foo
-			else if(negedge && !posedge)
-			{
-				type = Trigger::TRIGGER_TYPE_FALLING;
-				namestart += strlen("negedge");
-			}
-			
-			//posedge foo or negedge foo
-			else if(posedge && negedge && found_or)
-			{
-				type = Trigger::TRIGGER_TYPE_CHANGE;
-				namestart += strlen("posedge");
-			}
-			
-			//foo
-			else
-				type = Trigger::TRIGGER_TYPE_HIGH;
-				
-			//Read the name
-			char name[128];
-			int bit;
-			sscanf(namestart, " %127[^ [][%d]", name, &bit);
-			
-			m_triggers.push_back(Trigger(name, bit, type));
-			
-			//Add to triggerlist
-			char sbit[32];
-			snprintf(sbit, 31, "%d", bit);
-			int row = m_triggerlist.append_text();
-			m_triggerlist.set_text(row, 0, name);
-			m_triggerlist.set_text(row, 1, sbit);
-			m_triggerlist.set_text(row, 2, g_edgenames[type]);
+			m_baud = atoi(value);
+			m_uart.Close();
+			m_device.Invalidate();
 		}
-		
-		//Something's wrong, skip the line
+		else if(sname == "HISTORY_MAX_MB")
+			m_archive.SetLimits(atol(value) * 1024 * 1024, m_archive.GetMaxAge());
+		else if(sname == "HISTORY_MAX_DAYS")
+			m_archive.SetLimits(m_archive.GetMaxBytes(), atol(value) * 24 * 60 * 60);
 		else
-			printf("unrecognized keyword \"%s\" in config file\n", word);
+			m_extraparams.push_back(config.parameters[i]);
 	}
-
-	fclose(fp);
 	
-	//Update triggersignalbox with new signal list
-	m_triggersignalbox.clear_items();
-	for(size_t i=0; i<m_signals.size(); i++)
-		m_triggersignalbox.append_text(m_signals[i].name);
-}
-
-int bit_test_pair(int state_0, int state_1, int current_1, int old_1, int current_0, int old_0)
-{
-	return bit_test(state_0, current_0, old_0) && bit_test(state_1, current_1, old_1);
-}
-
-int bit_test(int state, int current, int old)
-{
-	switch(state)
+	//Wires - signals. Every view of them updates a row at a time. Only the first of several signals with the
+	//same name is kept.
+	set<string> duplicates;
+	for(size_t i=0; i<config.signals.size(); i++)
 	{
-		case Trigger::TRIGGER_TYPE_LOW:
-			return (!current);
-		case Trigger::TRIGGER_TYPE_HIGH:
-			return (current);
-		case Trigger::TRIGGER_TYPE_RISING:
-			return (current && !old);
-		case Trigger::TRIGGER_TYPE_FALLING:
-			return (!current && old);
-		case Trigger::TRIGGER_TYPE_CHANGE:
-			return (current != old);
-		case Trigger::TRIGGER_TYPE_DONTCARE:
-			return 1;
+		if(!m_signalmodel->Append(config.signals[i]))
+			duplicates.insert(config.signals[i].name);
 	}
 	
-	return 0;
-}
-
-int MakeTruthTable(int state_0, int state_1)
-{
-	int table = 0;
-	for(int current_0 = 0; current_0 <= 1; current_0 ++)
+	//Triggers. There's no telling which signal a trigger on a duplicated name meant, so those are dropped
+	//along with triggers on signals that don't exist, rather than failing every capture later.
+	for(size_t i=0; i<config.triggers.size(); i++)
+	{
+		const Trigger& trig = config.triggers[i];
+		int row = m_signalmodel->Find(trig.signalname);
+		if( (row < 0) || (duplicates.find(trig.signalname) != duplicates.end()) )
+		{
+			printf("skipping trigger on \"%s\", which isn't a unique signal\n", trig.signalname.c_str());
+			continue;
+		}
+		if( (trig.nbit < 0) || (trig.nbit >= m_signals[row].width) )
+		{
+			printf("skipping trigger on %s[%d], which is out of range\n", trig.signalname.c_str(), trig.nbit);
+			continue;
+		}
+		m_triggermodel->Append(trig);
+	}
+	
+	//Same for the state clock, which is left blank so captures aren't all resampled on nothing
+	if(!config.CheckStateClock())
+		m_stateclockbox.set_text("");
+	
+	//Measurements and filters have no editor, so are kept as loaded. Filters are checked the same way as
+	//triggers.
+	m_measurementdefs = config.measurements;
+	m_filters.clear();
+	for(size_t i=0; i<config.filters.size(); i++)
 	{
-		for(int current_1 = 0; current_1 <= 1; current_1 ++)
+		const SignalFilter& f = config.filters[i];
+		if( (m_signalmodel->Find(f.signalname) < 0) || (duplicates.find(f.signalname) != duplicates.end()) )
 		{
-			for(int old_0 = 0; old_0 <= 1; old_0 ++)
-			{
-				for(int old_1 = 0; old_1 <= 1; old_1 ++)
-				{
-					int bitnum = (old_1 << 3) | (current_1 << 2) | (old_0 << 1) | (current_0);
-					int bitval = bit_test_pair(state_0, state_1, current_1, old_1, current_0, old_0);
-					table |= (bitval << bitnum);
-				}
-			}					
+			printf("skipping filter on \"%s\", which isn't a unique signal\n", f.signalname.c_str());
+			continue;
 		}
+		m_filters.push_back(f);
 	}
-	return table;
 }
@@ -42,6 +42,7 @@
 #define MainWindow_h
 #include <gtkmm/actiongroup.h>
 #include <gtkmm/box.h>
+#include <gtkmm/checkbutton.h>
 #include <gtkmm/combobox.h>
 #include <gtkmm/comboboxtext.h>
 #include <gtkmm/entry.h>
@@ -52,54 +53,28 @@
 #include <gtkmm/main.h>
 #include <gtkmm/paned.h>
 #include <gtkmm/scrolledwindow.h>
+#include <gtkmm/spinbutton.h>
+#include <gtkmm/textview.h>
+#include <gtkmm/treeview.h>
 #include <gtkmm/widget.h>
 #include <gtkmm/window.h>
 
 #include <vector>
 #include <map>
 
-class Signal
-{
-public:
-	int width;
-	std::string name;
-	
-	Signal(int w, std::string n)
-	: width(w)
-	, name(n)
-	{
-	}
-	
-	//not used except by OnCapture
-	int highbit;
-	int lowbit;
-};
-
-class Trigger
-{
-public:
-	enum TriggerTypes
-	{
-		TRIGGER_TYPE_LOW,
-		TRIGGER_TYPE_HIGH,
-		TRIGGER_TYPE_FALLING,
-		TRIGGER_TYPE_RISING,
-		TRIGGER_TYPE_CHANGE,
-		
-		TRIGGER_TYPE_DONTCARE
-	};
-	
-	std::string signalname;		//needed because IDs change when we delete a signal
-	int nbit;
-	int triggertype;
-	
-	Trigger(std::string s, int b, int t)
-	: signalname(s)
-	, nbit(b)
-	, triggertype(t)
-	{
-	}
-};
+#include "CaptureArchive.h"
+#include "CaptureConfig.h"
+#include "CaptureMeasurements.h"
+#include "CaptureOverlay.h"
+#include "CapturePlugins.h"
+#include "CaptureStatistics.h"
+#include "RedTinDevice.h"
+#include "Signal.h"
+#include "SignalListModel.h"
+#include "Trigger.h"
+#include "TriggerListModel.h"
+#include "UARTTransport.h"
+#include "WaveformViewer.h"
 
 class MainWindow : public Gtk::Window
 {
@@ -120,7 +95,7 @@ protected:
 			Gtk::VBox m_leftbox;
 				Gtk::Frame m_editframe;
 					Gtk::HBox m_editpanel;
-						Gtk::ComboBoxText m_signalwidthbox;
+						Gtk::SpinButton m_signalwidthbox;
 						Gtk::Entry m_signalnameentry;
 						Gtk::Button m_signalupdatebutton;
 				Gtk::HBox m_leftbuttons;
@@ -128,27 +103,55 @@ protected:
 					Gtk::Button m_deletebutton;
 					Gtk::Button m_sigupbutton;
 					Gtk::Button m_sigdownbutton;
-				Gtk::ListViewText m_signallist;
+				Gtk::TreeView m_signallist;
 		Gtk::ScrolledWindow m_rightpanel;
 			Gtk::VBox m_rightbox;
 				Gtk::Frame m_viewflagsframe;
 					Gtk::HBox m_viewflagspanel;
+						Gtk::ComboBoxText m_viewermodebox;
 						Gtk::Entry m_viewflagsbox;
 				Gtk::Frame m_samplefreqframe;
 					Gtk::HBox m_samplefreqpanel;
 						Gtk::Entry m_samplefreqbox;
+						Gtk::CheckButton m_rlebutton;
+						Gtk::ComboBoxText m_segmentsbox;
+				Gtk::Frame m_stateframe;
+					Gtk::HBox m_statepanel;
+						Gtk::Entry m_stateclockbox;
+						Gtk::ComboBoxText m_stateedgebox;
+				Gtk::Frame m_exportframe;
+					Gtk::HBox m_exportpanel;
+						Gtk::Entry m_exportformatsbox;
+						Gtk::Entry m_exportpathbox;
 				Gtk::Frame m_triggereditframe;
 					Gtk::HBox m_triggereditpanel;
-						Gtk::ComboBoxText m_triggersignalbox;
-						Gtk::ComboBoxText m_triggerbitbox;
+						Gtk::ComboBox m_triggersignalbox;
+						Gtk::SpinButton m_triggerbitbox;
 						Gtk::ComboBoxText m_triggeredgebox;
 						Gtk::Button m_triggerupdatebutton;
 				Gtk::VBox m_triggerpanel;
-					Gtk::ListViewText m_triggerlist;
+					Gtk::TreeView m_triggerlist;
 					Gtk::HBox m_triggereditbuttons;
 						Gtk::Button m_triggereditbutton;
 						Gtk::Button m_triggerdeletebutton;
+						Gtk::CheckButton m_rearmbutton;
 						Gtk::Button m_capturebutton;
+				Gtk::Frame m_historyframe;
+					Gtk::HBox m_historypanel;
+						Gtk::ComboBoxText m_historybox;
+						Gtk::Button m_historyopenbutton;
+				Gtk::Frame m_statsframe;
+					Gtk::VBox m_statspanel;
+						Gtk::TextView m_statsview;
+						Gtk::HBox m_statsbuttons;
+							Gtk::Button m_statsresetbutton;
+							Gtk::Button m_overlaysavebutton;
+				Gtk::Frame m_searchframe;
+					Gtk::VBox m_searchpanel;
+						Gtk::HBox m_searchbar;
+							Gtk::Entry m_searchbox;
+							Gtk::Button m_searchbutton;
+						Gtk::ListViewText m_searchresults;
 
 	bool m_bEditingSignal;
 	void OnSignalUpdate();
@@ -158,17 +161,59 @@ protected:
 	void OnTriggerDelete();
 	
 	void OnCapture();
+	bool OnRearm();
+	void OnViewerModeChanged();
+	void ProcessCapture(const Capture& cap);
+	
+	WaveformViewer m_viewer;
+	
+	void RefreshHistory();
+	void OnHistoryOpen();
+	
+	CaptureArchive m_archive;
+	
+	void OnStatsReset();
+	
+	CaptureStatistics m_stats;
+	
+	void OnOverlaySave();
+	
+	///Every capture of the run so far, overlaid
+	CaptureOverlay m_overlay;
+	
+	///Analysis plugins from the config, run on every capture
+	CapturePlugins m_plugins;
+	
+	///Timing measurements from the config, summed over the run like the statistics
+	std::vector<Measurement> m_measurementdefs;
+	CaptureMeasurements m_measurements;
+	
+	///Clean-up of noisy signals from the config, applied to every capture
+	std::vector<SignalFilter> m_filters;
+	
+	///Parameters with no widget of their own (PLUGINS, and the plugins' settings), saved back as loaded
+	std::vector< std::pair<std::string, std::string> > m_extraparams;
+	
+	void OnSearch();
+	
+	///The capture most recently shown, for searching
+	Capture m_lastcapture;
 	
 	std::vector<Signal> m_signals;	
 	std::vector<Trigger> m_triggers;
 	
-	int write_looped(int fd, unsigned char* buf, int count);
-	int read_looped(int fd, unsigned char* buf, int count);
+	//Views of the signals and triggers; all changes go through these
+	Glib::RefPtr<SignalListModel> m_signalmodel;
+	Glib::RefPtr<TriggerListModel> m_triggermodel;
 	
-	std::string signal_to_binary(unsigned char* data, int lowbit, int highbit);
+	///Used when there's no capture server to go through
+	UARTTransport m_uart;
+	RedTinDevice m_device;
+	int m_baud;
 	
 	bool OnClose(GdkEventAny* event);
 	
+	void GetConfig(CaptureConfig& config);
 	void LoadConfig(std::string fname);
 };
 
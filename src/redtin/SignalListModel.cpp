@@ -0,0 +1,120 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file SignalListModel.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of SignalListModel
+ */
+
+#include "SignalListModel.h"
+
+#include <stdio.h>
+
+using namespace std;
+
+/**
+	@param signals	The signal table, which must outlive the model
+ */
+SignalListModel::SignalListModel(vector<Signal>& signals)
+: Glib::ObjectBase(typeid(SignalListModel))
+, TextListModel(COLUMN_COUNT)
+, m_signals(signals)
+{
+	for(size_t i=0; i<m_signals.size(); i++)
+		m_index[m_signals[i].name] = i;
+}
+
+Glib::RefPtr<SignalListModel> SignalListModel::create(vector<Signal>& signals)
+{
+	return Glib::RefPtr<SignalListModel>(new SignalListModel(signals));
+}
+
+/**
+	@brief Adds a signal to the end of the table
+	
+	@return false if there's already a signal with the same name
+ */
+bool SignalListModel::Append(const Signal& sig)
+{
+	if(m_index.find(sig.name) != m_index.end())
+	{
+		printf("there's already a signal called \"%s\"\n", sig.name.c_str());
+		return false;
+	}
+	
+	m_index[sig.name] = m_signals.size();
+	m_signals.push_back(sig);
+	NotifyInserted(m_signals.size() - 1);
+	return true;
+}
+
+void SignalListModel::Erase(int row)
+{
+	m_index.erase(m_signals[row].name);
+	m_signals.erase(m_signals.begin() + row);
+	for(size_t i=row; i<m_signals.size(); i++)
+		m_index[m_signals[i].name] = i;
+	NotifyDeleted(row);
+}
+
+/**
+	@brief Looks up a signal by name
+	
+	@return The row of the signal, or -1 if there's none by that name
+ */
+int SignalListModel::Find(string name) const
+{
+	map<string, int>::const_iterator it = m_index.find(name);
+	if(it == m_index.end())
+		return -1;
+	return it->second;
+}
+
+int SignalListModel::GetRowCount() const
+{
+	return m_signals.size();
+}
+
+Glib::ustring SignalListModel::GetText(int row, int column) const
+{
+	const Signal& sig = m_signals[row];
+	if(column == COLUMN_NAME)
+		return sig.name;
+	
+	char str[32] = "wire";
+	if(sig.width > 1)
+		snprintf(str, sizeof(str), "wire[%d:0]", sig.width - 1);
+	return str;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file SignalListModel.h
+	@author Andrew D. Zonenberg
+	@brief List model over the signal table
+ */
+
+#ifndef SignalListModel_h
+#define SignalListModel_h
+
+#include "TextListModel.h"
+#include "Signal.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+	@brief Shows a signal table in list views and combo boxes without copying it, with columns for the width and
+	name. All changes to the table must go through the model so views update incrementally.
+ */
+class SignalListModel : public TextListModel
+{
+public:
+	static Glib::RefPtr<SignalListModel> create(std::vector<Signal>& signals);
+	
+	enum Columns
+	{
+		COLUMN_WIDTH,
+		COLUMN_NAME,
+		
+		COLUMN_COUNT
+	};
+	
+	bool Append(const Signal& sig);
+	void Erase(int row);
+	
+	int Find(std::string name) const;
+	
+protected:
+	SignalListModel(std::vector<Signal>& signals);
+	
+	virtual int GetRowCount() const;
+	virtual Glib::ustring GetText(int row, int column) const;
+	
+	std::vector<Signal>& m_signals;
+	
+	///Row of each signal, by name
+	std::map<std::string, int> m_index;
+};
+
+#endif
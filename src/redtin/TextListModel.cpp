@@ -0,0 +1,207 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file TextListModel.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of TextListModel
+ */
+
+#include "TextListModel.h"
+
+TextListModel::TextListModel(int ncolumns)
+: Glib::Object()
+, m_columns(ncolumns)
+, m_stamp(1)
+{
+	for(int i=0; i<ncolumns; i++)
+		m_record.add(m_columns[i]);
+}
+
+/**
+	@brief Gets the row an iterator points to
+	
+	@return The row number, or -1 if the iterator is stale or doesn't point to a row
+ */
+int TextListModel::GetRowNumber(const iterator& iter) const
+{
+	if(iter.get_stamp() != m_stamp)
+		return -1;
+	int row = GPOINTER_TO_INT(iter.gobj()->user_data);
+	if( (row < 0) || (row >= GetRowCount()) )
+		return -1;
+	return row;
+}
+
+bool TextListModel::MakeIter(int row, iterator& iter) const
+{
+	if( (row < 0) || (row >= GetRowCount()) )
+	{
+		iter = iterator();
+		return false;
+	}
+	iter.set_stamp(m_stamp);
+	iter.gobj()->user_data = GINT_TO_POINTER(row);
+	return true;
+}
+
+/**
+	@brief Tells views that a row was added, after it's been put in the container
+ */
+void TextListModel::NotifyInserted(int row)
+{
+	Path path;
+	path.push_back(row);
+	row_inserted(path, get_iter(path));
+}
+
+/**
+	@brief Tells views that a row needs redrawing
+ */
+void TextListModel::NotifyChanged(int row)
+{
+	Path path;
+	path.push_back(row);
+	row_changed(path, get_iter(path));
+}
+
+/**
+	@brief Tells views that a row was removed, after it's been taken out of the container
+ */
+void TextListModel::NotifyDeleted(int row)
+{
+	//Rows after it moved up, so every outstanding iterator is wrong now
+	m_stamp++;
+	
+	Path path;
+	path.push_back(row);
+	row_deleted(path);
+}
+
+Gtk::TreeModelFlags TextListModel::get_flags_vfunc() const
+{
+	return Gtk::TREE_MODEL_LIST_ONLY;
+}
+
+int TextListModel::get_n_columns_vfunc() const
+{
+	return m_columns.size();
+}
+
+GType TextListModel::get_column_type_vfunc(int index) const
+{
+	return m_record.types()[index];
+}
+
+void TextListModel::get_value_vfunc(const iterator& iter, int column, Glib::ValueBase& value) const
+{
+	int row = GetRowNumber(iter);
+	if( (row < 0) || (column < 0) || (column >= static_cast<int>(m_columns.size())) )
+		return;
+	
+	Glib::Value<Glib::ustring> text;
+	text.init(Glib::Value<Glib::ustring>::value_type());
+	text.set(GetText(row, column));
+	value.init(Glib::Value<Glib::ustring>::value_type());
+	value = text;
+}
+
+bool TextListModel::iter_next_vfunc(const iterator& iter, iterator& iter_next) const
+{
+	int row = GetRowNumber(iter);
+	if(row < 0)
+	{
+		iter_next = iterator();
+		return false;
+	}
+	return MakeIter(row + 1, iter_next);
+}
+
+//Rows never have children
+bool TextListModel::iter_children_vfunc(const iterator& /*parent*/, iterator& iter) const
+{
+	iter = iterator();
+	return false;
+}
+
+bool TextListModel::iter_has_child_vfunc(const iterator& /*iter*/) const
+{
+	return false;
+}
+
+int TextListModel::iter_n_children_vfunc(const iterator& /*iter*/) const
+{
+	return 0;
+}
+
+bool TextListModel::iter_nth_child_vfunc(const iterator& /*parent*/, int /*n*/, iterator& iter) const
+{
+	iter = iterator();
+	return false;
+}
+
+bool TextListModel::iter_parent_vfunc(const iterator& /*child*/, iterator& iter) const
+{
+	iter = iterator();
+	return false;
+}
+
+int TextListModel::iter_n_root_children_vfunc() const
+{
+	return GetRowCount();
+}
+
+bool TextListModel::iter_nth_root_child_vfunc(int n, iterator& iter) const
+{
+	return MakeIter(n, iter);
+}
+
+Gtk::TreeModel::Path TextListModel::get_path_vfunc(const iterator& iter) const
+{
+	Path path;
+	int row = GetRowNumber(iter);
+	if(row >= 0)
+		path.push_back(row);
+	return path;
+}
+
+bool TextListModel::get_iter_vfunc(const Path& path, iterator& iter) const
+{
+	if(path.size() != 1)
+	{
+		iter = iterator();
+		return false;
+	}
+	return MakeIter(path[0], iter);
+}
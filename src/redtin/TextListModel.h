@@ -0,0 +1,108 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file TextListModel.h
+	@author Andrew D. Zonenberg
+	@brief Base for flat list models whose rows live in some other container
+ */
+
+#ifndef TextListModel_h
+#define TextListModel_h
+
+#include <glibmm/object.h>
+#include <gtkmm/treemodel.h>
+#include <gtkmm/treemodelcolumn.h>
+
+#include <vector>
+
+/**
+	@brief A Gtk::TreeModel of text columns that reads its rows straight out of a container it doesn't own.
+	
+	Unlike a Gtk::ListStore nothing is copied, so views of thousands of rows cost nothing until rows are actually
+	drawn. Subclasses say how many rows there are and format each cell on demand, and call the Notify functions
+	after changing the container so that views update just the rows affected.
+	
+	Iterators hold the row number, so they're invalidated whenever a row is removed.
+	
+	Subclasses must initialize Glib::ObjectBase with their own typeid, since it's a virtual base and only the
+	most derived class's initializer counts; that's what registers the custom GType.
+ */
+class TextListModel : public Glib::Object, public Gtk::TreeModel
+{
+public:
+	/**
+		@brief A text column, for TreeView::append_column() and ComboBox::pack_start()
+	 */
+	const Gtk::TreeModelColumn<Glib::ustring>& GetColumn(int column) const
+	{ return m_columns[column]; }
+	
+	int GetRowNumber(const iterator& iter) const;
+	
+protected:
+	TextListModel(int ncolumns);
+	
+	virtual int GetRowCount() const =0;
+	virtual Glib::ustring GetText(int row, int column) const =0;
+	
+	void NotifyInserted(int row);
+	void NotifyChanged(int row);
+	void NotifyDeleted(int row);
+	
+	bool MakeIter(int row, iterator& iter) const;
+	
+	//Gtk::TreeModel implementation
+	virtual Gtk::TreeModelFlags get_flags_vfunc() const;
+	virtual int get_n_columns_vfunc() const;
+	virtual GType get_column_type_vfunc(int index) const;
+	virtual void get_value_vfunc(const iterator& iter, int column, Glib::ValueBase& value) const;
+	virtual bool iter_next_vfunc(const iterator& iter, iterator& iter_next) const;
+	virtual bool iter_children_vfunc(const iterator& parent, iterator& iter) const;
+	virtual bool iter_has_child_vfunc(const iterator& iter) const;
+	virtual int iter_n_children_vfunc(const iterator& iter) const;
+	virtual int iter_n_root_children_vfunc() const;
+	virtual bool iter_nth_child_vfunc(const iterator& parent, int n, iterator& iter) const;
+	virtual bool iter_nth_root_child_vfunc(int n, iterator& iter) const;
+	virtual bool iter_parent_vfunc(const iterator& child, iterator& iter) const;
+	virtual Path get_path_vfunc(const iterator& iter) const;
+	virtual bool get_iter_vfunc(const Path& path, iterator& iter) const;
+	
+	Gtk::TreeModelColumnRecord m_record;
+	std::vector< Gtk::TreeModelColumn<Glib::ustring> > m_columns;
+	
+	///Changed whenever iterators become invalid
+	int m_stamp;
+};
+
+#endif
@@ -0,0 +1,108 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file TriggerListModel.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of TriggerListModel
+ */
+
+#include "TriggerListModel.h"
+
+#include <stdio.h>
+
+using namespace std;
+
+static const char* g_edgenames[] = 
+{
+	"= 0",
+	"= 1",
+	"falling edge",
+	"rising edge",
+	"changes"
+};
+
+/**
+	@param triggers	The trigger conditions, which must outlive the model
+ */
+TriggerListModel::TriggerListModel(vector<Trigger>& triggers)
+: Glib::ObjectBase(typeid(TriggerListModel))
+, TextListModel(COLUMN_COUNT)
+, m_triggers(triggers)
+{
+}
+
+Glib::RefPtr<TriggerListModel> TriggerListModel::create(vector<Trigger>& triggers)
+{
+	return Glib::RefPtr<TriggerListModel>(new TriggerListModel(triggers));
+}
+
+void TriggerListModel::Append(const Trigger& trig)
+{
+	m_triggers.push_back(trig);
+	NotifyInserted(m_triggers.size() - 1);
+}
+
+void TriggerListModel::Erase(int row)
+{
+	m_triggers.erase(m_triggers.begin() + row);
+	NotifyDeleted(row);
+}
+
+int TriggerListModel::GetRowCount() const
+{
+	return m_triggers.size();
+}
+
+Glib::ustring TriggerListModel::GetText(int row, int column) const
+{
+	const Trigger& trig = m_triggers[row];
+	switch(column)
+	{
+		case COLUMN_SIGNAL:
+			return trig.signalname;
+		
+		case COLUMN_BIT:
+			{
+				char str[32];
+				snprintf(str, sizeof(str), "[%d]", trig.nbit);
+				return str;
+			}
+		
+		default:
+			if( (trig.triggertype < 0) || (trig.triggertype > Trigger::TRIGGER_TYPE_CHANGE) )
+				return "";
+			return g_edgenames[trig.triggertype];
+	}
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file TriggerListModel.h
+	@author Andrew D. Zonenberg
+	@brief List model over the trigger conditions
+ */
+
+#ifndef TriggerListModel_h
+#define TriggerListModel_h
+
+#include "TextListModel.h"
+#include "Trigger.h"
+
+#include <vector>
+
+/**
+	@brief Shows the trigger conditions in a list view without copying them, with columns for the signal, bit and
+	condition. All changes to the conditions must go through the model so views update incrementally.
+ */
+class TriggerListModel : public TextListModel
+{
+public:
+	static Glib::RefPtr<TriggerListModel> create(std::vector<Trigger>& triggers);
+	
+	enum Columns
+	{
+		COLUMN_SIGNAL,
+		COLUMN_BIT,
+		COLUMN_CONDITION,
+		
+		COLUMN_COUNT
+	};
+	
+	void Append(const Trigger& trig);
+	void Erase(int row);
+	
+protected:
+	TriggerListModel(std::vector<Trigger>& triggers);
+	
+	virtual int GetRowCount() const;
+	virtual Glib::ustring GetText(int row, int column) const;
+	
+	std::vector<Trigger>& m_triggers;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file ByteOrder.h
+	@author Andrew D. Zonenberg
+	@brief Helpers for reading and writing little-endian binary formats
+ */
+
+#ifndef ByteOrder_h
+#define ByteOrder_h
+
+#include <stdint.h>
+#include <string>
+
+static inline void AppendLE16(std::string& s, unsigned int v)
+{
+	s += static_cast<char>(v & 0xff);
+	s += static_cast<char>((v >> 8) & 0xff);
+}
+
+static inline void AppendLE32(std::string& s, uint32_t v)
+{
+	AppendLE16(s, v & 0xffff);
+	AppendLE16(s, v >> 16);
+}
+
+static inline void AppendLE64(std::string& s, uint64_t v)
+{
+	AppendLE32(s, v & 0xffffffff);
+	AppendLE32(s, v >> 32);
+}
+
+static inline uint16_t ReadLE16(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t ReadLE32(const unsigned char* p)
+{
+	return ReadLE16(p) | (static_cast<uint32_t>(ReadLE16(p + 2)) << 16);
+}
+
+static inline uint64_t ReadLE64(const unsigned char* p)
+{
+	return ReadLE32(p) | (static_cast<uint64_t>(ReadLE32(p + 4)) << 32);
+}
+
+#endif
@@ -0,0 +1,86 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CSVExporter.cpp
+	@author Andrew D. Zonenberg
+	@brief Comma-separated value export of signal values
+ */
+
+#include "CSVExporter.h"
+
+using namespace std;
+
+string CSVExporter::GetFormatName()
+{
+	return "csv";
+}
+
+string CSVExporter::GetFileExtension()
+{
+	return ".csv";
+}
+
+/**
+	@brief Writes one line per sample: sample number, time in ns, then the value of each signal.
+	
+	A run-length encoded capture has one line per stored sample, at the time it was taken.
+	
+	Single-bit signals are written as 0 or 1, buses as hex with a 0x prefix.
+ */
+bool CSVExporter::Export(const Capture& cap, FILE* fp)
+{
+	const vector<Signal>& signals = cap.GetSignals();
+	
+	fprintf(fp, "sample,time_ns");
+	for(size_t j=0; j<signals.size(); j++)
+		fprintf(fp, ",%s", signals[j].name.c_str());
+	fprintf(fp, "\n");
+	
+	double period = 1000.0 / cap.GetSampleRate();	//in ns
+	for(int i=0; i<cap.GetDepth(); i++)
+	{
+		fprintf(fp, "%d,%.3f", i, cap.GetSampleTime(i) * period);
+		for(size_t j=0; j<signals.size(); j++)
+		{
+			if(signals[j].width == 1)
+				fprintf(fp, ",%d", static_cast<int>(cap.GetColumnValue(j, i)[0] & 1));
+			else
+				fprintf(fp, ",0x%s", cap.FormatHex(j, i).c_str());
+		}
+		fprintf(fp, "\n");
+	}
+	
+	return (0 == ferror(fp));
+}
@@ -0,0 +1,427 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Capture.cpp
+	@author Andrew D. Zonenberg
+	@brief In-memory sample buffer for a single capture
+ */
+
+#include "Capture.h"
+#include "Sample.h"
+#include "Trigger.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace std;
+
+Capture::Capture(int width, int depth)
+: m_width(width)
+, m_depth(depth)
+, m_rowwords((width + 63) >> 6)
+, m_samples(m_rowwords * depth, 0)
+, m_samplerate(20)
+, m_timestamp(0)
+, m_confighash(0)
+, m_triggerclock(0)
+, m_triggerrow(0)
+{
+}
+
+/**
+	@brief Loads samples in the format sent by the capture module.
+	
+	Each row is width/8 bytes long and sent MSB first, so byte 0 holds the highest eight channels.
+ */
+void Capture::LoadRawSamples(const unsigned char* data, int depth)
+{
+	m_depth = depth;
+	m_samples.assign(m_rowwords * depth, 0);
+	m_times.clear();
+	
+	//Every board is a whole number of 128-channel cores, so rows are always whole words
+	uint64_t* rows = m_samples.empty() ? NULL : &m_samples[0];
+	switch( (m_width == 64*m_rowwords) ? m_rowwords : 0 )
+	{
+		case 2:
+			LoadRawRows<2>(data, depth, rows);
+			break;
+		case 4:
+			LoadRawRows<4>(data, depth, rows);
+			break;
+		case 8:
+			LoadRawRows<8>(data, depth, rows);
+			break;
+		case 16:
+			LoadRawRows<16>(data, depth, rows);
+			break;
+		
+		default:
+			{
+				int rowbytes = m_width / 8;
+				for(int i=0; i<depth; i++)
+				{
+					uint64_t* row = &m_samples[i * m_rowwords];
+					const unsigned char* src = data + i*rowbytes;
+					for(int j=0; j<rowbytes; j++)
+					{
+						int base = m_width - 8*(j+1);
+						row[base >> 6] |= static_cast<uint64_t>(src[j]) << (base & 63);
+					}
+				}
+			}
+			break;
+	}
+	
+	UpdateColumns();
+}
+
+/**
+	@brief Loads samples that are already packed
+ */
+void Capture::LoadRows(const uint64_t* rows, int depth)
+{
+	m_depth = depth;
+	m_samples.assign(rows, rows + m_rowwords * depth);
+	m_times.clear();
+	UpdateColumns();
+}
+
+/**
+	@brief Loads samples that are already packed by taking over the caller's buffer, which is left empty
+	
+	Saves a copy of the rows when they're very large.
+ */
+void Capture::TakeRows(std::vector<uint64_t>& rows, int depth)
+{
+	m_depth = depth;
+	m_samples.clear();
+	m_samples.swap(rows);
+	m_samples.resize(m_rowwords * depth);
+	m_times.clear();
+	UpdateColumns();
+}
+
+/**
+	@brief Sets how many capture clocks each row lasted, for a capture taken with run-length encoding
+	
+	@param runs		One run length per row. Zero (only ever seen in unwritten memory) is taken as one.
+ */
+void Capture::SetRunLengths(const uint32_t* runs)
+{
+	m_times.resize(m_depth + 1);
+	m_times[0] = 0;
+	for(int i=0; i<m_depth; i++)
+		m_times[i+1] = m_times[i] + ( (runs[i] == 0) ? 1 : runs[i] );
+}
+
+/**
+	@brief Makes a copy with every row repeated for as many clocks as it lasted, for formats that need
+	evenly spaced samples
+	
+	@param out			The expanded capture
+	@param maxdepth		Most rows to produce; anything after that is dropped
+ */
+void Capture::Expand(Capture& out, uint64_t maxdepth) const
+{
+	uint64_t depth = GetDuration();
+	if(depth > maxdepth)
+		depth = maxdepth;
+	
+	out = Capture(m_width, 0);
+	out.m_depth = depth;
+	out.m_samples.resize(m_rowwords * depth);
+	uint64_t pos = 0;
+	for(int i=0; (i < m_depth) && (pos < depth); i++)
+	{
+		for(uint32_t j=0; (j < GetRunLength(i)) && (pos < depth); j++, pos++)
+			copy(GetRow(i), GetRow(i) + m_rowwords, &out.m_samples[pos * m_rowwords]);
+	}
+	
+	out.m_samplerate = m_samplerate;
+	out.m_timestamp = m_timestamp;
+	out.m_confighash = m_confighash;
+	out.m_triggerclock = m_triggerclock;
+	if(m_triggerrow < m_depth)
+		out.m_triggerrow = min(GetSampleTime(m_triggerrow), depth);
+	out.SetSignals(m_signals);
+}
+
+/**
+	@brief Turns a timing capture into a state listing, with one row for each edge of a captured clock
+	
+	Each row is replaced by the value the inputs had just before the edge, which is what a flip-flop on that
+	clock would have latched. The sample rate becomes the average rate of the clock; individual edge times
+	are not kept, so the result is no longer run-length encoded.
+	
+	@param clockname	Signal to sample on. Only its lowest bit is used.
+	@param edge			Trigger::TRIGGER_TYPE_RISING, TRIGGER_TYPE_FALLING or TRIGGER_TYPE_CHANGE for both
+	
+	@return false, leaving the capture as it was, if there's no such signal or it has no edges
+ */
+bool Capture::SampleOnClock(std::string clockname, int edge)
+{
+	size_t nclock = 0;
+	while( (nclock < m_signals.size()) && (m_signals[nclock].name != clockname) )
+		nclock ++;
+	if(nclock == m_signals.size())
+	{
+		printf("state clock \"%s\" isn't one of the captured signals, keeping every sample\n", clockname.c_str());
+		return false;
+	}
+	int nword = m_signals[nclock].lowbit >> 6;
+	int shift = m_signals[nclock].lowbit & 63;
+	
+	//Find edges 64 rows at a time. The state row for an edge in row N is row N-1, which is never after
+	//the row it goes to, so rows can be packed down in place as we go.
+	int nstates = 0;
+	int triggerstate = 0;
+	uint64_t first = 0;
+	uint64_t last = 0;
+	uint64_t carry = 0;
+	for(int base=0; base<m_depth; base += 64)
+	{
+		int n = min(64, m_depth - base);
+		uint64_t clk = 0;
+		for(int j=0; j<n; j++)
+			clk |= ((GetRow(base + j)[nword] >> shift) & 1) << j;
+		
+		//Bit N of prev is the clock in the row before row N
+		uint64_t prev = (clk << 1) | carry;
+		carry = clk >> 63;
+		
+		uint64_t hits;
+		if(edge == Trigger::TRIGGER_TYPE_RISING)
+			hits = clk & ~prev;
+		else if(edge == Trigger::TRIGGER_TYPE_FALLING)
+			hits = ~clk & prev;
+		else
+			hits = clk ^ prev;
+		
+		//Nothing before the first row to have an edge from
+		if(base == 0)
+			hits &= ~static_cast<uint64_t>(1);
+		if(n < 64)
+			hits &= (static_cast<uint64_t>(1) << n) - 1;
+		
+		for(; hits != 0; hits &= hits - 1)
+		{
+			int row = base + __builtin_ctzll(hits);
+			if(nstates == 0)
+				first = GetSampleTime(row);
+			last = GetSampleTime(row);
+			copy(GetRow(row - 1), GetRow(row), &m_samples[nstates * m_rowwords]);
+			nstates ++;
+			
+			//The trigger lands in the first state latched after it
+			if(row <= m_triggerrow)
+				triggerstate = nstates;
+		}
+	}
+	
+	if(nstates == 0)
+	{
+		printf("state clock \"%s\" never has an edge, keeping every sample\n", clockname.c_str());
+		return false;
+	}
+	
+	if(last > first)
+		m_samplerate = m_samplerate * (nstates - 1) / (last - first);
+	m_depth = nstates;
+	m_triggerrow = min(triggerstate, nstates - 1);
+	m_samples.resize(m_rowwords * nstates);
+	m_times.clear();
+	UpdateColumns();
+	return true;
+}
+
+/**
+	@brief Sets the signal table. Every signal must already have its bit positions assigned.
+ */
+void Capture::SetSignals(const std::vector<Signal>& signals)
+{
+	m_signals = signals;
+	UpdateColumns();
+}
+
+/**
+	@brief Gets a row as width/8 bytes, least significant (channel 0) first.
+	
+	This is the layout used by sigrok and the raw binary exporter.
+ */
+void Capture::GetRowBytes(int row, unsigned char* out) const
+{
+	const uint64_t* p = GetRow(row);
+	for(int j=0; j<m_width/8; j++)
+		out[j] = (p[j >> 3] >> (8 * (j & 7))) & 0xff;
+}
+
+/**
+	@brief Pulls bits [lowbit + width - 1 : lowbit] out of a packed row
+	
+	@param row			The packed row
+	@param rowwords		Number of words in the row
+	@param lowbit		Lowest channel to extract
+	@param width		Number of channels to extract
+	@param out			(width+63)/64 words of output, LSB in word 0
+ */
+void Capture::ExtractBits(const uint64_t* row, int rowwords, int lowbit, int width, uint64_t* out)
+{
+	int nwords = (width + 63) >> 6;
+	for(int k=0; k<nwords; k++)
+	{
+		int offset = lowbit + 64*k;
+		int nword = offset >> 6;
+		int shift = offset & 63;
+		
+		uint64_t v = row[nword] >> shift;
+		if( (shift != 0) && (nword + 1 < rowwords) )
+			v |= row[nword + 1] << (64 - shift);
+		
+		//Mask off anything above the top bit of the signal
+		int bits_left = width - 64*k;
+		if(bits_left < 64)
+			v &= (static_cast<uint64_t>(1) << bits_left) - 1;
+		
+		out[k] = v;
+	}
+}
+
+void Capture::UpdateColumns()
+{
+	m_columns.clear();
+	m_columns.resize(m_signals.size());
+	for(size_t i=0; i<m_signals.size(); i++)
+		m_columns[i].resize(GetColumnWords(i) * m_depth);
+	
+	//Pull every signal out of a block of rows while the block is still in cache
+	const int block = 4096;
+	for(int base=0; base<m_depth; base += block)
+	{
+		for(size_t i=0; i<m_signals.size(); i++)
+			ExtractColumn(i, base, min(block, m_depth - base));
+	}
+}
+
+/**
+	@brief Fills in part of the column for one signal
+ */
+void Capture::ExtractColumn(size_t nsignal, int base, int count)
+{
+	const Signal& sig = m_signals[nsignal];
+	int nwords = GetColumnWords(nsignal);
+	const uint64_t* rows = GetRow(base);
+	uint64_t* out = &m_columns[nsignal][base * nwords];
+	
+	//Almost every signal fits in a word
+	switch( (nwords == 1) ? m_rowwords : 0 )
+	{
+		case 2:
+			ExtractNarrowColumn<2>(rows, count, sig.lowbit, sig.width, out);
+			break;
+		case 4:
+			ExtractNarrowColumn<4>(rows, count, sig.lowbit, sig.width, out);
+			break;
+		case 8:
+			ExtractNarrowColumn<8>(rows, count, sig.lowbit, sig.width, out);
+			break;
+		case 16:
+			ExtractNarrowColumn<16>(rows, count, sig.lowbit, sig.width, out);
+			break;
+		
+		default:
+			for(int j=0; j<count; j++)
+				ExtractBits(rows + j*m_rowwords, m_rowwords, sig.lowbit, sig.width, out + j*nwords);
+			break;
+	}
+}
+
+/**
+	@brief Checks if a signal has a different value at a given sample than at the one before it.
+	
+	The first sample always counts as a change.
+ */
+bool Capture::ColumnValueChanged(size_t nsignal, int row) const
+{
+	if(row == 0)
+		return true;
+	
+	int nwords = GetColumnWords(nsignal);
+	const uint64_t* a = GetColumnValue(nsignal, row);
+	const uint64_t* b = a - nwords;
+	for(int k=0; k<nwords; k++)
+	{
+		if(a[k] != b[k])
+			return true;
+	}
+	return false;
+}
+
+/**
+	@brief Formats the value of a signal as a binary string, MSB first
+ */
+string Capture::FormatBinary(size_t nsignal, int row) const
+{
+	int width = m_signals[nsignal].width;
+	const uint64_t* v = GetColumnValue(nsignal, row);
+	
+	string ret(width, '0');
+	for(int i=0; i<width; i++)
+	{
+		if( (v[i >> 6] >> (i & 63)) & 1 )
+			ret[width - 1 - i] = '1';
+	}
+	return ret;
+}
+
+/**
+	@brief Formats the value of a signal as a hex string, MSB first, with no prefix
+ */
+string Capture::FormatHex(size_t nsignal, int row) const
+{
+	static const char hex[] = "0123456789abcdef";
+	
+	int width = m_signals[nsignal].width;
+	const uint64_t* v = GetColumnValue(nsignal, row);
+	
+	int ndigits = (width + 3) / 4;
+	string ret(ndigits, '0');
+	for(int i=0; i<ndigits; i++)
+	{
+		int bit = 4*i;
+		ret[ndigits - 1 - i] = hex[(v[bit >> 6] >> (bit & 63)) & 0xf];
+	}
+	return ret;
+}
@@ -0,0 +1,223 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Capture.h
+	@author Andrew D. Zonenberg
+	@brief In-memory sample buffer for a single capture
+ */
+
+#ifndef Capture_h
+#define Capture_h
+
+#include "Signal.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+/**
+	@brief One capture worth of samples plus everything needed to interpret them.
+	
+	Samples are stored as packed rows of 64-bit words. Bit N of a row is channel din[N]: word 0 holds
+	channels 63...0, word 1 holds 127...64, and so on.
+	
+	Once both the samples and the signal table are present, the value of every signal at every sample is
+	extracted into a per-signal column so that exporters and analyses never have to pull bits out of the
+	rows themselves. Columns are only rebuilt by the non-const setters, so a fully loaded capture may be
+	read from several threads at once.
+	
+	A capture taken with run-length encoding has a run length for every row, the number of capture clocks
+	it lasted. Times are measured in capture clocks from the start of the first row; without run lengths
+	row N starts at time N.
+ */
+class Capture
+{
+public:
+	Capture(int width = 128, int depth = 512);
+	
+	void LoadRawSamples(const unsigned char* data, int depth);
+	void LoadRows(const uint64_t* rows, int depth);
+	void TakeRows(std::vector<uint64_t>& rows, int depth);
+	void SetSignals(const std::vector<Signal>& signals);
+	void SetRunLengths(const uint32_t* runs);
+	
+	/**
+		@brief Width of the capture, in channels
+	 */
+	int GetWidth() const
+	{ return m_width; }
+	
+	/**
+		@brief Number of samples in the capture
+	 */
+	int GetDepth() const
+	{ return m_depth; }
+	
+	/**
+		@brief Number of 64-bit words per packed row
+	 */
+	int GetRowWords() const
+	{ return m_rowwords; }
+	
+	const uint64_t* GetRow(int row) const
+	{ return &m_samples[row * m_rowwords]; }
+	
+	bool GetBit(int row, int bit) const
+	{ return (GetRow(row)[bit >> 6] >> (bit & 63)) & 1; }
+	
+	void GetRowBytes(int row, unsigned char* out) const;
+	
+	/**
+		@brief True if the capture was taken with run-length encoding
+	 */
+	bool IsRunLengthEncoded() const
+	{ return !m_times.empty(); }
+	
+	/**
+		@brief Time at which a row starts, in capture clocks. Row GetDepth() is the end of the capture.
+	 */
+	uint64_t GetSampleTime(int row) const
+	{ return m_times.empty() ? row : m_times[row]; }
+	
+	/**
+		@brief Start times of every row plus the end of the capture, or NULL if not run-length encoded
+	 */
+	const uint64_t* GetSampleTimes() const
+	{ return m_times.empty() ? NULL : &m_times[0]; }
+	
+	/**
+		@brief Number of capture clocks a row lasted
+	 */
+	uint32_t GetRunLength(int row) const
+	{ return GetSampleTime(row + 1) - GetSampleTime(row); }
+	
+	/**
+		@brief Length of the whole capture in capture clocks
+	 */
+	uint64_t GetDuration() const
+	{ return GetSampleTime(m_depth); }
+	
+	void Expand(Capture& out, uint64_t maxdepth) const;
+	bool SampleOnClock(std::string clockname, int edge);
+	
+	const std::vector<Signal>& GetSignals() const
+	{ return m_signals; }
+	
+	/**
+		@brief Number of 64-bit words per sample in the column for a signal
+	 */
+	int GetColumnWords(size_t nsignal) const
+	{ return (m_signals[nsignal].width + 63) >> 6; }
+	
+	/**
+		@brief Gets the value of a signal at a given sample, LSB in word 0
+	 */
+	const uint64_t* GetColumnValue(size_t nsignal, int row) const
+	{ return &m_columns[nsignal][row * GetColumnWords(nsignal)]; }
+	
+	bool ColumnValueChanged(size_t nsignal, int row) const;
+	
+	std::string FormatBinary(size_t nsignal, int row) const;
+	std::string FormatHex(size_t nsignal, int row) const;
+	
+	//Capture metadata
+	float GetSampleRate() const
+	{ return m_samplerate; }
+	void SetSampleRate(float mhz)
+	{ m_samplerate = mhz; }
+	
+	time_t GetTimestamp() const
+	{ return m_timestamp; }
+	void SetTimestamp(time_t t)
+	{ m_timestamp = t; }
+	
+	/**
+		@brief Hash of the signal and trigger configuration the capture was taken with
+	 */
+	uint64_t GetConfigHash() const
+	{ return m_confighash; }
+	void SetConfigHash(uint64_t hash)
+	{ m_confighash = hash; }
+	
+	/**
+		@brief Capture clock, counted from arming, at which a segment of a segmented capture triggered
+	 */
+	uint64_t GetTriggerClock() const
+	{ return m_triggerclock; }
+	void SetTriggerClock(uint64_t clock)
+	{ m_triggerclock = clock; }
+	
+	/**
+		@brief Row holding the sample the trigger fired on, or 0 if it isn't known (e.g. for imported captures)
+	 */
+	int GetTriggerRow() const
+	{ return m_triggerrow; }
+	void SetTriggerRow(int row)
+	{ m_triggerrow = row; }
+	
+	static void ExtractBits(const uint64_t* row, int rowwords, int lowbit, int width, uint64_t* out);
+	
+protected:
+	void UpdateColumns();
+	void ExtractColumn(size_t nsignal, int base, int count);
+
+	int m_width;
+	int m_depth;
+	int m_rowwords;
+	
+	///Packed sample rows, m_rowwords words each
+	std::vector<uint64_t> m_samples;
+	
+	///Start time of each row and the end of the capture, empty unless run-length encoded
+	std::vector<uint64_t> m_times;
+	
+	std::vector<Signal> m_signals;
+	
+	///Per-signal values at each sample
+	std::vector< std::vector<uint64_t> > m_columns;
+	
+	///Sample rate in MHz
+	float m_samplerate;
+	
+	///Time the capture was taken
+	time_t m_timestamp;
+	
+	uint64_t m_confighash;
+	
+	uint64_t m_triggerclock;
+	int m_triggerrow;
+};
+
+#endif
@@ -0,0 +1,611 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureArchive.cpp
+	@author Andrew D. Zonenberg
+	@brief On-disk history of past captures
+ */
+
+#include "CaptureArchive.h"
+#include "ByteOrder.h"
+#include "Checksum.h"
+#include "SampleCodec.h"
+#include "TriggerCompiler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char g_entrymagic[4] = {'R', 'T', 'C', 'A'};
+static const uint32_t g_entryversion = 1;
+static const char g_triggermagic[4] = {'T', 'R', 'I', 'G'};
+static const char g_triggerrowmagic[4] = {'T', 'R', 'O', 'W'};
+static const char g_summarymagic[4] = {'R', 'T', 'C', 'S'};
+static const uint32_t g_summaryversion = 1;
+
+///Widest capture an archive entry may claim, in channels
+static const int g_maxentrywidth = 65536;
+
+CaptureArchive::CaptureArchive(std::string dir)
+: m_dir(dir)
+, m_maxbytes(256 * 1024 * 1024)
+, m_maxage(30 * 24 * 60 * 60)
+{
+}
+
+/**
+	@brief Gets the default archive location, ~/.redtin/history
+ */
+string CaptureArchive::GetDefaultPath()
+{
+	const char* home = getenv("HOME");
+	if(home == NULL)
+		return "/tmp/redtin-history";
+	return string(home) + "/.redtin/history";
+}
+
+string CaptureArchive::GetEntryPath(int id)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/capture-%d.rtc", id);
+	return m_dir + name;
+}
+
+string CaptureArchive::GetSummaryPath(int id)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/capture-%d.rts", id);
+	return m_dir + name;
+}
+
+static void AppendSignals(string& data, const vector<Signal>& signals)
+{
+	AppendLE32(data, signals.size());
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		AppendLE32(data, signals[i].width);
+		AppendLE32(data, signals[i].lowbit);
+		AppendLE16(data, signals[i].name.length());
+		data += signals[i].name;
+	}
+}
+
+/**
+	@brief Reads a signal table written by AppendSignals()
+	
+	@param pos		Position of the table, moved past it
+	@param width	Width of the capture. Signals that don't fit inside it make the table invalid.
+ */
+static bool ReadSignals(const vector<unsigned char>& data, size_t& pos, int width, vector<Signal>& signals)
+{
+	if(pos + 4 > data.size())
+		return false;
+	size_t nsignals = ReadLE32(&data[pos]);
+	pos += 4;
+	for(size_t i=0; i<nsignals; i++)
+	{
+		if(pos + 10 > data.size())
+			return false;
+		int swidth = ReadLE32(&data[pos]);
+		int lowbit = ReadLE32(&data[pos + 4]);
+		size_t namelen = ReadLE16(&data[pos + 8]);
+		pos += 10;
+		if( (pos + namelen > data.size()) || (swidth < 1) || (lowbit < 0) || (swidth > width - lowbit) )
+			return false;
+		Signal sig(swidth, string(reinterpret_cast<const char*>(&data[pos]), namelen));
+		sig.lowbit = lowbit;
+		sig.highbit = lowbit + swidth - 1;
+		signals.push_back(sig);
+		pos += namelen;
+	}
+	return true;
+}
+
+static bool ReadFile(string path, vector<unsigned char>& data)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if(fp == NULL)
+		return false;
+	unsigned char buf[4096];
+	size_t len;
+	while( (len = fread(buf, 1, sizeof(buf), fp)) > 0)
+		data.insert(data.end(), buf, buf + len);
+	fclose(fp);
+	return true;
+}
+
+/**
+	@brief Writes a file under a temporary name, then moves it into place so readers never see half of it
+ */
+static bool WriteFileAtomic(string path, const string& data)
+{
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%d.new", static_cast<int>(getpid()));
+	string tmppath = path + suffix;
+	
+	FILE* fp = fopen(tmppath.c_str(), "wb");
+	if(fp == NULL)
+		return false;
+	bool ok = (data.length() == fwrite(data.c_str(), 1, data.length(), fp));
+	if(0 != fclose(fp))
+		ok = false;
+	if(ok)
+		ok = (0 == rename(tmppath.c_str(), path.c_str()));
+	if(!ok)
+		unlink(tmppath.c_str());
+	return ok;
+}
+
+/**
+	@brief Creates the archive directory if needed and takes the archive lock
+	
+	@return The lock file descriptor, or -1 on failure
+ */
+int CaptureArchive::LockIndex()
+{
+	//Create the directory and its parent (for ~/.redtin/history)
+	size_t slash = m_dir.rfind('/');
+	if( (slash != string::npos) && (slash != 0) )
+		mkdir(m_dir.substr(0, slash).c_str(), 0755);
+	if( (0 != mkdir(m_dir.c_str(), 0755)) && (errno != EEXIST) )
+	{
+		perror("couldn't create archive directory");
+		return -1;
+	}
+	
+	string lockpath = m_dir + "/lock";
+	int fd = open(lockpath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if(fd < 0)
+	{
+		perror("couldn't open archive lock");
+		return -1;
+	}
+	if(0 != flock(fd, LOCK_EX))
+	{
+		perror("couldn't lock archive");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void CaptureArchive::UnlockIndex(int fd)
+{
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/**
+	@brief Reloads the index, picking up captures stored by other processes
+ */
+bool CaptureArchive::Refresh()
+{
+	int lock = LockIndex();
+	if(lock < 0)
+		return false;
+	bool ok = ReadIndex();
+	UnlockIndex(lock);
+	return ok;
+}
+
+bool CaptureArchive::ReadIndex()
+{
+	m_entries.clear();
+	
+	string path = m_dir + "/index";
+	FILE* fp = fopen(path.c_str(), "r");
+	
+	//No index yet, empty archive
+	if(fp == NULL)
+		return (errno == ENOENT);
+	
+	char line[256];
+	while(fgets(line, sizeof(line), fp))
+	{
+		if(line[0] == '#')
+			continue;
+			
+		ArchiveEntry entry;
+		unsigned long long hash;
+		long long timestamp;
+		if(7 != sscanf(line, "%d %lld %llx %f %d %d %ld",
+			&entry.id, &timestamp, &hash, &entry.samplerate, &entry.width, &entry.depth, &entry.filesize))
+		{
+			printf("bad line in archive index, skipping\n");
+			continue;
+		}
+		entry.timestamp = timestamp;
+		entry.confighash = hash;
+		m_entries.push_back(entry);
+	}
+	
+	fclose(fp);
+	return true;
+}
+
+bool CaptureArchive::WriteIndex()
+{
+	string path = m_dir + "/index";
+	string tmppath = path + ".new";
+	FILE* fp = fopen(tmppath.c_str(), "w");
+	if(fp == NULL)
+	{
+		perror("couldn't write archive index");
+		return false;
+	}
+	
+	fprintf(fp, "# id timestamp confighash samplerate width depth filesize\n");
+	for(size_t i=0; i<m_entries.size(); i++)
+	{
+		ArchiveEntry& entry = m_entries[i];
+		fprintf(fp, "%d %lld %016llx %.6f %d %d %ld\n",
+			entry.id,
+			static_cast<long long>(entry.timestamp),
+			static_cast<unsigned long long>(entry.confighash),
+			entry.samplerate,
+			entry.width,
+			entry.depth,
+			entry.filesize);
+	}
+	
+	if(0 != fclose(fp))
+		return false;
+	return (0 == rename(tmppath.c_str(), path.c_str()));
+}
+
+/**
+	@brief Adds a capture to the archive, then prunes old captures as needed
+	
+	@return ID of the new entry, or -1 on failure
+ */
+int CaptureArchive::Store(const Capture& cap)
+{
+	//Format the entry
+	string data(g_entrymagic, 4);
+	AppendLE32(data, g_entryversion);
+	AppendLE64(data, cap.GetConfigHash());
+	AppendLE64(data, cap.GetTimestamp());
+	float rate = cap.GetSampleRate();
+	uint32_t ratebits;
+	memcpy(&ratebits, &rate, 4);
+	AppendLE32(data, ratebits);
+	AppendLE32(data, cap.GetWidth());
+	AppendLE32(data, cap.GetDepth());
+	
+	AppendSignals(data, cap.GetSignals());
+	
+	vector<unsigned char> samples;
+	CompressSamples(cap, samples);
+	AppendLE32(data, samples.size());
+	AppendLE32(data, CRC32(&samples[0], samples.size()));
+	data.append(reinterpret_cast<const char*>(&samples[0]), samples.size());
+	
+	//Run lengths, if any. Older versions stop reading after the samples, so they still work.
+	if(cap.IsRunLengthEncoded())
+	{
+		AppendLE32(data, cap.GetDepth());
+		for(int i=0; i<cap.GetDepth(); i++)
+			AppendLE32(data, cap.GetRunLength(i));
+	}
+	
+	//Trigger clock of a segment, tagged so it can't be mistaken for the run lengths
+	if(cap.GetTriggerClock() != 0)
+	{
+		data.append(g_triggermagic, 4);
+		AppendLE64(data, cap.GetTriggerClock());
+	}
+	
+	//Row the trigger fired on, for lining captures up
+	if(cap.GetTriggerRow() != 0)
+	{
+		data.append(g_triggerrowmagic, 4);
+		AppendLE32(data, cap.GetTriggerRow());
+	}
+	
+	int lock = LockIndex();
+	if(lock < 0)
+		return -1;
+	if(!ReadIndex())
+	{
+		UnlockIndex(lock);
+		return -1;
+	}
+	
+	ArchiveEntry entry;
+	entry.id = m_entries.empty() ? 1 : (m_entries[m_entries.size() - 1].id + 1);
+	entry.timestamp = cap.GetTimestamp();
+	entry.confighash = cap.GetConfigHash();
+	entry.samplerate = cap.GetSampleRate();
+	entry.width = cap.GetWidth();
+	entry.depth = cap.GetDepth();
+	entry.filesize = data.length();
+	
+	//Write the capture file, then add it to the index
+	string path = GetEntryPath(entry.id);
+	FILE* fp = fopen(path.c_str(), "wb");
+	bool ok = (fp != NULL);
+	if(ok)
+	{
+		ok = (data.length() == fwrite(data.c_str(), 1, data.length(), fp));
+		if(0 != fclose(fp))
+			ok = false;
+	}
+	if(!ok)
+	{
+		perror("couldn't write archive entry");
+		unlink(path.c_str());
+		UnlockIndex(lock);
+		return -1;
+	}
+	
+	//Summary for searches. If this fails it's rebuilt the first time it's needed.
+	CaptureSummary summary;
+	summary.Build(cap);
+	if(!WriteSummary(entry.id, summary))
+		perror("couldn't write archive summary");
+	
+	m_entries.push_back(entry);
+	PruneLocked();
+	ok = WriteIndex();
+	UnlockIndex(lock);
+	
+	return ok ? entry.id : -1;
+}
+
+/**
+	@brief Deletes captures that are over the age or size limits
+ */
+bool CaptureArchive::Prune()
+{
+	int lock = LockIndex();
+	if(lock < 0)
+		return false;
+	bool ok = ReadIndex();
+	if(ok)
+	{
+		PruneLocked();
+		ok = WriteIndex();
+	}
+	UnlockIndex(lock);
+	return ok;
+}
+
+bool CaptureArchive::PruneLocked()
+{
+	long total = 0;
+	for(size_t i=0; i<m_entries.size(); i++)
+		total += m_entries[i].filesize;
+	
+	//Entries are in order of age, oldest first. Always keep the newest one.
+	time_t now = time(NULL);
+	size_t ndelete = 0;
+	while(ndelete + 1 < m_entries.size())
+	{
+		ArchiveEntry& entry = m_entries[ndelete];
+		bool too_big = (m_maxbytes > 0) && (total > m_maxbytes);
+		bool too_old = (m_maxage > 0) && (now - entry.timestamp > m_maxage);
+		if(!too_big && !too_old)
+			break;
+		
+		unlink(GetEntryPath(entry.id).c_str());
+		unlink(GetSummaryPath(entry.id).c_str());
+		total -= entry.filesize;
+		ndelete ++;
+	}
+	
+	m_entries.erase(m_entries.begin(), m_entries.begin() + ndelete);
+	return true;
+}
+
+/**
+	@brief Reads a capture back from the archive
+ */
+bool CaptureArchive::Load(int id, Capture& cap)
+{
+	vector<unsigned char> data;
+	if(!ReadFile(GetEntryPath(id), data))
+	{
+		printf("no capture %d in archive\n", id);
+		return false;
+	}
+	
+	//Fixed size part of the header
+	if( (data.size() < 40) || (0 != memcmp(&data[0], g_entrymagic, 4)) || (ReadLE32(&data[4]) != g_entryversion) )
+	{
+		printf("capture %d is not a valid archive entry\n", id);
+		return false;
+	}
+	uint64_t hash = ReadLE64(&data[8]);
+	time_t timestamp = ReadLE64(&data[16]);
+	uint32_t ratebits = ReadLE32(&data[24]);
+	float rate;
+	memcpy(&rate, &ratebits, 4);
+	int width = ReadLE32(&data[28]);
+	int depth = ReadLE32(&data[32]);
+	
+	//The CRC only covers the samples, so the sizes have to be sane before anything is allocated from them
+	if( (width <= 0) || (width % CORE_WIDTH != 0) || (width > g_maxentrywidth) || (depth <= 0) )
+	{
+		printf("capture %d has a corrupted header\n", id);
+		return false;
+	}
+	
+	//Signal table
+	size_t pos = 36;
+	vector<Signal> signals;
+	if(!ReadSignals(data, pos, width, signals))
+	{
+		printf("capture %d has a corrupted signal table\n", id);
+		return false;
+	}
+	
+	//Samples
+	if(pos + 8 > data.size())
+	{
+		printf("capture %d is truncated\n", id);
+		return false;
+	}
+	size_t complen = ReadLE32(&data[pos]);
+	uint32_t crc = ReadLE32(&data[pos + 4]);
+	pos += 8;
+	if( (pos + complen > data.size()) || (crc != CRC32(&data[pos], complen)) )
+	{
+		printf("capture %d is corrupted\n", id);
+		return false;
+	}
+	
+	//An LZ4 block can't expand by more than 255 times, so a depth that would need more is a bad header
+	if(static_cast<uint64_t>(depth) * (width / 8) > 255 * static_cast<uint64_t>(complen) + 255)
+	{
+		printf("capture %d has a corrupted header\n", id);
+		return false;
+	}
+	
+	cap = Capture(width, depth);
+	if(!DecompressSamples(&data[pos], complen, cap))
+	{
+		printf("capture %d is corrupted\n", id);
+		return false;
+	}
+	pos += complen;
+	if( (pos + 4 <= data.size()) && (0 != memcmp(&data[pos], g_triggermagic, 4)) &&
+		(0 != memcmp(&data[pos], g_triggerrowmagic, 4)) )
+	{
+		size_t nruns = ReadLE32(&data[pos]);
+		pos += 4;
+		if( (nruns != static_cast<size_t>(depth)) || (pos + 4*nruns > data.size()) )
+		{
+			printf("capture %d is truncated\n", id);
+			return false;
+		}
+		vector<uint32_t> runs(nruns);
+		for(size_t i=0; i<nruns; i++)
+			runs[i] = ReadLE32(&data[pos + 4*i]);
+		if(!runs.empty())
+			cap.SetRunLengths(&runs[0]);
+		pos += 4*nruns;
+	}
+	if( (pos + 12 <= data.size()) && (0 == memcmp(&data[pos], g_triggermagic, 4)) )
+	{
+		cap.SetTriggerClock(ReadLE64(&data[pos + 4]));
+		pos += 12;
+	}
+	if( (pos + 8 <= data.size()) && (0 == memcmp(&data[pos], g_triggerrowmagic, 4)) )
+	{
+		int row = ReadLE32(&data[pos + 4]);
+		if(row < depth)
+			cap.SetTriggerRow(row);
+	}
+	cap.SetSignals(signals);
+	cap.SetSampleRate(rate);
+	cap.SetTimestamp(timestamp);
+	cap.SetConfigHash(hash);
+	return true;
+}
+
+bool CaptureArchive::WriteSummary(int id, const CaptureSummary& summary)
+{
+	string data(g_summarymagic, 4);
+	AppendLE32(data, g_summaryversion);
+	AppendLE32(data, summary.width);
+	AppendLE32(data, summary.depth);
+	AppendSignals(data, summary.signals);
+	
+	int rowwords = summary.GetRowWords();
+	for(int w=0; w<rowwords; w++)
+	{
+		AppendLE64(data, summary.everhigh[w]);
+		AppendLE64(data, summary.alwayshigh[w]);
+		AppendLE64(data, summary.rising[w]);
+		AppendLE64(data, summary.falling[w]);
+	}
+	for(size_t i=0; i<summary.lanevalues.size(); i++)
+		AppendLE64(data, summary.lanevalues[i]);
+	AppendLE32(data, CRC32(data.c_str(), data.length()));
+	
+	return WriteFileAtomic(GetSummaryPath(id), data);
+}
+
+/**
+	@brief Reads the summary of an archived capture, for ruling it out of a search without loading it
+	
+	Captures archived before summaries existed (or whose summary is damaged) are loaded once to make one.
+	
+	@return false if neither the summary nor the capture could be read
+ */
+bool CaptureArchive::LoadSummary(int id, CaptureSummary& summary)
+{
+	vector<unsigned char> data;
+	if(ReadFile(GetSummaryPath(id), data) && (data.size() > 20) && (0 == memcmp(&data[0], g_summarymagic, 4)) &&
+		(ReadLE32(&data[4]) == g_summaryversion) &&
+		(ReadLE32(&data[data.size() - 4]) == CRC32(&data[0], data.size() - 4)) )
+	{
+		summary = CaptureSummary();
+		summary.width = ReadLE32(&data[8]);
+		summary.depth = ReadLE32(&data[12]);
+		size_t pos = 16;
+		int rowwords = summary.GetRowWords();
+		size_t nlanewords = rowwords * 8 * 4;
+		if( (rowwords > 0) && (summary.width <= g_maxentrywidth) &&
+			ReadSignals(data, pos, summary.width, summary.signals) &&
+			(pos + 8*(4*rowwords + nlanewords) + 4 == data.size()) )
+		{
+			for(int w=0; w<rowwords; w++, pos += 32)
+			{
+				summary.everhigh.push_back(ReadLE64(&data[pos]));
+				summary.alwayshigh.push_back(ReadLE64(&data[pos + 8]));
+				summary.rising.push_back(ReadLE64(&data[pos + 16]));
+				summary.falling.push_back(ReadLE64(&data[pos + 24]));
+			}
+			for(size_t i=0; i<nlanewords; i++, pos += 8)
+				summary.lanevalues.push_back(ReadLE64(&data[pos]));
+			return true;
+		}
+	}
+	
+	Capture cap;
+	if(!Load(id, cap))
+		return false;
+	summary.Build(cap);
+	WriteSummary(id, summary);
+	return true;
+}
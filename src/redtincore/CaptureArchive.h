@@ -0,0 +1,133 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureArchive.h
+	@author Andrew D. Zonenberg
+	@brief On-disk history of past captures
+ */
+
+#ifndef CaptureArchive_h
+#define CaptureArchive_h
+
+#include "Capture.h"
+#include "CaptureSummary.h"
+
+#include <string>
+#include <vector>
+
+/**
+	@brief Summary of one archived capture, as kept in the archive index
+ */
+class ArchiveEntry
+{
+public:
+	int id;
+	time_t timestamp;
+	uint64_t confighash;
+	float samplerate;
+	int width;
+	int depth;
+	long filesize;
+};
+
+/**
+	@brief A directory of compressed captures plus a text index of them.
+	
+	Each capture is stored in its own file (capture-N.rtc) holding the metadata, the signal table, the
+	compressed samples, the run lengths of run-length encoded captures, the trigger clock of segments
+	of a segmented capture and the row the trigger fired on. Next to it is a summary (capture-N.rts) that searches check before loading
+	the capture. The index has one line per capture so listing the archive never touches the
+	capture files. Whenever a capture is stored the oldest ones are deleted until the archive is within
+	its size and age limits.
+	
+	The index is locked while it is being modified, so several processes can share one archive.
+ */
+class CaptureArchive
+{
+public:
+	CaptureArchive(std::string dir);
+	
+	static std::string GetDefaultPath();
+	
+	std::string GetPath() const
+	{ return m_dir; }
+	void SetPath(std::string dir)
+	{
+		m_dir = dir;
+		m_entries.clear();
+	}
+	
+	void SetLimits(long maxbytes, long maxage)
+	{
+		m_maxbytes = maxbytes;
+		m_maxage = maxage;
+	}
+	long GetMaxBytes() const
+	{ return m_maxbytes; }
+	long GetMaxAge() const
+	{ return m_maxage; }
+	
+	bool Refresh();
+	const std::vector<ArchiveEntry>& GetEntries() const
+	{ return m_entries; }
+	
+	int Store(const Capture& cap);
+	bool Load(int id, Capture& cap);
+	bool LoadSummary(int id, CaptureSummary& summary);
+	bool Prune();
+	
+	std::string GetEntryPath(int id);
+	std::string GetSummaryPath(int id);
+	
+protected:
+	int LockIndex();
+	void UnlockIndex(int fd);
+	bool ReadIndex();
+	bool WriteIndex();
+	bool PruneLocked();
+	bool WriteSummary(int id, const CaptureSummary& summary);
+
+	std::string m_dir;
+	
+	///Limit on total size of the capture files, in bytes (0 = unlimited)
+	long m_maxbytes;
+	
+	///Limit on age of captures, in seconds (0 = unlimited)
+	long m_maxage;
+	
+	std::vector<ArchiveEntry> m_entries;
+};
+
+#endif
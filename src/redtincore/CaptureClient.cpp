@@ -0,0 +1,386 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureClient.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of CaptureClient
+ */
+
+#include "CaptureClient.h"
+#include "RedTinDevice.h"
+#include "TriggerCompiler.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CaptureResult
+
+CaptureResult::CaptureResult()
+: rows(NULL)
+, runs(NULL)
+, width(0)
+, depth(0)
+, samplerate(0)
+, timestamp(0)
+, confighash(0)
+, triggerclock(0)
+, triggerrow(0)
+, m_map(NULL)
+, m_maplen(0)
+{
+}
+
+CaptureResult::~CaptureResult()
+{
+	Release();
+}
+
+/**
+	@brief Maps the sample rows out of a result file. The descriptor is not closed.
+ */
+bool CaptureResult::Map(int fd, size_t len)
+{
+	Release();
+	
+	struct stat st;
+	if(0 != fstat(fd, &st))
+	{
+		perror("couldn't stat capture result");
+		return false;
+	}
+	if( (len == 0) || (static_cast<size_t>(st.st_size) < len) )
+	{
+		printf("capture result is truncated\n");
+		return false;
+	}
+	
+	void* map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if(map == MAP_FAILED)
+	{
+		perror("couldn't map capture result");
+		return false;
+	}
+	
+	m_map = map;
+	m_maplen = len;
+	rows = static_cast<const uint64_t*>(map);
+	return true;
+}
+
+void CaptureResult::Release()
+{
+	if(m_map != NULL)
+		munmap(m_map, m_maplen);
+	m_map = NULL;
+	m_maplen = 0;
+	rows = NULL;
+	runs = NULL;
+}
+
+/**
+	@brief Copies the result into a Capture. Signals are not set.
+ */
+void CaptureResult::ToCapture(Capture& cap) const
+{
+	cap = Capture(width, depth);
+	cap.LoadRows(rows, depth);
+	if(runs != NULL)
+		cap.SetRunLengths(runs);
+	cap.SetSampleRate(samplerate);
+	cap.SetTimestamp(timestamp);
+	cap.SetConfigHash(confighash);
+	cap.SetTriggerClock(triggerclock);
+	if(triggerrow < depth)
+		cap.SetTriggerRow(triggerrow);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CaptureClient
+
+CaptureClient::CaptureClient()
+: m_fd(-1)
+{
+}
+
+CaptureClient::~CaptureClient()
+{
+	Close();
+}
+
+/**
+	@brief Gets the socket redtind listens on: $REDTIND_SOCKET, or /tmp/redtind.sock if that's not set
+ */
+string CaptureClient::GetDefaultPath()
+{
+	const char* path = getenv("REDTIND_SOCKET");
+	if( (path == NULL) || (path[0] == '\0') )
+		return "/tmp/redtind.sock";
+	return path;
+}
+
+/**
+	@brief Connects to the server
+	
+	@return false if no server is running there
+ */
+bool CaptureClient::Connect(string path)
+{
+	Close();
+	
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(path.length() >= sizeof(addr.sun_path))
+	{
+		m_error = "socket path too long";
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	
+	m_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if(m_fd < 0)
+	{
+		m_error = string("couldn't create socket: ") + strerror(errno);
+		return false;
+	}
+	if(0 != connect(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+	{
+		m_error = string("couldn't connect to ") + path + ": " + strerror(errno);
+		Close();
+		return false;
+	}
+	
+	return true;
+}
+
+void CaptureClient::Close()
+{
+	if(m_fd >= 0)
+		close(m_fd);
+	m_fd = -1;
+}
+
+bool CaptureClient::SendCommand(string command, const CaptureConfig* config)
+{
+	string msg = command + "\n";
+	if(config != NULL)
+		msg += config->Format();
+	if(msg.length() > CAPTURE_SERVER_MAX_MESSAGE)
+	{
+		m_error = "configuration too large";
+		return false;
+	}
+	
+	if(static_cast<ssize_t>(msg.length()) != send(m_fd, msg.c_str(), msg.length(), MSG_NOSIGNAL))
+	{
+		m_error = string("couldn't send to server: ") + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Queues one capture. The result is picked up with WaitResult().
+ */
+bool CaptureClient::RequestCapture(const CaptureConfig& config)
+{
+	return SendCommand("CAPTURE", &config);
+}
+
+/**
+	@brief Asks for a capture with this configuration every time the analyzer comes free
+	
+	Replaces any previous subscription. Each capture is picked up with WaitResult().
+ */
+bool CaptureClient::Subscribe(const CaptureConfig& config)
+{
+	return SendCommand("SUBSCRIBE", &config);
+}
+
+/**
+	@brief Stops a subscription. Results for captures already in progress may still arrive.
+ */
+bool CaptureClient::Unsubscribe()
+{
+	return SendCommand("UNSUBSCRIBE", NULL);
+}
+
+/**
+	@brief Blocks until the next result arrives and maps it
+	
+	@return false if the capture failed (see GetError()) or the connection was lost
+ */
+bool CaptureClient::WaitResult(CaptureResult& result)
+{
+	result.Release();
+	
+	char buf[CAPTURE_SERVER_MAX_MESSAGE + 1];
+	char control[CMSG_SPACE(sizeof(int))];
+	iovec iov;
+	iov.iov_base = buf;
+	iov.iov_len = CAPTURE_SERVER_MAX_MESSAGE;
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	
+	ssize_t len = recvmsg(m_fd, &msg, MSG_CMSG_CLOEXEC);
+	if(len <= 0)
+	{
+		m_error = (len == 0) ? "server closed the connection" : string("couldn't receive from server: ") + strerror(errno);
+		return false;
+	}
+	buf[len] = '\0';
+	
+	//Pick up the result file, if there is one
+	int fd = -1;
+	for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if( (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS) )
+			memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+	}
+	
+	bool ok = false;
+	if(0 == strncmp(buf, "ERROR ", 6))
+		m_error = string(buf + 6, strcspn(buf + 6, "\n"));
+	else
+	{
+		int width;
+		int depth;
+		float samplerate;
+		long long timestamp;
+		unsigned long long hash;
+		int rle = 0;
+		unsigned long long triggerclock = 0;
+		int triggerrow = 0;
+		
+		//Older servers don't say whether there are run lengths or when and where the segment triggered
+		if( (5 > sscanf(buf, "RESULT %d %d %f %lld %llx %d %llu %d", &width, &depth, &samplerate, &timestamp, &hash,
+			&rle, &triggerclock, &triggerrow)) ||
+			(width <= 0) || (depth <= 0) || (fd < 0) )
+		{
+			m_error = "malformed reply from server";
+		}
+		else if(result.Map(fd, (static_cast<size_t>(depth) * ((width + 63) / 64) * sizeof(uint64_t)) +
+			(rle ? depth * sizeof(uint32_t) : 0)))
+		{
+			//Run lengths follow the rows
+			if(rle)
+				result.runs = reinterpret_cast<const uint32_t*>(result.rows + depth * ((width + 63) / 64));
+			result.width = width;
+			result.depth = depth;
+			result.samplerate = samplerate;
+			result.timestamp = timestamp;
+			result.confighash = hash;
+			result.triggerclock = triggerclock;
+			result.triggerrow = triggerrow;
+			ok = true;
+		}
+		else
+			m_error = "couldn't map capture result";
+	}
+	
+	if(fd >= 0)
+		close(fd);
+	return ok;
+}
+
+/**
+	@brief Does one complete capture through the server and sets up the signals from the config
+	
+	Must not be mixed with a subscription on the same connection, or the results will be confused.
+ */
+bool CaptureClient::RunCapture(const CaptureConfig& config, Capture& cap)
+{
+	if(config.GetSegmentCount() != 1)
+	{
+		m_error = "segmented captures have to be read into a list of captures";
+		return false;
+	}
+	if(!RequestCapture(config))
+		return false;
+	
+	CaptureResult result;
+	if(!WaitResult(result))
+		return false;
+	result.ToCapture(cap);
+	
+	std::vector<Signal> signals = config.signals;
+	AssignSignalBits(signals, cap.GetWidth());
+	cap.SetSignals(signals);
+	return true;
+}
+
+/**
+	@brief Does one complete capture through the server with one Capture per segment
+ */
+bool CaptureClient::RunCapture(const CaptureConfig& config, std::vector<Capture>& caps)
+{
+	if(!RedTinDevice::IsValidSegmentCount(config.GetSegmentCount()))
+	{
+		char msg[64];
+		snprintf(msg, sizeof(msg), "segment count must be a power of two from 1 to %d", RedTinDevice::MAX_SEGMENTS);
+		m_error = msg;
+		return false;
+	}
+	if(!RequestCapture(config))
+		return false;
+	
+	caps.resize(config.GetSegmentCount());
+	for(size_t i=0; i<caps.size(); i++)
+	{
+		CaptureResult result;
+		if(!WaitResult(result))
+			return false;
+		result.ToCapture(caps[i]);
+		
+		std::vector<Signal> signals = config.signals;
+		AssignSignalBits(signals, caps[i].GetWidth());
+		caps[i].SetSignals(signals);
+	}
+	return true;
+}
@@ -0,0 +1,155 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureClient.h
+	@author Andrew D. Zonenberg
+	@brief Client for the redtind capture server
+ */
+
+#ifndef CaptureClient_h
+#define CaptureClient_h
+
+#include "Capture.h"
+#include "CaptureConfig.h"
+
+#include <string>
+
+///Largest message either side of the capture server protocol will send
+#define CAPTURE_SERVER_MAX_MESSAGE 65536
+
+/**
+	@brief The result of one capture done by the server, mapped straight out of the memory it was written to.
+	
+	Not copyable; the mapping goes away when the result is destroyed or reused.
+ */
+class CaptureResult
+{
+public:
+	CaptureResult();
+	~CaptureResult();
+	
+	bool Map(int fd, size_t len);
+	void Release();
+	
+	void ToCapture(Capture& cap) const;
+	
+	///Packed sample rows, depth * ((width+63)/64) words, laid out as in Capture
+	const uint64_t* rows;
+	
+	///How many capture clocks each row lasted, or NULL if the capture isn't run-length encoded
+	const uint32_t* runs;
+	
+	int width;
+	int depth;
+	float samplerate;
+	time_t timestamp;
+	uint64_t confighash;
+	
+	///Capture clock at which the segment triggered, for segmented captures
+	uint64_t triggerclock;
+	
+	///Row the trigger fired on
+	int triggerrow;
+	
+protected:
+	void* m_map;
+	size_t m_maplen;
+	
+private:
+	CaptureResult(const CaptureResult&);
+	CaptureResult& operator=(const CaptureResult&);
+};
+
+/**
+	@brief Connection to redtind, which owns the analyzer and runs captures for any number of clients.
+	
+	The connection is a SOCK_SEQPACKET Unix socket. Each message is a command line, optionally followed by
+	a signal configuration in .scfg format:
+	
+		CAPTURE\n<config>		one capture with this configuration
+		SUBSCRIBE\n<config>		capture with this configuration over and over until unsubscribed
+		UNSUBSCRIBE\n
+	
+	The server answers each capture with either
+	
+		RESULT <width> <depth> <sample rate> <timestamp> <config hash> <rle> <trigger clock> <trigger row>\n
+	
+	plus a file descriptor (SCM_RIGHTS) for a sealed in-memory file holding the packed sample rows
+	followed, if rle is 1, by a 32-bit run length for each row. A segmented capture (SEGMENTS in the
+	config) gets one RESULT per segment, in order. Or
+	
+		ERROR <message>\n
+	
+	Results for one client arrive in the order the captures were requested. Clients subscribed to the
+	same configuration all get the same capture.
+ */
+class CaptureClient
+{
+public:
+	CaptureClient();
+	~CaptureClient();
+	
+	static std::string GetDefaultPath();
+	
+	bool Connect(std::string path = GetDefaultPath());
+	void Close();
+	
+	bool IsConnected() const
+	{ return (m_fd >= 0); }
+	
+	///Socket descriptor, readable whenever a result is waiting
+	int GetFD() const
+	{ return m_fd; }
+	
+	bool RequestCapture(const CaptureConfig& config);
+	bool Subscribe(const CaptureConfig& config);
+	bool Unsubscribe();
+	
+	bool WaitResult(CaptureResult& result);
+	
+	bool RunCapture(const CaptureConfig& config, Capture& cap);
+	bool RunCapture(const CaptureConfig& config, std::vector<Capture>& caps);
+	
+	std::string GetError() const
+	{ return m_error; }
+	
+protected:
+	bool SendCommand(std::string command, const CaptureConfig* config);
+
+	int m_fd;
+	std::string m_error;
+};
+
+#endif
@@ -0,0 +1,582 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureConfig.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of CaptureConfig
+ */
+
+#include "CaptureConfig.h"
+#include "ByteOrder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/**
+	@brief Parses one event of a measurement, e.g. "posedge req", "negedge data[3]" or "change data"
+ */
+static bool ParseMeasurementEdge(const char* text, MeasurementEdge& edge)
+{
+	char kind[32] = "";
+	char name[128] = "";
+	if(2 != sscanf(text, " %31s %127[^[ ]", kind, name))
+		return false;
+	
+	if(0 == strcmp(kind, "posedge"))
+		edge.edgetype = MeasurementEdge::EDGE_RISING;
+	else if(0 == strcmp(kind, "negedge"))
+		edge.edgetype = MeasurementEdge::EDGE_FALLING;
+	else if(0 == strcmp(kind, "change"))
+		edge.edgetype = MeasurementEdge::EDGE_CHANGE;
+	else
+		return false;
+	
+	edge.signalname = name;
+	edge.nbit = -1;
+	const char* index = strchr(text, '[');
+	return (index == NULL) || (1 == sscanf(index, "[%d]", &edge.nbit));
+}
+
+static string FormatMeasurementEdge(const MeasurementEdge& edge)
+{
+	string text;
+	switch(edge.edgetype)
+	{
+		case MeasurementEdge::EDGE_RISING:
+			text = "posedge ";
+			break;
+		case MeasurementEdge::EDGE_FALLING:
+			text = "negedge ";
+			break;
+		default:
+			text = "change ";
+			break;
+	}
+	text += edge.signalname;
+	if(edge.nbit >= 0)
+	{
+		char index[32];
+		snprintf(index, sizeof(index), "[%d]", edge.nbit);
+		text += index;
+	}
+	return text;
+}
+
+/**
+	@brief Reads a config file
+	
+	@return false if the file could not be opened
+ */
+bool CaptureConfig::Load(string fname)
+{
+	FILE* fp = fopen(fname.c_str(), "r");
+	if(fp == NULL)
+	{
+		perror("couldn't open config file");
+		return false;
+	}
+	
+	char line[1024];
+	while(fgets(line, 1023, fp))
+		ParseLine(line);
+	
+	fclose(fp);
+	return true;
+}
+
+/**
+	@brief Reads a config file that is already in memory (e.g. one sent over a socket)
+ */
+void CaptureConfig::Parse(string text)
+{
+	size_t start = 0;
+	while(start < text.length())
+	{
+		size_t end = text.find('\n', start);
+		if(end == string::npos)
+			end = text.length();
+		ParseLine(text.substr(start, end - start).c_str());
+		start = end + 1;
+	}
+}
+
+void CaptureConfig::ParseLine(const char* line)
+{
+	//Skip blank lines
+	if(line[strspn(line, " \t\r\n")] == '\0')
+		return;
+	
+	//Read the opcode
+	char word[256] = "";
+	sscanf(line, "%255[a-z_]", word);
+	std::string sw = word;
+	
+	//Parameters - global settings of some sort
+	if(sw == "parameter")
+	{
+		char name[256] = "";
+		char value[1024] = "";
+		sscanf(line, "parameter %255[^ =] = %1023[^;];", name, value);
+		SetParameter(name, value);
+	}
+	
+	//Wires - signals
+	else if(sw == "wire")
+	{
+		char name[256];
+		int maxbit;
+		if(2 != sscanf(line, "wire[%d:0] %255[^;];", &maxbit, name))
+		{
+			printf("malformed signal declaration \"%s\" in config file\n", line);
+			return;
+		}
+		
+		signals.push_back(Signal(maxbit+1, name));
+	}
+	
+	//Triggers
+	else if(sw == "add_trigger_condition")
+	{
+		char body[256] = "";
+		sscanf(line, "add_trigger_condition( %255[^)] );", body);
+		
+		bool posedge = (strstr(body, "posedge") != NULL);
+		bool negedge = (strstr(body, "negedge") != NULL);
+		bool found_or = (strstr(body, "or") != NULL);
+		
+		// !foo
+		int type = 0;
+		char* namestart = body;
+		if(body[0] == '!')
+		{
+			type = Trigger::TRIGGER_TYPE_LOW;
+			namestart ++;
+		}
+		
+		//posedge foo
+		else if(posedge && !negedge)
+		{
+			type = Trigger::TRIGGER_TYPE_RISING;
+			namestart += strlen("posedge");
+		}
+		
+		//negedge foo
+		else if(negedge && !posedge)
+		{
+			type = Trigger::TRIGGER_TYPE_FALLING;
+			namestart += strlen("negedge");
+		}
+		
+		//posedge foo or negedge foo
+		else if(posedge && negedge && found_or)
+		{
+			type = Trigger::TRIGGER_TYPE_CHANGE;
+			namestart += strlen("posedge");
+		}
+		
+		//foo
+		else
+			type = Trigger::TRIGGER_TYPE_HIGH;
+			
+		//Read the name
+		char name[128];
+		int bit;
+		if(2 != sscanf(namestart, " %127[^ [][%d]", name, &bit))
+		{
+			printf("malformed trigger condition \"%s\" in config file\n", body);
+			return;
+		}
+		
+		triggers.push_back(Trigger(name, bit, type));
+	}
+	
+	//Timing measurements, named or not
+	else if(sw == "measure")
+	{
+		char name[256] = "";
+		char from[256] = "";
+		char to[256] = "";
+		Measurement m;
+		if(3 == sscanf(line, "measure %255[^ =] = delay( %255[^,] , %255[^)] );", name, from, to))
+			m.name = name;
+		else if(2 != sscanf(line, "measure delay( %255[^,] , %255[^)] );", from, to))
+		{
+			printf("malformed measurement \"%s\" in config file\n", line);
+			return;
+		}
+		
+		if(!ParseMeasurementEdge(from, m.from) || !ParseMeasurementEdge(to, m.to))
+		{
+			printf("malformed measurement \"%s\" in config file\n", line);
+			return;
+		}
+		
+		//Unnamed measurements are named after their signals, numbered if that's taken
+		if(m.name.empty())
+		{
+			string base = m.from.signalname + "_to_" + m.to.signalname;
+			m.name = base;
+			for(int n=2; ; n++)
+			{
+				size_t i = 0;
+				while( (i < measurements.size()) && (measurements[i].name != m.name) )
+					i ++;
+				if(i == measurements.size())
+					break;
+				snprintf(name, sizeof(name), "%s_%d", base.c_str(), n);
+				m.name = name;
+			}
+		}
+		measurements.push_back(m);
+	}
+	
+	//Clean-up of noisy signals
+	else if(sw == "filter")
+	{
+		char name[256] = "";
+		char type[32] = "";
+		int clocks = 0;
+		int nfields = sscanf(line, "filter %255s %31[a-z] %d;", name, type, &clocks);
+		string stype = type;
+		if( (nfields == 2) && (stype == "invert") )
+			filters.push_back(SignalFilter(name, SignalFilter::FILTER_INVERT));
+		else if( (nfields == 2) && (stype == "mask") )
+			filters.push_back(SignalFilter(name, SignalFilter::FILTER_MASK));
+		else if( (nfields == 3) && (stype == "deglitch") && (clocks > 0) )
+			filters.push_back(SignalFilter(name, SignalFilter::FILTER_DEGLITCH, clocks));
+		else if( (nfields == 3) && (stype == "debounce") && (clocks > 0) )
+			filters.push_back(SignalFilter(name, SignalFilter::FILTER_DEBOUNCE, clocks));
+		else
+			printf("malformed filter \"%s\" in config file\n", line);
+	}
+	
+	//Something's wrong, skip the line
+	else
+		printf("unrecognized keyword \"%s\" in config file\n", word);
+}
+
+/**
+	@brief Writes the config to a file
+	
+	@return false if the file could not be written
+ */
+bool CaptureConfig::Save(string fname) const
+{
+	FILE* fp = fopen(fname.c_str(), "w");
+	if(fp == NULL)
+	{
+		perror("couldn't create config file");
+		return false;
+	}
+	
+	string text = Format();
+	bool ok = (text.length() == fwrite(text.c_str(), 1, text.length(), fp));
+	if(0 != fclose(fp))
+		ok = false;
+	return ok;
+}
+
+/**
+	@brief Produces the text of the config file
+ */
+string CaptureConfig::Format() const
+{
+	string text;
+	char line[2048];
+	
+	//Parameters
+	for(size_t i=0; i<parameters.size(); i++)
+	{
+		snprintf(line, sizeof(line), "parameter %s = %s;\n", parameters[i].first.c_str(), parameters[i].second.c_str());
+		text += line;
+	}
+	
+	//Signals
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		const Signal& sig = signals[i];
+		snprintf(line, sizeof(line), "wire[%d:0] %s;\n", sig.width-1, sig.name.c_str());
+		text += line;
+	}
+	
+	//Triggers
+	//add_trigger_condition(posedge foobar[3]);
+	for(size_t i=0; i<triggers.size(); i++)
+	{
+		const Trigger& trig = triggers[i];
+		const char* name = trig.signalname.c_str();
+		switch(trig.triggertype)
+		{
+			case Trigger::TRIGGER_TYPE_LOW:
+				snprintf(line, sizeof(line), "add_trigger_condition(!%s[%d]);\n", name, trig.nbit);
+				break;
+			case Trigger::TRIGGER_TYPE_HIGH:
+				snprintf(line, sizeof(line), "add_trigger_condition(%s[%d]);\n", name, trig.nbit);
+				break;
+			case Trigger::TRIGGER_TYPE_RISING:
+				snprintf(line, sizeof(line), "add_trigger_condition(posedge %s[%d]);\n", name, trig.nbit);
+				break;
+			case Trigger::TRIGGER_TYPE_FALLING:
+				snprintf(line, sizeof(line), "add_trigger_condition(negedge %s[%d]);\n", name, trig.nbit);
+				break;
+			case Trigger::TRIGGER_TYPE_CHANGE:
+				snprintf(line, sizeof(line), "add_trigger_condition(posedge %s[%d] or negedge %s[%d]);\n",
+					name, trig.nbit, name, trig.nbit);
+				break;
+			default:
+				continue;
+		}
+		text += line;
+	}
+	
+	//Measurements
+	for(size_t i=0; i<measurements.size(); i++)
+	{
+		const Measurement& m = measurements[i];
+		snprintf(line, sizeof(line), "measure %s = delay(%s, %s);\n", m.name.c_str(),
+			FormatMeasurementEdge(m.from).c_str(), FormatMeasurementEdge(m.to).c_str());
+		text += line;
+	}
+	
+	//Filters
+	for(size_t i=0; i<filters.size(); i++)
+	{
+		const SignalFilter& f = filters[i];
+		const char* name = f.signalname.c_str();
+		switch(f.filtertype)
+		{
+			case SignalFilter::FILTER_INVERT:
+				snprintf(line, sizeof(line), "filter %s invert;\n", name);
+				break;
+			case SignalFilter::FILTER_MASK:
+				snprintf(line, sizeof(line), "filter %s mask;\n", name);
+				break;
+			case SignalFilter::FILTER_DEGLITCH:
+				snprintf(line, sizeof(line), "filter %s deglitch %d;\n", name, f.clocks);
+				break;
+			case SignalFilter::FILTER_DEBOUNCE:
+				snprintf(line, sizeof(line), "filter %s debounce %d;\n", name, f.clocks);
+				break;
+			default:
+				continue;
+		}
+		text += line;
+	}
+	
+	return text;
+}
+
+string CaptureConfig::GetParameter(string name, string defval) const
+{
+	for(size_t i=0; i<parameters.size(); i++)
+	{
+		if(parameters[i].first == name)
+			return parameters[i].second;
+	}
+	return defval;
+}
+
+/**
+	@brief Sets a parameter, keeping its original position if it was already set
+ */
+void CaptureConfig::SetParameter(string name, string value)
+{
+	for(size_t i=0; i<parameters.size(); i++)
+	{
+		if(parameters[i].first == name)
+		{
+			parameters[i].second = value;
+			return;
+		}
+	}
+	parameters.push_back(pair<string, string>(name, value));
+}
+
+/**
+	@brief Gets the sample rate in MHz (must match the "clk" input to the LA core)
+ */
+float CaptureConfig::GetSampleRate() const
+{
+	return atof(GetParameter("SAMPLE_RATE_MHZ", "20.000").c_str());
+}
+
+/**
+	@brief Checks if captures should be run-length encoded (CAPTURE_MODE = RLE)
+ */
+bool CaptureConfig::IsRunLengthEncoded() const
+{
+	return (GetParameter("CAPTURE_MODE", "NORMAL") == "RLE");
+}
+
+/**
+	@brief Gets the number of segments to split the sample buffer into (SEGMENTS, default 1)
+	
+	Each segment waits for its own trigger, so one capture records that many events.
+ */
+int CaptureConfig::GetSegmentCount() const
+{
+	return atoi(GetParameter("SEGMENTS", "1").c_str());
+}
+
+/**
+	@brief Gets the clock signal captures are resampled on for state-mode analysis, if any
+	
+	STATE_CLOCK names the signal; STATE_EDGE is RISING (the default), FALLING or BOTH.
+	
+	@param clockname	Set to the name of the clock signal
+	@param edge			Set to Trigger::TRIGGER_TYPE_RISING, TRIGGER_TYPE_FALLING or TRIGGER_TYPE_CHANGE
+	
+	@return true if there's a state clock
+ */
+bool CaptureConfig::GetStateClock(std::string& clockname, int& edge) const
+{
+	clockname = GetParameter("STATE_CLOCK");
+	if(clockname.empty())
+		return false;
+	
+	string sedge = GetParameter("STATE_EDGE", "RISING");
+	if(sedge == "FALLING")
+		edge = Trigger::TRIGGER_TYPE_FALLING;
+	else if(sedge == "BOTH")
+		edge = Trigger::TRIGGER_TYPE_CHANGE;
+	else
+	{
+		if(sedge != "RISING")
+			printf("unrecognized state clock edge \"%s\", using RISING\n", sedge.c_str());
+		edge = Trigger::TRIGGER_TYPE_RISING;
+	}
+	return true;
+}
+
+/**
+	@brief Checks that the state clock, if there is one, is one of the signals
+	
+	Resampling on a clock that isn't captured can only fail, so this is worth finding out before capturing.
+ */
+bool CaptureConfig::CheckStateClock() const
+{
+	string clockname = GetParameter("STATE_CLOCK");
+	if(clockname.empty())
+		return true;
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		if(signals[i].name == clockname)
+			return true;
+	}
+	printf("state clock \"%s\" isn't one of the signals\n", clockname.c_str());
+	return false;
+}
+
+/**
+	@brief Hashes everything about the configuration that affects what a capture means
+	
+	Captures resampled on a state clock have one row per clock edge instead of one per sample, and filters
+	change the samples themselves, so the state clock and edge, the filters and UNUSED_CHANNELS are included.
+	
+	@param resampled	False for a capture that couldn't be resampled on the state clock, so that it
+						hashes like the timing capture it still is
+ */
+uint64_t CaptureConfig::GetHash(bool resampled) const
+{
+	string options;
+	string clockname = GetParameter("STATE_CLOCK");
+	if(resampled && !clockname.empty())
+		options += "STATE_CLOCK=" + clockname + " STATE_EDGE=" + GetParameter("STATE_EDGE", "RISING") + ";";
+	if(MasksUnusedChannels())
+		options += "UNUSED_CHANNELS=MASK;";
+	for(size_t i=0; i<filters.size(); i++)
+	{
+		options += "filter " + filters[i].signalname;
+		options += '\0';
+		AppendLE32(options, filters[i].filtertype);
+		AppendLE32(options, filters[i].clocks);
+	}
+	return HashConfig(signals, triggers, options);
+}
+
+/**
+	@brief Hashes signals, triggers and any other settings that affect what a capture means
+	
+	@param signals		Signal table
+	@param triggers		Trigger conditions
+	@param options		Other settings, already written out as text. Left out of the hash if empty, so
+						configs without any hash the same as they always have.
+ */
+uint64_t CaptureConfig::HashConfig(const std::vector<Signal>& signals, const std::vector<Trigger>& triggers,
+	const std::string& options)
+{
+	//FNV-1a
+	string data;
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		AppendLE32(data, signals[i].width);
+		data += signals[i].name;
+		data += '\0';
+	}
+	data += '\0';
+	for(size_t i=0; i<triggers.size(); i++)
+	{
+		data += triggers[i].signalname;
+		data += '\0';
+		AppendLE32(data, triggers[i].nbit);
+		AppendLE32(data, triggers[i].triggertype);
+	}
+	if(!options.empty())
+	{
+		data += '\0';
+		data += options;
+	}
+	
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for(size_t i=0; i<data.length(); i++)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/**
+	@brief Checks if channels that aren't part of any signal should be forced low (UNUSED_CHANNELS = MASK)
+	
+	Floating inputs otherwise show up in raw exports and make captures compress worse.
+ */
+bool CaptureConfig::MasksUnusedChannels() const
+{
+	return (GetParameter("UNUSED_CHANNELS", "KEEP") == "MASK");
+}
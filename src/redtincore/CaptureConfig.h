@@ -0,0 +1,102 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureConfig.h
+	@author Andrew D. Zonenberg
+	@brief Signal configuration (.scfg) files
+ */
+
+#ifndef CaptureConfig_h
+#define CaptureConfig_h
+
+#include "Measurement.h"
+#include "Signal.h"
+#include "SignalFilter.h"
+#include "Trigger.h"
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+	@brief Everything in a signal configuration file: parameters, signals and trigger conditions.
+	
+	The file format is mostly a subset of Verilog to make it nice and readable:
+	
+		parameter SAMPLE_RATE_MHZ = 20.000;
+		wire[7:0] foobar;
+		add_trigger_condition(posedge foobar[3]);
+		measure foobar_to_ack = delay(posedge foobar[3], posedge ack);
+		filter foobar deglitch 2;
+	
+	Parameters are kept as strings in the order they were set, and it is up to each user of the config to
+	interpret the ones it knows about.
+ */
+class CaptureConfig
+{
+public:
+	bool Load(std::string fname);
+	void Parse(std::string text);
+	
+	bool Save(std::string fname) const;
+	std::string Format() const;
+	
+	std::string GetParameter(std::string name, std::string defval = "") const;
+	void SetParameter(std::string name, std::string value);
+	
+	float GetSampleRate() const;
+	bool IsRunLengthEncoded() const;
+	int GetSegmentCount() const;
+	bool GetStateClock(std::string& clockname, int& edge) const;
+	bool CheckStateClock() const;
+	bool MasksUnusedChannels() const;
+	
+	uint64_t GetHash(bool resampled = true) const;
+	
+	static uint64_t HashConfig(const std::vector<Signal>& signals, const std::vector<Trigger>& triggers,
+		const std::string& options = "");
+	
+	std::vector< std::pair<std::string, std::string> > parameters;
+	std::vector<Signal> signals;
+	std::vector<Trigger> triggers;
+	std::vector<Measurement> measurements;
+	std::vector<SignalFilter> filters;
+	
+protected:
+	void ParseLine(const char* line);
+};
+
+#endif
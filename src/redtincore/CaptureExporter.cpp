@@ -0,0 +1,156 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureExporter.cpp
+	@author Andrew D. Zonenberg
+	@brief Base class for all capture file formats
+ */
+
+#include "CaptureExporter.h"
+#include "CSVExporter.h"
+#include "RawExporter.h"
+#include "SigrokExporter.h"
+#include "StatisticsExporter.h"
+#include "VCDExporter.h"
+
+#include <pthread.h>
+
+using namespace std;
+
+CaptureExporter::~CaptureExporter()
+{
+}
+
+/**
+	@brief Writes the capture to a new file
+ */
+bool CaptureExporter::Export(const Capture& cap, std::string fname)
+{
+	FILE* fp = fopen(fname.c_str(), "wb");
+	if(fp == NULL)
+	{
+		perror("couldn't create export file");
+		return false;
+	}
+	
+	bool ok = Export(cap, fp);
+	if(0 != fclose(fp))
+		ok = false;
+	return ok;
+}
+
+/**
+	@brief Creates an exporter given the short name of its format
+	
+	@return The exporter, or NULL if the format is unknown. The caller must delete it.
+ */
+CaptureExporter* CaptureExporter::CreateExporter(std::string format)
+{
+	if(format == "vcd")
+		return new VCDExporter;
+	else if(format == "sr")
+		return new SigrokExporter;
+	else if(format == "csv")
+		return new CSVExporter;
+	else if(format == "bin")
+		return new RawExporter;
+	else if(format == "stats")
+		return new StatisticsExporter;
+	
+	return NULL;
+}
+
+void CaptureExporter::EnumerateFormats(std::vector<std::string>& formats)
+{
+	formats.push_back("vcd");
+	formats.push_back("sr");
+	formats.push_back("csv");
+	formats.push_back("bin");
+	formats.push_back("stats");
+}
+
+class ExportThreadArgs
+{
+public:
+	const Capture* cap;
+	ExportJob* job;
+};
+
+static void* ExportThreadProc(void* p)
+{
+	ExportThreadArgs* args = reinterpret_cast<ExportThreadArgs*>(p);
+	args->job->ok = args->job->exporter->Export(*args->cap, args->job->fname);
+	return NULL;
+}
+
+/**
+	@brief Runs several exporters over one capture, each in its own thread
+	
+	@return true if every job succeeded
+ */
+bool ExportCaptureParallel(const Capture& cap, std::vector<ExportJob>& jobs)
+{
+	//Not worth spinning up a thread for a single file
+	if(jobs.size() == 1)
+	{
+		jobs[0].ok = jobs[0].exporter->Export(cap, jobs[0].fname);
+		return jobs[0].ok;
+	}
+	
+	vector<ExportThreadArgs> args(jobs.size());
+	vector<pthread_t> threads(jobs.size());
+	vector<bool> started(jobs.size(), false);
+	for(size_t i=0; i<jobs.size(); i++)
+	{
+		args[i].cap = &cap;
+		args[i].job = &jobs[i];
+		if(0 == pthread_create(&threads[i], NULL, ExportThreadProc, &args[i]))
+			started[i] = true;
+		
+		//Couldn't get a thread, do it ourselves
+		else
+			ExportThreadProc(&args[i]);
+	}
+	
+	bool ok = true;
+	for(size_t i=0; i<jobs.size(); i++)
+	{
+		if(started[i])
+			pthread_join(threads[i], NULL);
+		if(!jobs[i].ok)
+			ok = false;
+	}
+	return ok;
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureExporter.h
+	@author Andrew D. Zonenberg
+	@brief Base class for all capture file formats
+ */
+
+#ifndef CaptureExporter_h
+#define CaptureExporter_h
+
+#include "Capture.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+	@brief Writes a capture to a file in some format.
+	
+	Exporters only ever read the capture, so any number of them may run on the same capture at once.
+ */
+class CaptureExporter
+{
+public:
+	virtual ~CaptureExporter();
+	
+	/**
+		@brief Short name of the format, as used in config files (e.g. "vcd")
+	 */
+	virtual std::string GetFormatName() =0;
+	
+	/**
+		@brief File name extension including the dot (e.g. ".vcd")
+	 */
+	virtual std::string GetFileExtension() =0;
+	
+	/**
+		@brief Writes the capture to an open file
+		
+		@return true on success
+	 */
+	virtual bool Export(const Capture& cap, FILE* fp) =0;
+	
+	bool Export(const Capture& cap, std::string fname);
+	
+	static CaptureExporter* CreateExporter(std::string format);
+	static void EnumerateFormats(std::vector<std::string>& formats);
+};
+
+/**
+	@brief One output file for ExportCaptureParallel()
+ */
+class ExportJob
+{
+public:
+	ExportJob(CaptureExporter* e, std::string f)
+	: exporter(e)
+	, fname(f)
+	, ok(false)
+	{
+	}
+	
+	CaptureExporter* exporter;
+	std::string fname;
+	bool ok;
+};
+
+bool ExportCaptureParallel(const Capture& cap, std::vector<ExportJob>& jobs);
+
+#endif
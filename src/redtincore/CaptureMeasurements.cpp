@@ -0,0 +1,422 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureMeasurements.cpp
+	@author Andrew D. Zonenberg
+	@brief Edge-to-edge timing measurements over one or more captures
+ */
+
+#include "CaptureMeasurements.h"
+
+#include <math.h>
+
+using namespace std;
+
+MeasurementStatistics::MeasurementStatistics(const Measurement& m)
+: measurement(m)
+, count(0)
+, mindelay(0)
+, maxdelay(0)
+, sum(0)
+, sumsq(0)
+{
+}
+
+double MeasurementStatistics::GetMean() const
+{
+	if(count == 0)
+		return 0;
+	return sum / count;
+}
+
+double MeasurementStatistics::GetStdDev() const
+{
+	if(count < 2)
+		return 0;
+	double mean = sum / count;
+	double var = sumsq / count - mean*mean;
+	return (var > 0) ? sqrt(var) : 0;
+}
+
+CaptureMeasurements::CaptureMeasurements()
+{
+	Clear();
+}
+
+/**
+	@brief Sets the measurements to make. Results so far are kept if the measurements haven't changed.
+ */
+void CaptureMeasurements::SetMeasurements(const vector<Measurement>& measurements)
+{
+	bool same = (measurements.size() == m_measurements.size());
+	for(size_t i=0; same && (i<measurements.size()); i++)
+	{
+		const Measurement& a = measurements[i];
+		const Measurement& b = m_measurements[i];
+		same =	(a.name == b.name) &&
+				(a.from.signalname == b.from.signalname) && (a.from.nbit == b.from.nbit) &&
+				(a.from.edgetype == b.from.edgetype) &&
+				(a.to.signalname == b.to.signalname) && (a.to.nbit == b.to.nbit) &&
+				(a.to.edgetype == b.to.edgetype);
+	}
+	if(same)
+		return;
+	
+	m_measurements = measurements;
+	Clear();
+}
+
+void CaptureMeasurements::Clear()
+{
+	m_results.clear();
+	for(size_t i=0; i<m_measurements.size(); i++)
+		m_results.push_back(MeasurementStatistics(m_measurements[i]));
+	m_captures = 0;
+	m_samplerate = 0;
+	m_confighash = 0;
+}
+
+/**
+	@brief Finds the rows a signal has a given edge on
+	
+	@param rows		Set to the rows the edge is on, in order. Row 0 never has an edge.
+	@param error	Set to the reason for failing, if the signal isn't in the capture
+ */
+bool CaptureMeasurements::FindEdges(const Capture& cap, const MeasurementEdge& edge, vector<int>& rows, string& error)
+{
+	rows.clear();
+	
+	const vector<Signal>& signals = cap.GetSignals();
+	size_t nsig = 0;
+	while( (nsig < signals.size()) && (signals[nsig].name != edge.signalname) )
+		nsig ++;
+	if(nsig == signals.size())
+	{
+		error = "signal \"" + edge.signalname + "\" isn't one of the captured signals";
+		return false;
+	}
+	const Signal& sig = signals[nsig];
+	if(edge.nbit >= sig.width)
+	{
+		char msg[256];
+		snprintf(msg, sizeof(msg), "signal \"%s\" has no bit %d", sig.name.c_str(), edge.nbit);
+		error = msg;
+		return false;
+	}
+	
+	int depth = cap.GetDepth();
+	if(depth < 2)
+		return true;
+	
+	//Any change of a bus: compare each row with the one before it, masked to the signal
+	if( (edge.nbit < 0) && (sig.width > 1) )
+	{
+		if(edge.edgetype != MeasurementEdge::EDGE_CHANGE)
+		{
+			error = "signal \"" + sig.name + "\" is more than one bit wide, so needs a bit number for posedge/negedge";
+			return false;
+		}
+		
+		int rowwords = cap.GetRowWords();
+		vector<uint64_t> mask(rowwords, 0);
+		for(int c=sig.lowbit; c<sig.lowbit+sig.width; c++)
+			mask[c >> 6] |= 1ULL << (c & 63);
+		int first = sig.lowbit >> 6;
+		int last = (sig.lowbit + sig.width - 1) >> 6;
+		
+		for(int i=1; i<depth; i++)
+		{
+			const uint64_t* cur = cap.GetRow(i);
+			const uint64_t* prev = cap.GetRow(i-1);
+			for(int w=first; w<=last; w++)
+			{
+				if( (cur[w] ^ prev[w]) & mask[w] )
+				{
+					rows.push_back(i);
+					break;
+				}
+			}
+		}
+		return true;
+	}
+	
+	//One bit: gather 64 samples of it into a word, then find every edge in the word at once
+	int c = sig.lowbit + ( (edge.nbit < 0) ? 0 : edge.nbit );
+	int nword = c >> 6;
+	int shift = c & 63;
+	uint64_t carry = (cap.GetRow(0)[nword] >> shift) & 1;
+	for(int base=0; base<depth; base += 64)
+	{
+		int count = depth - base;
+		if(count > 64)
+			count = 64;
+		
+		uint64_t w = 0;
+		for(int j=0; j<count; j++)
+			w |= ( (cap.GetRow(base + j)[nword] >> shift) & 1 ) << j;
+		uint64_t prev = (w << 1) | carry;
+		carry = w >> 63;
+		
+		uint64_t hits;
+		if(edge.edgetype == MeasurementEdge::EDGE_RISING)
+			hits = w & ~prev;
+		else if(edge.edgetype == MeasurementEdge::EDGE_FALLING)
+			hits = ~w & prev;
+		else
+			hits = w ^ prev;
+		if(count < 64)
+			hits &= (1ULL << count) - 1;
+		
+		while(hits != 0)
+		{
+			rows.push_back(base + __builtin_ctzll(hits));
+			hits &= hits - 1;
+		}
+	}
+	return true;
+}
+
+/**
+	@brief Makes one measurement on one capture
+	
+	@param delays	Set to every delay found, in capture clocks
+	@param error	Set to the reason for failing, if either signal isn't in the capture
+ */
+bool CaptureMeasurements::Measure(const Capture& cap, const Measurement& m, vector<uint64_t>& delays, string& error)
+{
+	delays.clear();
+	
+	vector<int> from;
+	vector<int> to;
+	if(!FindEdges(cap, m.from, from, error) || !FindEdges(cap, m.to, to, error))
+		return false;
+	
+	//Pair each "from" event with the first "to" event at or after it and before the next "from" event
+	size_t j = 0;
+	for(size_t i=0; i<from.size(); i++)
+	{
+		while( (j < to.size()) && (to[j] < from[i]) )
+			j ++;
+		if(j == to.size())
+			break;
+		if( (i+1 < from.size()) && (to[j] >= from[i+1]) )
+			continue;
+		delays.push_back(cap.GetSampleTime(to[j]) - cap.GetSampleTime(from[i]));
+	}
+	return true;
+}
+
+/**
+	@brief Adds one capture to the running results
+	
+	@return false, after printing why, if a measurement couldn't be made on the capture
+ */
+bool CaptureMeasurements::Accumulate(const Capture& cap)
+{
+	//New configuration? Start over
+	if( (m_captures == 0) || (cap.GetConfigHash() != m_confighash) )
+	{
+		Clear();
+		m_confighash = cap.GetConfigHash();
+	}
+	m_samplerate = cap.GetSampleRate();
+	
+	bool ok = true;
+	vector<uint64_t> delays;
+	for(size_t i=0; i<m_results.size(); i++)
+	{
+		MeasurementStatistics& st = m_results[i];
+		string error;
+		if(!Measure(cap, st.measurement, delays, error))
+		{
+			printf("measurement %s: %s\n", st.measurement.name.c_str(), error.c_str());
+			ok = false;
+			continue;
+		}
+		
+		for(size_t k=0; k<delays.size(); k++)
+		{
+			uint64_t d = delays[k];
+			if( (st.count == 0) || (d < st.mindelay) )
+				st.mindelay = d;
+			if( (st.count == 0) || (d > st.maxdelay) )
+				st.maxdelay = d;
+			st.count ++;
+			st.sum += d;
+			st.sumsq += static_cast<double>(d) * d;
+			st.histogram[d] ++;
+		}
+	}
+	
+	m_captures ++;
+	return ok;
+}
+
+/**
+	@brief Groups a histogram into at most 16 bins for display: one per delay if there are few enough
+	different delays, otherwise equal ranges from the shortest to the longest.
+	
+	@param bins		Set to (first delay in bin, count) pairs
+	@param binsize	Set to the range of each bin, or 1 if there's one bin per delay
+ */
+static void BinHistogram(const MeasurementStatistics& st, vector< pair<uint64_t, long> >& bins, uint64_t& binsize)
+{
+	const size_t maxbins = 16;
+	
+	bins.clear();
+	binsize = 1;
+	if(st.histogram.size() <= maxbins)
+	{
+		for(map<uint64_t, long>::const_iterator it = st.histogram.begin(); it != st.histogram.end(); ++it)
+			bins.push_back(*it);
+		return;
+	}
+	
+	uint64_t range = st.maxdelay - st.mindelay + 1;
+	binsize = (range + maxbins - 1) / maxbins;
+	for(uint64_t first = st.mindelay; first <= st.maxdelay; first += binsize)
+		bins.push_back(pair<uint64_t, long>(first, 0));
+	for(map<uint64_t, long>::const_iterator it = st.histogram.begin(); it != st.histogram.end(); ++it)
+		bins[(it->first - st.mindelay) / binsize].second += it->second;
+}
+
+/**
+	@brief Formats the results as a human readable table, with a histogram under each measurement
+ */
+string CaptureMeasurements::FormatSummary() const
+{
+	string ret;
+	char line[512];
+	snprintf(line, sizeof(line), "%ld captures\n\n", m_captures);
+	ret += line;
+	snprintf(line, sizeof(line), "%-24s %8s %10s %10s %12s %10s\n", "measurement", "count", "min", "max", "mean", "stddev");
+	ret += line;
+	
+	double period_ns = (m_samplerate > 0) ? (1000.0 / m_samplerate) : 0;
+	for(size_t i=0; i<m_results.size(); i++)
+	{
+		const MeasurementStatistics& st = m_results[i];
+		if(st.count == 0)
+		{
+			snprintf(line, sizeof(line), "%-24s %8ld %10s %10s %12s %10s\n", st.measurement.name.c_str(), st.count,
+				"-", "-", "-", "-");
+			ret += line;
+			continue;
+		}
+		
+		//Clocks, then nanoseconds under them
+		snprintf(line, sizeof(line), "%-24s %8ld %10llu %10llu %12.2f %10.2f   clocks\n",
+			st.measurement.name.c_str(), st.count,
+			static_cast<unsigned long long>(st.mindelay), static_cast<unsigned long long>(st.maxdelay),
+			st.GetMean(), st.GetStdDev());
+		ret += line;
+		if(period_ns > 0)
+		{
+			snprintf(line, sizeof(line), "%-24s %8s %10.2f %10.2f %12.2f %10.2f   ns\n", "", "",
+				st.mindelay * period_ns, st.maxdelay * period_ns, st.GetMean() * period_ns, st.GetStdDev() * period_ns);
+			ret += line;
+		}
+		
+		vector< pair<uint64_t, long> > bins;
+		uint64_t binsize;
+		BinHistogram(st, bins, binsize);
+		long peak = 0;
+		for(size_t k=0; k<bins.size(); k++)
+		{
+			if(bins[k].second > peak)
+				peak = bins[k].second;
+		}
+		for(size_t k=0; k<bins.size(); k++)
+		{
+			char range[64];
+			if(binsize == 1)
+				snprintf(range, sizeof(range), "%llu", static_cast<unsigned long long>(bins[k].first));
+			else
+			{
+				snprintf(range, sizeof(range), "%llu-%llu", static_cast<unsigned long long>(bins[k].first),
+					static_cast<unsigned long long>(bins[k].first + binsize - 1));
+			}
+			int bar = (peak > 0) ? static_cast<int>( (40 * bins[k].second + peak - 1) / peak ) : 0;
+			snprintf(line, sizeof(line), "    %20s %8ld%s%s\n", range, bins[k].second, (bar > 0) ? " " : "",
+				string(bar, '#').c_str());
+			ret += line;
+		}
+	}
+	
+	return ret;
+}
+
+/**
+	@brief Writes the results as JSON
+	
+	Delays are given in both capture clocks and nanoseconds. The histogram is keyed by delay in clocks.
+ */
+void CaptureMeasurements::WriteJSON(FILE* fp) const
+{
+	double period_ns = (m_samplerate > 0) ? (1000.0 / m_samplerate) : 0;
+	
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"captures\": %ld,\n", m_captures);
+	fprintf(fp, "  \"sample_rate_mhz\": %.6f,\n", m_samplerate);
+	fprintf(fp, "  \"measurements\": [");
+	for(size_t i=0; i<m_results.size(); i++)
+	{
+		const MeasurementStatistics& st = m_results[i];
+		fprintf(fp, "%s\n    {\n", (i == 0) ? "" : ",");
+		fprintf(fp, "      \"name\": \"%s\",\n", st.measurement.name.c_str());
+		fprintf(fp, "      \"count\": %ld", st.count);
+		if(st.count > 0)
+		{
+			fprintf(fp, ",\n      \"min_clocks\": %llu", static_cast<unsigned long long>(st.mindelay));
+			fprintf(fp, ",\n      \"max_clocks\": %llu", static_cast<unsigned long long>(st.maxdelay));
+			fprintf(fp, ",\n      \"mean_clocks\": %.3f", st.GetMean());
+			fprintf(fp, ",\n      \"stddev_clocks\": %.3f", st.GetStdDev());
+			fprintf(fp, ",\n      \"min_ns\": %.3f", st.mindelay * period_ns);
+			fprintf(fp, ",\n      \"max_ns\": %.3f", st.maxdelay * period_ns);
+			fprintf(fp, ",\n      \"mean_ns\": %.3f", st.GetMean() * period_ns);
+			fprintf(fp, ",\n      \"stddev_ns\": %.3f", st.GetStdDev() * period_ns);
+			fprintf(fp, ",\n      \"histogram\": {");
+			bool first = true;
+			for(map<uint64_t, long>::const_iterator it = st.histogram.begin(); it != st.histogram.end(); ++it)
+			{
+				fprintf(fp, "%s\"%llu\": %ld", first ? "" : ", ", static_cast<unsigned long long>(it->first), it->second);
+				first = false;
+			}
+			fprintf(fp, "}");
+		}
+		fprintf(fp, "\n    }");
+	}
+	fprintf(fp, "\n  ]\n}\n");
+}
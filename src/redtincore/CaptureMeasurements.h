@@ -0,0 +1,117 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureMeasurements.h
+	@author Andrew D. Zonenberg
+	@brief Edge-to-edge timing measurements over one or more captures
+ */
+
+#ifndef CaptureMeasurements_h
+#define CaptureMeasurements_h
+
+#include "Capture.h"
+#include "Measurement.h"
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+	@brief Results of one measurement, summed over every capture seen so far. Delays are in capture clocks.
+ */
+class MeasurementStatistics
+{
+public:
+	MeasurementStatistics(const Measurement& m);
+	
+	Measurement measurement;
+	
+	long count;
+	uint64_t mindelay;
+	uint64_t maxdelay;
+	double sum;
+	double sumsq;
+	
+	///Number of times each delay was seen
+	std::map<uint64_t, long> histogram;
+	
+	double GetMean() const;
+	double GetStdDev() const;
+};
+
+/**
+	@brief Evaluates the measurements of a config on captures, and sums the results over many captures.
+	
+	Edges are found 64 samples at a time: the bit being watched is gathered from 64 rows into one word,
+	and comparing that with itself shifted by one sample gives every edge in the word at once. Only the
+	edges themselves are then walked to pair them up.
+	
+	Signals are looked up by name in each capture, so archived captures can be measured with the
+	measurements of any config that uses the same signal names. Like CaptureStatistics, accumulating a
+	capture whose config hash differs from the previous one starts over.
+ */
+class CaptureMeasurements
+{
+public:
+	CaptureMeasurements();
+	
+	void SetMeasurements(const std::vector<Measurement>& measurements);
+	void Clear();
+	bool Accumulate(const Capture& cap);
+	
+	const std::vector<MeasurementStatistics>& GetResults() const
+	{ return m_results; }
+	
+	long GetCaptureCount() const
+	{ return m_captures; }
+	
+	static bool Measure(const Capture& cap, const Measurement& m, std::vector<uint64_t>& delays, std::string& error);
+	
+	std::string FormatSummary() const;
+	void WriteJSON(FILE* fp) const;
+	
+protected:
+	static bool FindEdges(const Capture& cap, const MeasurementEdge& edge, std::vector<int>& rows, std::string& error);
+
+	std::vector<Measurement> m_measurements;
+	std::vector<MeasurementStatistics> m_results;
+	
+	long m_captures;
+	float m_samplerate;
+	uint64_t m_confighash;
+};
+
+#endif
@@ -0,0 +1,335 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureOverlay.cpp
+	@author Andrew D. Zonenberg
+	@brief Per-sample channel counts over many trigger-aligned captures
+ */
+
+#include "CaptureOverlay.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+
+CaptureOverlay::CaptureOverlay()
+{
+	Clear();
+}
+
+void CaptureOverlay::Clear()
+{
+	m_captures = 0;
+	m_pending = 0;
+	m_depth = 0;
+	m_pre = 0;
+	m_width = 0;
+	m_rowwords = 0;
+	m_confighash = 0;
+	m_signals.clear();
+	m_highplanes.clear();
+	m_toggleplanes.clear();
+	m_highcounts.clear();
+	m_togglecounts.clear();
+	m_reference.clear();
+	m_differ.clear();
+	m_highrows.clear();
+	m_togglerows.clear();
+}
+
+/**
+	@brief Adds one word per channel group to a bit-sliced count
+	
+	@param planes		PLANES planes of planewords words each, bit 0 of the counts first
+	@param planewords	Words in each plane
+	@param x			Bits to add, planewords words. Overwritten.
+ */
+void CaptureOverlay::AddPlanes(uint64_t* planes, size_t planewords, uint64_t* x)
+{
+	for(int k=0; k<PLANES; k++)
+	{
+		uint64_t* plane = planes + k*planewords;
+		uint64_t carries = 0;
+		for(size_t i=0; i<planewords; i++)
+		{
+			uint64_t carry = plane[i] & x[i];
+			plane[i] ^= x[i];
+			x[i] = carry;
+			carries |= carry;
+		}
+		if(carries == 0)
+			break;
+	}
+}
+
+/**
+	@brief Folds a capture into the counts
+ */
+void CaptureOverlay::Accumulate(const Capture& cap)
+{
+	//Sample N has to be the same time after the trigger in every capture, so work in capture clocks
+	int depth = cap.GetDepth();
+	if(depth == 0)
+		return;
+	int triggerrow = (cap.GetTriggerRow() < depth) ? cap.GetTriggerRow() : 0;
+	int64_t anchor = cap.GetSampleTime(triggerrow);
+	int64_t duration = cap.GetDuration();
+	
+	//New configuration? Start over
+	bool first = false;
+	if( (m_captures == 0) || (cap.GetConfigHash() != m_confighash) || (cap.GetWidth() != m_width) )
+	{
+		Clear();
+		first = true;
+		m_pre = min<int64_t>(anchor, MAX_PRE);
+		m_depth = min<int64_t>(m_pre + duration - anchor, MAX_DEPTH);
+		m_width = cap.GetWidth();
+		m_rowwords = cap.GetRowWords();
+		m_confighash = cap.GetConfigHash();
+		m_signals = cap.GetSignals();
+		
+		size_t words = m_depth * m_rowwords;
+		m_highplanes.assign(words * PLANES, 0);
+		m_toggleplanes.assign(words * PLANES, 0);
+		m_highcounts.assign(words * 64, 0);
+		m_togglecounts.assign(words * 64, 0);
+		m_reference.resize(words);
+		m_differ.assign(words, 0);
+		m_highrows.resize(words);
+		m_togglerows.resize(words);
+	}
+	
+	//Walk the rows along with the offsets. Clocks before the capture started or after it ended hold its first or
+	//last row.
+	int nrow = 0;
+	const uint64_t* prev = NULL;
+	for(int i=0; i<m_depth; i++)
+	{
+		int64_t t = anchor - m_pre + i;
+		while( (nrow + 1 < depth) && (static_cast<int64_t>(cap.GetSampleTime(nrow + 1)) <= t) )
+			nrow ++;
+		const uint64_t* row = cap.GetRow(nrow);
+		if(i == 0)
+			prev = row;
+		
+		size_t base = i * m_rowwords;
+		if(first)
+			copy(row, row + m_rowwords, &m_reference[base]);
+		for(int w=0; w<m_rowwords; w++)
+		{
+			m_highrows[base + w] = row[w];
+			m_togglerows[base + w] = row[w] ^ prev[w];
+			m_differ[base + w] |= row[w] ^ m_reference[base + w];
+		}
+		prev = row;
+	}
+	
+	size_t words = m_depth * m_rowwords;
+	AddPlanes(&m_highplanes[0], words, &m_highrows[0]);
+	AddPlanes(&m_toggleplanes[0], words, &m_togglerows[0]);
+	m_captures++;
+	
+	//Empty the planes before the next capture can overflow them
+	m_pending++;
+	if(m_pending == (1 << PLANES) - 1)
+		Flush();
+}
+
+/**
+	@brief Moves the bit-sliced counts into the ordinary counters
+ */
+void CaptureOverlay::Flush()
+{
+	size_t words = m_depth * m_rowwords;
+	for(int k=0; k<PLANES; k++)
+	{
+		for(size_t i=0; i<words; i++)
+		{
+			uint64_t high = m_highplanes[k*words + i];
+			uint64_t toggle = m_toggleplanes[k*words + i];
+			for(int b=0; b<64; b++)
+			{
+				m_highcounts[i*64 + b] += ((high >> b) & 1) << k;
+				m_togglecounts[i*64 + b] += ((toggle >> b) & 1) << k;
+			}
+		}
+	}
+	m_highplanes.assign(m_highplanes.size(), 0);
+	m_toggleplanes.assign(m_toggleplanes.size(), 0);
+	m_pending = 0;
+}
+
+/**
+	@brief Number of captures that had a channel high at a sample offset
+ */
+long CaptureOverlay::GetHighCount(int row, int channel) const
+{
+	size_t words = m_depth * m_rowwords;
+	size_t i = row*m_rowwords + (channel >> 6);
+	int b = channel & 63;
+	long count = m_highcounts[i*64 + b];
+	for(int k=0; k<PLANES; k++)
+		count += ((m_highplanes[k*words + i] >> b) & 1) << k;
+	return count;
+}
+
+/**
+	@brief Number of captures that had a channel change between a sample offset and the one before it
+ */
+long CaptureOverlay::GetToggleCount(int row, int channel) const
+{
+	size_t words = m_depth * m_rowwords;
+	size_t i = row*m_rowwords + (channel >> 6);
+	int b = channel & 63;
+	long count = m_togglecounts[i*64 + b];
+	for(int k=0; k<PLANES; k++)
+		count += ((m_toggleplanes[k*words + i] >> b) & 1) << k;
+	return count;
+}
+
+/**
+	@brief Writes a text heat map with a line per channel and a column per group of sample offsets, once for
+	how often each channel was high and once for how often it toggled
+	
+	@param fp		File to write to
+	@param columns	Most columns to use, or 0 for one per sample
+ */
+void CaptureOverlay::WriteHeatMap(FILE* fp, int columns) const
+{
+	int bucket = 1;
+	if( (columns > 0) && (columns < m_depth) )
+		bucket = (m_depth + columns - 1) / columns;
+	
+	fprintf(fp, "%ld captures overlaid, %d samples, trigger at sample %d", m_captures, m_depth, m_pre);
+	if(bucket > 1)
+		fprintf(fp, ", %d samples per column", bucket);
+	fprintf(fp, "\n");
+	
+	fprintf(fp, "\nFraction of captures high (' ' never, '@' always, .:-=+*#%% in between)\n");
+	WriteHeatMapSection(fp, bucket, false);
+	fprintf(fp, "\nFraction of captures toggling\n");
+	WriteHeatMapSection(fp, bucket, true);
+}
+
+void CaptureOverlay::WriteHeatMapSection(FILE* fp, int bucket, bool toggles) const
+{
+	static const char levels[] = ".:-=+*#%";
+	
+	for(size_t i=0; i<m_signals.size(); i++)
+	{
+		const Signal& sig = m_signals[i];
+		for(int k=sig.width-1; k>=0; k--)
+		{
+			string label = sig.name;
+			if(sig.width > 1)
+			{
+				char bit[16];
+				snprintf(bit, sizeof(bit), "[%d]", k);
+				label += bit;
+			}
+			fprintf(fp, "%-24s |", label.c_str());
+			
+			int channel = sig.lowbit + k;
+			for(int start=0; start<m_depth; start+=bucket)
+			{
+				int end = start + bucket;
+				if(end > m_depth)
+					end = m_depth;
+				
+				long count = 0;
+				for(int row=start; row<end; row++)
+					count += toggles ? GetToggleCount(row, channel) : GetHighCount(row, channel);
+				long total = m_captures * (end - start);
+				
+				if(count == 0)
+					fputc(' ', fp);
+				else if(count == total)
+					fputc('@', fp);
+				else
+					fputc(levels[count * 8 / total], fp);
+			}
+			fprintf(fp, "|\n");
+		}
+	}
+}
+
+/**
+	@brief Formats the low bits of a packed value as hex
+ */
+static string FormatMask(const uint64_t* words, int width)
+{
+	string ret;
+	for(int digit=(width+3)/4 - 1; digit>=0; digit--)
+		ret += "0123456789abcdef"[(words[digit/16] >> (4*(digit%16))) & 0xf];
+	return ret;
+}
+
+/**
+	@brief Writes which bits of each signal ever differed between captures, then the mask for every sample
+	offset where anything did
+ */
+void CaptureOverlay::WriteDifferMask(FILE* fp) const
+{
+	fprintf(fp, "%ld captures overlaid, trigger at sample %d, bits that ever differed:\n", m_captures, m_pre);
+	
+	vector<uint64_t> all(m_rowwords, 0);
+	for(int i=0; i<m_depth; i++)
+	{
+		for(int w=0; w<m_rowwords; w++)
+			all[w] |= m_differ[i*m_rowwords + w];
+	}
+	for(size_t i=0; i<m_signals.size(); i++)
+	{
+		const Signal& sig = m_signals[i];
+		vector<uint64_t> mask((sig.width + 63) / 64);
+		Capture::ExtractBits(&all[0], m_rowwords, sig.lowbit, sig.width, &mask[0]);
+		fprintf(fp, "%-24s 0x%s\n", sig.name.c_str(), FormatMask(&mask[0], sig.width).c_str());
+	}
+	
+	fprintf(fp, "\n%6s  mask of din[%d:0]\n", "sample", m_width - 1);
+	for(int i=0; i<m_depth; i++)
+	{
+		const uint64_t* row = GetDifferMask(i);
+		bool any = false;
+		for(int w=0; w<m_rowwords; w++)
+		{
+			if(row[w] != 0)
+				any = true;
+		}
+		if(any)
+			fprintf(fp, "%6d  %s\n", i, FormatMask(row, m_width).c_str());
+	}
+}
@@ -0,0 +1,149 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureOverlay.h
+	@author Andrew D. Zonenberg
+	@brief Per-sample channel counts over many trigger-aligned captures
+ */
+
+#ifndef CaptureOverlay_h
+#define CaptureOverlay_h
+
+#include "Capture.h"
+
+#include <stdio.h>
+#include <vector>
+
+/**
+	@brief Overlays repeated captures to show jitter and rare glitches: for every channel and sample offset
+	from the trigger, how many captures had it high, how many had it toggle, and whether it ever differed
+	from the first capture.
+	
+	Counts are kept bit-sliced, one 64-bit word per bit of the count for every 64 channels, so folding in a
+	capture is a ripple-carry add of each row word into the planes that stops as soon as no carries are left.
+	The planes are stored plane-major, which lets the compiler vectorize the adds across whole captures. Every
+	2^PLANES - 1 captures the planes are flushed into ordinary counters before they can overflow.
+	
+	Offsets are capture clocks from the trigger, so a run-length encoded capture is looked at one clock at a
+	time and captures line up however long their pre-trigger rows lasted. The first capture sets the window:
+	up to MAX_PRE clocks before the trigger and as many after it as the capture held, up to MAX_DEPTH in all.
+	Captures that start later or stop sooner hold their first or last row. As with CaptureStatistics, a
+	capture with a different width or configuration starts over.
+ */
+class CaptureOverlay
+{
+public:
+	CaptureOverlay();
+	
+	void Clear();
+	void Accumulate(const Capture& cap);
+	
+	long GetCaptureCount() const
+	{ return m_captures; }
+	
+	/**
+		@brief Number of sample offsets overlaid
+	 */
+	int GetDepth() const
+	{ return m_depth; }
+	
+	/**
+		@brief Sample offset of the trigger
+	 */
+	int GetTriggerOffset() const
+	{ return m_pre; }
+	
+	long GetHighCount(int row, int channel) const;
+	long GetToggleCount(int row, int channel) const;
+	
+	/**
+		@brief Channels that differed between captures at a sample offset, packed like a capture row
+	 */
+	const uint64_t* GetDifferMask(int row) const
+	{ return &m_differ[row * m_rowwords]; }
+	
+	void WriteHeatMap(FILE* fp, int columns) const;
+	void WriteDifferMask(FILE* fp) const;
+	
+	enum
+	{
+		///Bits in each bit-sliced count
+		PLANES = 8,
+		
+		///Most capture clocks that are overlaid
+		MAX_DEPTH = 16384,
+		
+		///Most capture clocks before the trigger that are overlaid
+		MAX_PRE = 1024
+	};
+	
+protected:
+	void Flush();
+	void WriteHeatMapSection(FILE* fp, int bucket, bool toggles) const;
+	
+	static void AddPlanes(uint64_t* planes, size_t planewords, uint64_t* x);
+	
+	long m_captures;
+	
+	///Captures added to the planes since the last flush
+	int m_pending;
+	
+	int m_depth;
+	int m_pre;
+	int m_width;
+	int m_rowwords;
+	uint64_t m_confighash;
+	std::vector<Signal> m_signals;
+	
+	//Bit-sliced counts, PLANES planes of m_depth rows each
+	std::vector<uint64_t> m_highplanes;
+	std::vector<uint64_t> m_toggleplanes;
+	
+	//Flushed counts, one per channel per row
+	std::vector<uint32_t> m_highcounts;
+	std::vector<uint32_t> m_togglecounts;
+	
+	///Rows of the first capture, to compare the others against
+	std::vector<uint64_t> m_reference;
+	
+	///Channels that ever differed from the first capture, per row
+	std::vector<uint64_t> m_differ;
+	
+	//Scratch rows for the capture being added
+	std::vector<uint64_t> m_highrows;
+	std::vector<uint64_t> m_togglerows;
+};
+
+#endif
@@ -0,0 +1,262 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CapturePlugins.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of CapturePlugins
+ */
+
+#include "CapturePlugins.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+using namespace std;
+
+/**
+	@brief Host state behind the redtin_host handed to a plugin
+ */
+class PluginContext
+{
+public:
+	const CaptureConfig* config;
+	PluginResult* result;
+	int depth;
+};
+
+static const char* GetParameterCallback(redtin_host* host, const char* name)
+{
+	const CaptureConfig* config = static_cast<PluginContext*>(host->context)->config;
+	for(size_t i=0; i<config->parameters.size(); i++)
+	{
+		if(config->parameters[i].first == name)
+			return config->parameters[i].second.c_str();
+	}
+	return NULL;
+}
+
+static void AnnotateCallback(redtin_host* host, int sample, const char* message)
+{
+	PluginContext* context = static_cast<PluginContext*>(host->context);
+	PluginAnnotation note;
+	note.sample = ( (sample >= 0) && (sample < context->depth) ) ? sample : -1;
+	note.message = (message == NULL) ? "" : message;
+	context->result->annotations.push_back(note);
+}
+
+CapturePlugins::CapturePlugins()
+{
+}
+
+CapturePlugins::~CapturePlugins()
+{
+	Unload();
+}
+
+/**
+	@brief Loads the plugins named by PLUGINS in a config, unless they're loaded already
+	
+	@return false if any of them couldn't be loaded, in which case none are
+ */
+bool CapturePlugins::Load(const CaptureConfig& config)
+{
+	string list = config.GetParameter("PLUGINS");
+	if( (list == m_list) && (m_handles.size() == m_names.size()) )
+		return true;
+	Unload();
+	
+	size_t pos = 0;
+	while(pos < list.length())
+	{
+		size_t end = list.find(' ', pos);
+		if(end == string::npos)
+			end = list.length();
+		string name = list.substr(pos, end - pos);
+		pos = end + 1;
+		if(name.empty())
+			continue;
+		
+		void* handle = dlopen(name.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if(handle == NULL)
+		{
+			printf("couldn't load plugin %s: %s\n", name.c_str(), dlerror());
+			Unload();
+			return false;
+		}
+		
+		typedef int (*VersionProc)();
+		VersionProc version = reinterpret_cast<VersionProc>(dlsym(handle, "redtin_plugin_version"));
+		AnalyzeProc analyze = reinterpret_cast<AnalyzeProc>(dlsym(handle, "redtin_plugin_analyze"));
+		if( (version == NULL) || (analyze == NULL) )
+		{
+			printf("%s is not a capture plugin\n", name.c_str());
+			dlclose(handle);
+			Unload();
+			return false;
+		}
+		if(version() != REDTIN_PLUGIN_API_VERSION)
+		{
+			printf("plugin %s was built for API version %d, not %d\n", name.c_str(), version(),
+				REDTIN_PLUGIN_API_VERSION);
+			dlclose(handle);
+			Unload();
+			return false;
+		}
+		
+		m_names.push_back(name);
+		m_handles.push_back(handle);
+		m_procs.push_back(analyze);
+	}
+	
+	m_list = list;
+	return true;
+}
+
+void CapturePlugins::Unload()
+{
+	for(size_t i=0; i<m_handles.size(); i++)
+		dlclose(m_handles[i]);
+	m_handles.clear();
+	m_procs.clear();
+	m_names.clear();
+	m_list = "";
+}
+
+/**
+	@brief Runs every plugin on a capture
+	
+	@param cap			The capture, with its signals set
+	@param config		Config the capture was taken with, for the plugins' own parameters
+	@param exportpath	File name, without extension, that exports of this capture go to
+	@param results		Set to one result per plugin, in the order they were listed
+ */
+void CapturePlugins::Analyze(
+	const Capture& cap,
+	const CaptureConfig& config,
+	string exportpath,
+	vector<PluginResult>& results) const
+{
+	results.clear();
+	if(m_procs.empty())
+		return;
+	
+	//Point the view straight at the capture's own data
+	const vector<Signal>& signals = cap.GetSignals();
+	vector<redtin_signal> views(signals.size());
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		views[i].name = signals[i].name.c_str();
+		views[i].width = signals[i].width;
+		views[i].lowbit = signals[i].lowbit;
+		views[i].colwords = cap.GetColumnWords(i);
+		views[i].column = (cap.GetDepth() > 0) ? cap.GetColumnValue(i, 0) : NULL;
+	}
+	
+	redtin_capture view;
+	view.width = cap.GetWidth();
+	view.depth = cap.GetDepth();
+	view.rowwords = cap.GetRowWords();
+	view.rows = (cap.GetDepth() > 0) ? cap.GetRow(0) : NULL;
+	view.times = cap.GetSampleTimes();
+	view.samplerate = cap.GetSampleRate();
+	view.timestamp = cap.GetTimestamp();
+	view.confighash = cap.GetConfigHash();
+	view.triggerclock = cap.GetTriggerClock();
+	view.nsignals = views.size();
+	view.signals = views.empty() ? NULL : &views[0];
+	
+	results.resize(m_procs.size());
+	for(size_t i=0; i<m_procs.size(); i++)
+	{
+		PluginContext context;
+		context.config = &config;
+		context.result = &results[i];
+		context.depth = cap.GetDepth();
+		
+		redtin_host host;
+		host.context = &context;
+		host.get_parameter = GetParameterCallback;
+		host.annotate = AnnotateCallback;
+		host.export_path = exportpath.c_str();
+		
+		results[i].plugin = m_names[i];
+		results[i].verdict = m_procs[i](&view, &host);
+	}
+}
+
+/**
+	@brief Formats plugin results for display, one line per verdict and per annotation
+ */
+string CapturePlugins::FormatResults(const Capture& cap, const vector<PluginResult>& results)
+{
+	string text;
+	double period = 1000.0 / cap.GetSampleRate();
+	for(size_t i=0; i<results.size(); i++)
+	{
+		const PluginResult& result = results[i];
+		char line[256];
+		snprintf(line, sizeof(line), "%s: %s\n", result.plugin.c_str(), GetVerdictName(result.verdict));
+		text += line;
+		for(size_t j=0; j<result.annotations.size(); j++)
+		{
+			const PluginAnnotation& note = result.annotations[j];
+			if(note.sample < 0)
+				text += "    ";
+			else
+			{
+				snprintf(line, sizeof(line), "    sample %d (%.3f ns): ", note.sample,
+					cap.GetSampleTime(note.sample) * period);
+				text += line;
+			}
+			text += note.message + "\n";
+		}
+	}
+	return text;
+}
+
+const char* CapturePlugins::GetVerdictName(int verdict)
+{
+	switch(verdict)
+	{
+		case REDTIN_VERDICT_NONE:
+			return "done";
+		case REDTIN_VERDICT_PASS:
+			return "PASS";
+		case REDTIN_VERDICT_FAIL:
+			return "FAIL";
+		default:
+			return "unknown verdict";
+	}
+}
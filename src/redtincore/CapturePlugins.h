@@ -0,0 +1,119 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CapturePlugins.h
+	@author Andrew D. Zonenberg
+	@brief Loading and running capture analysis plugins
+ */
+
+#ifndef CapturePlugins_h
+#define CapturePlugins_h
+
+#include "Capture.h"
+#include "CaptureConfig.h"
+#include "RedTinPlugin.h"
+
+#include <string>
+#include <vector>
+
+/**
+	@brief A message a plugin attached to one sample of a capture
+ */
+class PluginAnnotation
+{
+public:
+	///Sample number, or -1 for the capture as a whole
+	int sample;
+	std::string message;
+};
+
+/**
+	@brief What one plugin made of one capture
+ */
+class PluginResult
+{
+public:
+	std::string plugin;
+	int verdict;
+	std::vector<PluginAnnotation> annotations;
+};
+
+/**
+	@brief The analysis plugins named by a signal configuration.
+	
+	PLUGINS in the config is a space-separated list of shared objects (see RedTinPlugin.h). They are loaded
+	with dlopen(), so names without a slash are looked up on the library path. Each capture is handed to
+	every plugin in turn as a view of the capture's own rows and columns, so nothing is copied.
+	
+	Plugins stay loaded until a config naming a different list is loaded or the object is destroyed.
+ */
+class CapturePlugins
+{
+public:
+	CapturePlugins();
+	~CapturePlugins();
+	
+	bool Load(const CaptureConfig& config);
+	void Unload();
+	
+	///Number of plugins loaded
+	size_t GetCount() const
+	{ return m_handles.size(); }
+	
+	void Analyze(
+		const Capture& cap,
+		const CaptureConfig& config,
+		std::string exportpath,
+		std::vector<PluginResult>& results) const;
+	
+	static std::string FormatResults(const Capture& cap, const std::vector<PluginResult>& results);
+	static const char* GetVerdictName(int verdict);
+	
+protected:
+	typedef int (*AnalyzeProc)(const redtin_capture* cap, redtin_host* host);
+	
+	///Value of PLUGINS the plugins were loaded from
+	std::string m_list;
+	
+	std::vector<std::string> m_names;
+	std::vector<void*> m_handles;
+	std::vector<AnalyzeProc> m_procs;
+	
+private:
+	CapturePlugins(const CapturePlugins&);
+	CapturePlugins& operator=(const CapturePlugins&);
+};
+
+#endif
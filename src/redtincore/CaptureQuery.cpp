@@ -0,0 +1,632 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureQuery.cpp
+	@author Andrew D. Zonenberg
+	@brief Searching captures for samples matching a pattern
+ */
+
+#include "CaptureQuery.h"
+#include "CaptureArchive.h"
+#include "Sample.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+static string Trim(string s)
+{
+	size_t start = s.find_first_not_of(" \t\r\n");
+	if(start == string::npos)
+		return "";
+	size_t end = s.find_last_not_of(" \t\r\n");
+	return s.substr(start, end - start + 1);
+}
+
+CaptureQuery::CaptureQuery()
+: m_rowwords(0)
+, m_hasprev(false)
+{
+}
+
+/**
+	@brief Compiles a query against a signal table
+	
+	@param query	The query text
+	@param signals	Signals (with bit positions assigned) the query may refer to
+	@param width	Width of the captures to be searched, in channels
+	
+	@return true on success, false if the query is invalid (see GetError())
+ */
+bool CaptureQuery::Compile(std::string query, const std::vector<Signal>& signals, int width)
+{
+	m_rowwords = (width + 63) >> 6;
+	m_value.assign(m_rowwords, 0);
+	m_mask.assign(m_rowwords, 0);
+	m_prevvalue.assign(m_rowwords, 0);
+	m_prevmask.assign(m_rowwords, 0);
+	m_hasprev = false;
+	m_error = "";
+	
+	size_t start = 0;
+	while(true)
+	{
+		size_t end = query.find("&&", start);
+		string term = Trim(query.substr(start, (end == string::npos) ? string::npos : end - start));
+		if(term.empty())
+		{
+			m_error = "empty term in query";
+			return false;
+		}
+		if(!CompileTerm(term, signals))
+			return false;
+			
+		if(end == string::npos)
+			break;
+		start = end + 2;
+	}
+	
+	return true;
+}
+
+bool CaptureQuery::CompileTerm(std::string term, const std::vector<Signal>& signals)
+{
+	int lowbit;
+	int width;
+	
+	//Comparison against a value
+	size_t eq = term.find("==");
+	if(eq != string::npos)
+	{
+		if(!ResolveSignal(Trim(term.substr(0, eq)), signals, lowbit, width))
+			return false;
+		
+		vector<uint64_t> value;
+		vector<uint64_t> care;
+		if(!ParseLiteral(Trim(term.substr(eq + 2)), width, value, care))
+			return false;
+		
+		for(int k=0; k<width; k++)
+		{
+			if( (care[k >> 6] >> (k & 63)) & 1 )
+			{
+				if(!Constrain(m_value, m_mask, lowbit + k, (value[k >> 6] >> (k & 63)) & 1))
+					return false;
+			}
+		}
+		return true;
+	}
+	
+	//Everything else is a condition on a single bit
+	bool current = true;
+	int previous = -1;
+	string ref = term;
+	if(term.compare(0, 8, "posedge ") == 0)
+	{
+		previous = 0;
+		ref = term.substr(8);
+	}
+	else if(term.compare(0, 8, "negedge ") == 0)
+	{
+		current = false;
+		previous = 1;
+		ref = term.substr(8);
+	}
+	else if(term[0] == '!')
+	{
+		current = false;
+		ref = term.substr(1);
+	}
+	
+	if(!ResolveSignal(Trim(ref), signals, lowbit, width))
+		return false;
+	if(width != 1)
+	{
+		m_error = "\"" + ref + "\" is more than one bit wide, use == to compare buses";
+		return false;
+	}
+	
+	if(!Constrain(m_value, m_mask, lowbit, current))
+		return false;
+	if(previous >= 0)
+	{
+		m_hasprev = true;
+		if(!Constrain(m_prevvalue, m_prevmask, lowbit, previous))
+			return false;
+	}
+	return true;
+}
+
+/**
+	@brief Looks up name, name[n] or name[high:low]
+	
+	@param ref		The signal reference
+	@param signals	Signal table
+	@param lowbit	Channel number of the lowest bit referred to
+	@param width	Number of bits referred to
+ */
+bool CaptureQuery::ResolveSignal(std::string ref, const std::vector<Signal>& signals, int& lowbit, int& width)
+{
+	string name = ref;
+	int high = -1;
+	int low = -1;
+	size_t bracket = ref.find('[');
+	if(bracket != string::npos)
+	{
+		name = Trim(ref.substr(0, bracket));
+		string index = ref.substr(bracket);
+		int nfields = sscanf(index.c_str(), "[%d:%d]", &high, &low);
+		if(nfields == 1)
+			low = high;
+		else if(nfields != 2)
+		{
+			m_error = "bad bit index in \"" + ref + "\"";
+			return false;
+		}
+	}
+	
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		const Signal& sig = signals[i];
+		if(sig.name != name)
+			continue;
+		
+		if(bracket == string::npos)
+		{
+			high = sig.width - 1;
+			low = 0;
+		}
+		if( (low < 0) || (high < low) || (high >= sig.width) )
+		{
+			m_error = "bit index out of range in \"" + ref + "\"";
+			return false;
+		}
+		
+		lowbit = sig.lowbit + low;
+		width = high - low + 1;
+		if( (lowbit < 0) || (lowbit + width > m_rowwords * 64) )
+		{
+			m_error = "signal \"" + name + "\" is not in the capture";
+			return false;
+		}
+		return true;
+	}
+	
+	m_error = "no signal named \"" + name + "\"";
+	return false;
+}
+
+/**
+	@brief Parses a constant into value bits and a mask of which bits we care about
+ */
+bool CaptureQuery::ParseLiteral(std::string str, int width, std::vector<uint64_t>& value, std::vector<uint64_t>& care)
+{
+	int nwords = (width + 63) >> 6;
+	value.assign(nwords, 0);
+	care.assign(nwords, 0);
+	for(int k=0; k<width; k++)
+		care[k >> 6] |= static_cast<uint64_t>(1) << (k & 63);
+	
+	//Get rid of separators
+	string digits;
+	for(size_t i=0; i<str.length(); i++)
+	{
+		if(str[i] != '_')
+			digits += str[i];
+	}
+	
+	//Figure out the base
+	int bits_per_digit = 0;
+	size_t tick = digits.find('\'');
+	if(tick != string::npos)
+	{
+		size_t pos = tick + 1;
+		if( (pos < digits.length()) && ( (digits[pos] == 's') || (digits[pos] == 'S') ) )
+			pos ++;
+		char base = (pos < digits.length()) ? tolower(digits[pos]) : 0;
+		if(base == 'h')
+			bits_per_digit = 4;
+		else if(base == 'o')
+			bits_per_digit = 3;
+		else if(base == 'b')
+			bits_per_digit = 1;
+		else if(base != 'd')
+		{
+			m_error = "bad base in \"" + str + "\"";
+			return false;
+		}
+		digits = digits.substr(pos + 1);
+	}
+	else if( (digits.compare(0, 2, "0x") == 0) || (digits.compare(0, 2, "0X") == 0) )
+	{
+		bits_per_digit = 4;
+		digits = digits.substr(2);
+	}
+	else if( (digits.compare(0, 2, "0b") == 0) || (digits.compare(0, 2, "0B") == 0) )
+	{
+		bits_per_digit = 1;
+		digits = digits.substr(2);
+	}
+	
+	if(digits.empty())
+	{
+		m_error = "missing value in \"" + str + "\"";
+		return false;
+	}
+	
+	//Decimal
+	if(bits_per_digit == 0)
+	{
+		char* end;
+		unsigned long long v = strtoull(digits.c_str(), &end, 10);
+		if(*end != '\0')
+		{
+			m_error = "bad number \"" + str + "\"";
+			return false;
+		}
+		if( (width < 64) && ( (v >> width) != 0 ) )
+		{
+			m_error = "value \"" + str + "\" is too wide";
+			return false;
+		}
+		value[0] = v;
+		return true;
+	}
+	
+	//Hex, octal or binary, least significant digit first
+	int bit = 0;
+	for(size_t i=digits.length(); i>0; i--, bit += bits_per_digit)
+	{
+		char c = tolower(digits[i-1]);
+		bool dontcare = (c == 'x') || (c == 'z') || (c == '?');
+		int d = 0;
+		if( (c >= '0') && (c <= '9') )
+			d = c - '0';
+		else if( (c >= 'a') && (c <= 'f') )
+			d = c - 'a' + 10;
+		else if(!dontcare)
+			d = 16;
+		if(d >= (1 << bits_per_digit))
+		{
+			m_error = "bad digit in \"" + str + "\"";
+			return false;
+		}
+		
+		for(int k=0; k<bits_per_digit; k++)
+		{
+			int n = bit + k;
+			bool one = (d >> k) & 1;
+			if(n >= width)
+			{
+				if(one)
+				{
+					m_error = "value \"" + str + "\" is too wide";
+					return false;
+				}
+				continue;
+			}
+			uint64_t b = static_cast<uint64_t>(1) << (n & 63);
+			if(dontcare)
+				care[n >> 6] &= ~b;
+			else if(one)
+				value[n >> 6] |= b;
+		}
+	}
+	
+	return true;
+}
+
+/**
+	@brief Requires a channel to have a given value, making sure no other term wants the opposite
+ */
+bool CaptureQuery::Constrain(std::vector<uint64_t>& value, std::vector<uint64_t>& mask, int channel, bool bit)
+{
+	uint64_t b = static_cast<uint64_t>(1) << (channel & 63);
+	uint64_t& v = value[channel >> 6];
+	uint64_t& m = mask[channel >> 6];
+	if( (m & b) && ( ((v & b) != 0) != bit) )
+	{
+		m_error = "query can never match (conflicting conditions on the same bit)";
+		return false;
+	}
+	m |= b;
+	if(bit)
+		v |= b;
+	return true;
+}
+
+/**
+	@brief Finds every sample of a capture that matches the query
+	
+	@param cap		The capture to search (must be as wide as the query was compiled for)
+	@param matches	Sample numbers of the matches, in order
+ */
+void CaptureQuery::Search(const Capture& cap, std::vector<int>& matches) const
+{
+	matches.clear();
+	if(cap.GetRowWords() != m_rowwords)
+		return;
+	
+	int depth = cap.GetDepth();
+	int start = m_hasprev ? 1 : 0;
+	
+	//Fixed-width kernels for the usual board sizes
+	const uint64_t* rows = (depth == 0) ? NULL : cap.GetRow(0);
+	const uint64_t* prevmask = m_hasprev ? &m_prevmask[0] : NULL;
+	switch(m_rowwords)
+	{
+		case 2:
+			SearchRows<2>(rows, depth, &m_value[0], &m_mask[0], &m_prevvalue[0], prevmask, matches);
+			return;
+		case 4:
+			SearchRows<4>(rows, depth, &m_value[0], &m_mask[0], &m_prevvalue[0], prevmask, matches);
+			return;
+		case 8:
+			SearchRows<8>(rows, depth, &m_value[0], &m_mask[0], &m_prevvalue[0], prevmask, matches);
+			return;
+		case 16:
+			SearchRows<16>(rows, depth, &m_value[0], &m_mask[0], &m_prevvalue[0], prevmask, matches);
+			return;
+		default:
+			break;
+	}
+	
+	for(int i=start; i<depth; i++)
+	{
+		const uint64_t* row = cap.GetRow(i);
+		uint64_t miss = 0;
+		for(int w=0; w<m_rowwords; w++)
+			miss |= (row[w] ^ m_value[w]) & m_mask[w];
+		if(m_hasprev)
+		{
+			const uint64_t* prev = row - m_rowwords;
+			for(int w=0; w<m_rowwords; w++)
+				miss |= (prev[w] ^ m_prevvalue[w]) & m_prevmask[w];
+		}
+		if(miss == 0)
+			matches.push_back(i);
+	}
+}
+
+/**
+	@brief Checks a capture's summary for anything that rules out a match
+	
+	@return false if the query can't match anywhere in the capture, true if it might
+ */
+bool CaptureQuery::MightMatch(const CaptureSummary& summary) const
+{
+	if(summary.GetRowWords() != m_rowwords)
+		return false;
+	
+	for(int w=0; w<m_rowwords; w++)
+	{
+		//Every bit that must be high has to have been high sometime, and likewise for low
+		uint64_t ones = m_value[w] & m_mask[w];
+		uint64_t zeros = ~m_value[w] & m_mask[w];
+		if( (ones & ~summary.everhigh[w]) || (zeros & summary.alwayshigh[w]) )
+			return false;
+		
+		if(m_hasprev)
+		{
+			uint64_t prevones = m_prevvalue[w] & m_prevmask[w];
+			uint64_t prevzeros = ~m_prevvalue[w] & m_prevmask[w];
+			if( (prevones & ~summary.everhigh[w]) || (prevzeros & summary.alwayshigh[w]) )
+				return false;
+			
+			//Edges have to have happened
+			if( (ones & prevzeros & ~summary.rising[w]) || (zeros & prevones & ~summary.falling[w]) )
+				return false;
+		}
+		
+		//Each byte of the matching row has to be a value the lane actually took
+		for(int b=0; b<8; b++)
+		{
+			int lane = w*8 + b;
+			unsigned int mask = (m_mask[w] >> (8*b)) & 0xff;
+			if( (mask != 0) && !summary.LaneMightMatch(lane, (m_value[w] >> (8*b)) & 0xff, mask) )
+				return false;
+			mask = (m_prevmask[w] >> (8*b)) & 0xff;
+			if( m_hasprev && (mask != 0) && !summary.LaneMightMatch(lane, (m_prevvalue[w] >> (8*b)) & 0xff, mask) )
+				return false;
+		}
+	}
+	
+	return true;
+}
+
+class SearchThreadArgs
+{
+public:
+	string query;
+	const vector<const Capture*>* captures;
+	vector< vector<int> >* matches;
+	
+	///Index of the next capture to search, shared by all threads
+	volatile int next;
+};
+
+static void* SearchThreadProc(void* p)
+{
+	SearchThreadArgs* args = reinterpret_cast<SearchThreadArgs*>(p);
+	int ncaptures = args->captures->size();
+	while(true)
+	{
+		int i = __sync_fetch_and_add(&args->next, 1);
+		if(i >= ncaptures)
+			break;
+		
+		//Signal tables may differ between captures, so compile for each one
+		const Capture& cap = *(*args->captures)[i];
+		CaptureQuery query;
+		if(query.Compile(args->query, cap.GetSignals(), cap.GetWidth()))
+			query.Search(cap, (*args->matches)[i]);
+	}
+	return NULL;
+}
+
+/**
+	@brief Searches several captures at once, using one thread per CPU
+	
+	@param query	The query text, compiled separately against each capture's signal table
+	@param captures	Captures to search
+	@param matches	Sample numbers of the matches in each capture. Captures the query doesn't compile
+					for have no matches.
+ */
+void CaptureQuery::SearchCaptures(
+	std::string query,
+	const std::vector<const Capture*>& captures,
+	std::vector< std::vector<int> >& matches)
+{
+	matches.clear();
+	matches.resize(captures.size());
+	
+	SearchThreadArgs args;
+	args.query = query;
+	args.captures = &captures;
+	args.matches = &matches;
+	args.next = 0;
+	
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nthreads = (ncpus > 1) ? ncpus : 1;
+	if(nthreads > captures.size())
+		nthreads = captures.size();
+	
+	//The calling thread does its share too
+	vector<pthread_t> threads;
+	for(size_t i=1; i<nthreads; i++)
+	{
+		pthread_t thread;
+		if(0 == pthread_create(&thread, NULL, SearchThreadProc, &args))
+			threads.push_back(thread);
+	}
+	SearchThreadProc(&args);
+	for(size_t i=0; i<threads.size(); i++)
+		pthread_join(threads[i], NULL);
+}
+
+class ArchiveSearchThreadArgs
+{
+public:
+	string query;
+	CaptureArchive* archive;
+	vector<ArchiveSearchResult>* results;
+	
+	///Index of the next capture to search, shared by all threads
+	volatile int next;
+};
+
+static void* ArchiveSearchThreadProc(void* p)
+{
+	ArchiveSearchThreadArgs* args = reinterpret_cast<ArchiveSearchThreadArgs*>(p);
+	int ncaptures = args->results->size();
+	while(true)
+	{
+		int i = __sync_fetch_and_add(&args->next, 1);
+		if(i >= ncaptures)
+			break;
+		ArchiveSearchResult& result = (*args->results)[i];
+		
+		//Compile against the summary's signal table, and only load the capture if it might match
+		CaptureSummary summary;
+		if(!args->archive->LoadSummary(result.id, summary))
+			continue;
+		CaptureQuery query;
+		if(!query.Compile(args->query, summary.signals, summary.width) || !query.MightMatch(summary))
+			continue;
+		
+		Capture cap;
+		if(!args->archive->Load(result.id, cap))
+			continue;
+		result.scanned = true;
+		result.samplerate = cap.GetSampleRate();
+		query.Search(cap, result.samples);
+		for(size_t j=0; j<result.samples.size(); j++)
+			result.times.push_back(cap.GetSampleTime(result.samples[j]));
+	}
+	return NULL;
+}
+
+/**
+	@brief Searches captures in an archive, using one thread per CPU
+	
+	Each capture's summary is checked first, and the capture is only loaded and searched if it might match.
+	
+	@param query	The query text, compiled separately against each capture's signal table
+	@param archive	The archive to search
+	@param ids		Captures to search
+	@param results	Matches in each capture, in the same order as the IDs. Captures the query doesn't compile
+					for, or that couldn't be read, have no matches.
+ */
+void CaptureQuery::SearchArchive(
+	std::string query,
+	CaptureArchive& archive,
+	const std::vector<int>& ids,
+	std::vector<ArchiveSearchResult>& results)
+{
+	results.clear();
+	results.resize(ids.size());
+	for(size_t i=0; i<ids.size(); i++)
+	{
+		results[i].id = ids[i];
+		results[i].scanned = false;
+		results[i].samplerate = 0;
+	}
+	
+	ArchiveSearchThreadArgs args;
+	args.query = query;
+	args.archive = &archive;
+	args.results = &results;
+	args.next = 0;
+	
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nthreads = (ncpus > 1) ? ncpus : 1;
+	if(nthreads > ids.size())
+		nthreads = ids.size();
+	
+	vector<pthread_t> threads;
+	for(size_t i=1; i<nthreads; i++)
+	{
+		pthread_t thread;
+		if(0 == pthread_create(&thread, NULL, ArchiveSearchThreadProc, &args))
+			threads.push_back(thread);
+	}
+	ArchiveSearchThreadProc(&args);
+	for(size_t i=0; i<threads.size(); i++)
+		pthread_join(threads[i], NULL);
+}
@@ -0,0 +1,134 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureQuery.h
+	@author Andrew D. Zonenberg
+	@brief Searching captures for samples matching a pattern
+ */
+
+#ifndef CaptureQuery_h
+#define CaptureQuery_h
+
+#include "Capture.h"
+#include "CaptureSummary.h"
+
+#include <string>
+#include <vector>
+
+class CaptureArchive;
+
+/**
+	@brief Matches of a query in one archived capture
+ */
+class ArchiveSearchResult
+{
+public:
+	int id;
+	
+	///False if the capture's summary ruled it out, so it was never loaded
+	bool scanned;
+	
+	float samplerate;
+	std::vector<int> samples;
+	
+	///Time of each matching sample, in capture clocks
+	std::vector<uint64_t> times;
+};
+
+/**
+	@brief A search pattern compiled down to masks on packed rows.
+	
+	A query is a list of terms separated by "&&", all of which must hold:
+	
+		addr == 0x3c			bus or slice equal to a value (0x, 0b, decimal or Verilog 8'h3c style;
+								x or ? digits in hex/binary values are don't-care)
+		data[7:4] == 4'b1x0x	slice of a bus
+		we_n[0]					bit is high (single bit signals can leave off the index)
+		!we_n					bit is low
+		posedge clk				bit is high and was low in the previous sample
+		negedge clk				bit is low and was high in the previous sample
+		
+	Every term is folded into a (value, mask) pair for the current row and another for the previous row,
+	so checking a sample is just an XOR and AND per row word no matter how many terms there are. The same
+	masks are checked against the summaries of archived captures, so captures that can't match are never
+	loaded.
+ */
+class CaptureQuery
+{
+public:
+	CaptureQuery();
+	
+	bool Compile(std::string query, const std::vector<Signal>& signals, int width);
+	
+	/**
+		@brief Description of what went wrong in the last call to Compile()
+	 */
+	std::string GetError() const
+	{ return m_error; }
+	
+	void Search(const Capture& cap, std::vector<int>& matches) const;
+	bool MightMatch(const CaptureSummary& summary) const;
+	
+	static void SearchCaptures(
+		std::string query,
+		const std::vector<const Capture*>& captures,
+		std::vector< std::vector<int> >& matches);
+	
+	static void SearchArchive(
+		std::string query,
+		CaptureArchive& archive,
+		const std::vector<int>& ids,
+		std::vector<ArchiveSearchResult>& results);
+	
+protected:
+	bool CompileTerm(std::string term, const std::vector<Signal>& signals);
+	bool ResolveSignal(std::string ref, const std::vector<Signal>& signals, int& lowbit, int& width);
+	bool ParseLiteral(std::string str, int width, std::vector<uint64_t>& value, std::vector<uint64_t>& care);
+	bool Constrain(std::vector<uint64_t>& value, std::vector<uint64_t>& mask, int channel, bool bit);
+
+	int m_rowwords;
+	
+	std::vector<uint64_t> m_value;
+	std::vector<uint64_t> m_mask;
+	
+	//Conditions on the previous row, for edge terms
+	bool m_hasprev;
+	std::vector<uint64_t> m_prevvalue;
+	std::vector<uint64_t> m_prevmask;
+	
+	std::string m_error;
+};
+
+#endif
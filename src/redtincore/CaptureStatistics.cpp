@@ -0,0 +1,372 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureStatistics.cpp
+	@author Andrew D. Zonenberg
+	@brief Per-signal statistics over one or more captures
+ */
+
+#include "CaptureStatistics.h"
+
+#include <math.h>
+
+using namespace std;
+
+SignalStatistics::SignalStatistics(const Signal& sig)
+: name(sig.name)
+, width(sig.width)
+, changes(0)
+, toggles(sig.width, 0)
+, rising(sig.width, 0)
+, hightime(sig.width, 0)
+, periods(0)
+, periodsum(0)
+, periodsumsq(0)
+, minperiod(0)
+, maxperiod(0)
+{
+}
+
+/**
+	@brief Fraction of samples bit 0 spent high
+ */
+double SignalStatistics::GetDutyCycle(long samples) const
+{
+	if(samples == 0)
+		return 0;
+	return static_cast<double>(hightime[0]) / samples;
+}
+
+/**
+	@brief Mean rising-to-rising period of bit 0, in samples (0 if fewer than two rising edges were seen)
+ */
+double SignalStatistics::GetMeanPeriod() const
+{
+	if(periods == 0)
+		return 0;
+	return periodsum / periods;
+}
+
+/**
+	@brief Standard deviation of the period of bit 0, in samples
+ */
+double SignalStatistics::GetPeriodJitter() const
+{
+	if(periods < 2)
+		return 0;
+	double mean = periodsum / periods;
+	double var = periodsumsq / periods - mean*mean;
+	return (var > 0) ? sqrt(var) : 0;
+}
+
+CaptureStatistics::CaptureStatistics()
+{
+	Clear();
+}
+
+void CaptureStatistics::Clear()
+{
+	m_signals.clear();
+	m_captures = 0;
+	m_samples = 0;
+	m_totaltoggles = 0;
+	m_samplerate = 0;
+	m_confighash = 0;
+}
+
+/**
+	@brief Adds one capture to the running statistics
+ */
+void CaptureStatistics::Accumulate(const Capture& cap)
+{
+	const vector<Signal>& signals = cap.GetSignals();
+	
+	//New configuration? Start over
+	if( (m_captures == 0) || (cap.GetConfigHash() != m_confighash) || (signals.size() != m_signals.size()) )
+	{
+		Clear();
+		for(size_t i=0; i<signals.size(); i++)
+			m_signals.push_back(SignalStatistics(signals[i]));
+		m_confighash = cap.GetConfigHash();
+	}
+	m_samplerate = cap.GetSampleRate();
+	
+	int depth = cap.GetDepth();
+	int rowwords = cap.GetRowWords();
+	int nchans = rowwords * 64;
+	if(depth == 0)
+		return;
+	
+	//Map each channel back to the signal and bit it belongs to
+	vector<int> chansig(nchans, -1);
+	vector<int> chanbit(nchans, 0);
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		for(int k=0; k<signals[i].width; k++)
+		{
+			int c = signals[i].lowbit + k;
+			if( (c < 0) || (c >= nchans) )
+				continue;
+			chansig[c] = i;
+			chanbit[c] = k;
+		}
+	}
+	
+	//Per-channel state for this capture. Times are in capture clocks, so run-length encoded captures
+	//are weighted by how long each row lasted.
+	vector<long> levelstart(nchans, 0);
+	vector<long> lastrise(nchans, -1);
+	
+	//Per-signal state for this capture
+	vector<int> lastchange(signals.size(), 0);
+	vector<long> runstart(signals.size(), 0);
+	vector<bool> dohistogram(signals.size());
+	for(size_t i=0; i<signals.size(); i++)
+		dohistogram[i] = (signals[i].width > 1) && (signals[i].width <= 64);
+	
+	for(int i=1; i<depth; i++)
+	{
+		long t = cap.GetSampleTime(i);
+		const uint64_t* cur = cap.GetRow(i);
+		const uint64_t* prev = cap.GetRow(i-1);
+		for(int w=0; w<rowwords; w++)
+		{
+			uint64_t d = cur[w] ^ prev[w];
+			if(d == 0)
+				continue;
+			m_totaltoggles += __builtin_popcountll(d);
+			
+			//Visit each toggled bit
+			while(d != 0)
+			{
+				int c = 64*w + __builtin_ctzll(d);
+				d &= d - 1;
+				
+				int s = chansig[c];
+				if(s < 0)
+					continue;
+				SignalStatistics& st = m_signals[s];
+				int k = chanbit[c];
+				
+				st.toggles[k] ++;
+				if( (cur[w] >> (c & 63)) & 1 )
+				{
+					st.rising[k] ++;
+					levelstart[c] = t;
+					
+					if(k == 0)
+					{
+						if(lastrise[c] >= 0)
+						{
+							long period = t - lastrise[c];
+							if( (st.periods == 0) || (period < st.minperiod) )
+								st.minperiod = period;
+							if( (st.periods == 0) || (period > st.maxperiod) )
+								st.maxperiod = period;
+							st.periods ++;
+							st.periodsum += period;
+							st.periodsumsq += static_cast<double>(period) * period;
+						}
+						lastrise[c] = t;
+					}
+				}
+				else
+					st.hightime[k] += t - levelstart[c];
+				
+				//First bit of this signal to change on this row
+				if(lastchange[s] != i)
+				{
+					lastchange[s] = i;
+					st.changes ++;
+					if(dohistogram[s])
+					{
+						st.histogram[cap.GetColumnValue(s, i-1)[0]] += t - runstart[s];
+						runstart[s] = t;
+					}
+				}
+			}
+		}
+	}
+	
+	//Close out everything still high at the end of the capture
+	long end = cap.GetDuration();
+	const uint64_t* last = cap.GetRow(depth - 1);
+	for(int w=0; w<rowwords; w++)
+	{
+		uint64_t d = last[w];
+		while(d != 0)
+		{
+			int c = 64*w + __builtin_ctzll(d);
+			d &= d - 1;
+			if(chansig[c] >= 0)
+				m_signals[chansig[c]].hightime[chanbit[c]] += end - levelstart[c];
+		}
+	}
+	for(size_t s=0; s<signals.size(); s++)
+	{
+		if(dohistogram[s])
+			m_signals[s].histogram[cap.GetColumnValue(s, depth-1)[0]] += end - runstart[s];
+	}
+	
+	m_samples += end;
+	m_captures ++;
+}
+
+/**
+	@brief Formats the statistics as a human readable table
+ */
+string CaptureStatistics::FormatSummary() const
+{
+	string ret;
+	char line[512];
+	snprintf(line, sizeof(line), "%ld captures, %ld samples, %ld channel toggles\n\n",
+		m_captures, m_samples, m_totaltoggles);
+	ret += line;
+	snprintf(line, sizeof(line), "%-24s %8s %7s %12s %12s\n", "signal", "changes", "duty", "freq (MHz)", "jitter (ns)");
+	ret += line;
+	
+	double period_ns = (m_samplerate > 0) ? (1000.0 / m_samplerate) : 0;
+	for(size_t i=0; i<m_signals.size(); i++)
+	{
+		const SignalStatistics& st = m_signals[i];
+		
+		//Single bit signals get timing
+		if(st.width == 1)
+		{
+			double mean = st.GetMeanPeriod();
+			if(mean > 0)
+			{
+				snprintf(line, sizeof(line), "%-24s %8ld %6.1f%% %12.4f %12.3f\n",
+					st.name.c_str(), st.changes, 100 * st.GetDutyCycle(m_samples),
+					m_samplerate / mean, st.GetPeriodJitter() * period_ns);
+			}
+			else
+			{
+				snprintf(line, sizeof(line), "%-24s %8ld %6.1f%% %12s %12s\n",
+					st.name.c_str(), st.changes, 100 * st.GetDutyCycle(m_samples), "-", "-");
+			}
+			ret += line;
+			continue;
+		}
+		
+		//Buses get the most common value
+		snprintf(line, sizeof(line), "%-24s %8ld %7s %12s %12s", st.name.c_str(), st.changes, "-", "-", "-");
+		ret += line;
+		if(!st.histogram.empty())
+		{
+			map<uint64_t, long>::const_iterator top = st.histogram.begin();
+			for(map<uint64_t, long>::const_iterator it = st.histogram.begin(); it != st.histogram.end(); ++it)
+			{
+				if(it->second > top->second)
+					top = it;
+			}
+			snprintf(line, sizeof(line), "   %zu values, most often 0x%llx (%.1f%%)",
+				st.histogram.size(), static_cast<unsigned long long>(top->first),
+				100.0 * top->second / m_samples);
+			ret += line;
+		}
+		ret += "\n";
+	}
+	
+	return ret;
+}
+
+static void WriteJSONArray(FILE* fp, const vector<long>& v)
+{
+	fprintf(fp, "[");
+	for(size_t i=0; i<v.size(); i++)
+		fprintf(fp, "%s%ld", (i == 0) ? "" : ", ", v[i]);
+	fprintf(fp, "]");
+}
+
+/**
+	@brief Writes the statistics as JSON
+	
+	Times are in nanoseconds, frequencies in MHz. Per-bit arrays are indexed by bit number within the
+	signal.
+ */
+void CaptureStatistics::WriteJSON(FILE* fp) const
+{
+	double period_ns = (m_samplerate > 0) ? (1000.0 / m_samplerate) : 0;
+	
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"captures\": %ld,\n", m_captures);
+	fprintf(fp, "  \"samples\": %ld,\n", m_samples);
+	fprintf(fp, "  \"sample_rate_mhz\": %.6f,\n", m_samplerate);
+	fprintf(fp, "  \"total_toggles\": %ld,\n", m_totaltoggles);
+	fprintf(fp, "  \"signals\": [");
+	for(size_t i=0; i<m_signals.size(); i++)
+	{
+		const SignalStatistics& st = m_signals[i];
+		fprintf(fp, "%s\n    {\n", (i == 0) ? "" : ",");
+		
+		//Signal names are Verilog identifiers so they never need escaping
+		fprintf(fp, "      \"name\": \"%s\",\n", st.name.c_str());
+		fprintf(fp, "      \"width\": %d,\n", st.width);
+		fprintf(fp, "      \"changes\": %ld,\n", st.changes);
+		fprintf(fp, "      \"toggles\": ");
+		WriteJSONArray(fp, st.toggles);
+		fprintf(fp, ",\n      \"rising\": ");
+		WriteJSONArray(fp, st.rising);
+		fprintf(fp, ",\n      \"duty_cycle\": [");
+		for(int k=0; k<st.width; k++)
+			fprintf(fp, "%s%.6f", (k == 0) ? "" : ", ", (m_samples > 0) ? (double)st.hightime[k] / m_samples : 0);
+		fprintf(fp, "]");
+		
+		if(st.periods > 0)
+		{
+			fprintf(fp, ",\n      \"frequency_mhz\": %.6f", m_samplerate / st.GetMeanPeriod());
+			fprintf(fp, ",\n      \"mean_period_ns\": %.3f", st.GetMeanPeriod() * period_ns);
+			fprintf(fp, ",\n      \"min_period_ns\": %.3f", st.minperiod * period_ns);
+			fprintf(fp, ",\n      \"max_period_ns\": %.3f", st.maxperiod * period_ns);
+			fprintf(fp, ",\n      \"period_jitter_ns\": %.3f", st.GetPeriodJitter() * period_ns);
+		}
+		
+		if(!st.histogram.empty())
+		{
+			fprintf(fp, ",\n      \"histogram\": {");
+			bool first = true;
+			for(map<uint64_t, long>::const_iterator it = st.histogram.begin(); it != st.histogram.end(); ++it)
+			{
+				fprintf(fp, "%s\"0x%llx\": %ld", first ? "" : ", ", static_cast<unsigned long long>(it->first), it->second);
+				first = false;
+			}
+			fprintf(fp, "}");
+		}
+		
+		fprintf(fp, "\n    }");
+	}
+	fprintf(fp, "\n  ]\n}\n");
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureStatistics.h
+	@author Andrew D. Zonenberg
+	@brief Per-signal statistics over one or more captures
+ */
+
+#ifndef CaptureStatistics_h
+#define CaptureStatistics_h
+
+#include "Capture.h"
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+	@brief Statistics for one signal, summed over every capture seen so far
+ */
+class SignalStatistics
+{
+public:
+	SignalStatistics(const Signal& sig);
+
+	std::string name;
+	int width;
+	
+	///Number of samples where the signal had a different value than the sample before it
+	long changes;
+	
+	//Per-bit counts, bit 0 first
+	std::vector<long> toggles;
+	std::vector<long> rising;
+	std::vector<long> hightime;
+	
+	//Rising-edge-to-rising-edge periods of bit 0, in samples
+	long periods;
+	double periodsum;
+	double periodsumsq;
+	long minperiod;
+	long maxperiod;
+	
+	///Number of samples spent at each value, for buses no more than 64 bits wide
+	std::map<uint64_t, long> histogram;
+	
+	double GetDutyCycle(long samples) const;
+	double GetMeanPeriod() const;
+	double GetPeriodJitter() const;
+};
+
+/**
+	@brief Computes statistics for every signal of a capture in a single pass, and sums them over many
+	captures.
+	
+	The pass walks the XOR of each pair of adjacent rows, so the cost is one XOR per row word plus a
+	little work per bit that actually toggled. Bus values come from the capture's column views.
+	
+	Statistics only make sense for captures of the same configuration, so accumulating a capture whose
+	config hash differs from the previous one starts over.
+ */
+class CaptureStatistics
+{
+public:
+	CaptureStatistics();
+	
+	void Clear();
+	void Accumulate(const Capture& cap);
+	
+	const std::vector<SignalStatistics>& GetSignals() const
+	{ return m_signals; }
+	
+	long GetCaptureCount() const
+	{ return m_captures; }
+	long GetSampleCount() const
+	{ return m_samples; }
+	float GetSampleRate() const
+	{ return m_samplerate; }
+	
+	std::string FormatSummary() const;
+	void WriteJSON(FILE* fp) const;
+	
+protected:
+	std::vector<SignalStatistics> m_signals;
+	
+	long m_captures;
+	long m_samples;
+	
+	///Total channel toggles across all rows
+	long m_totaltoggles;
+	
+	float m_samplerate;
+	uint64_t m_confighash;
+};
+
+#endif
@@ -0,0 +1,119 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureSummary.cpp
+	@author Andrew D. Zonenberg
+	@brief Small digest of a capture, for deciding whether a search could match it without loading it
+ */
+
+#include "CaptureSummary.h"
+
+using namespace std;
+
+CaptureSummary::CaptureSummary()
+: width(0)
+, depth(0)
+{
+}
+
+/**
+	@brief Summarizes a capture, which must have its signal table
+ */
+void CaptureSummary::Build(const Capture& cap)
+{
+	width = cap.GetWidth();
+	depth = cap.GetDepth();
+	signals = cap.GetSignals();
+	
+	int rowwords = cap.GetRowWords();
+	everhigh.assign(rowwords, 0);
+	alwayshigh.assign(rowwords, ~static_cast<uint64_t>(0));
+	rising.assign(rowwords, 0);
+	falling.assign(rowwords, 0);
+	lanevalues.assign(rowwords * 8 * 4, 0);
+	if(depth == 0)
+	{
+		alwayshigh.assign(rowwords, 0);
+		return;
+	}
+	
+	for(int i=0; i<depth; i++)
+	{
+		const uint64_t* row = cap.GetRow(i);
+		for(int w=0; w<rowwords; w++)
+		{
+			uint64_t v = row[w];
+			everhigh[w] |= v;
+			alwayshigh[w] &= v;
+			if(i > 0)
+			{
+				uint64_t prev = row[w - rowwords];
+				rising[w] |= v & ~prev;
+				falling[w] |= ~v & prev;
+			}
+			
+			//One bit in the lane's value map for each byte
+			uint64_t* lanes = &lanevalues[w * 32];
+			for(int b=0; b<8; b++, lanes += 4)
+			{
+				unsigned int byte = (v >> (8*b)) & 0xff;
+				lanes[byte >> 6] |= static_cast<uint64_t>(1) << (byte & 63);
+			}
+		}
+	}
+}
+
+/**
+	@brief Checks if a byte lane ever had a value, ignoring the bits not in the mask
+ */
+bool CaptureSummary::LaneMightMatch(int lane, unsigned int value, unsigned int mask) const
+{
+	const uint64_t* seen = &lanevalues[lane * 4];
+	value &= mask;
+	
+	//Only the values that agree with the masked bits count. Walk the unmasked bits' combinations.
+	unsigned int free = ~mask & 0xff;
+	unsigned int sub = 0;
+	while(true)
+	{
+		unsigned int byte = value | sub;
+		if( (seen[byte >> 6] >> (byte & 63)) & 1 )
+			return true;
+		if(sub == free)
+			break;
+		sub = (sub - free) & free;
+	}
+	return false;
+}
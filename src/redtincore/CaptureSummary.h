@@ -0,0 +1,84 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureSummary.h
+	@author Andrew D. Zonenberg
+	@brief Small digest of a capture, for deciding whether a search could match it without loading it
+ */
+
+#ifndef CaptureSummary_h
+#define CaptureSummary_h
+
+#include "Capture.h"
+
+#include <vector>
+
+/**
+	@brief What values and edges a capture contains, channel by channel, without the samples themselves.
+	
+	Per channel: whether it was ever high, whether it was always high, and whether it ever rose or fell.
+	Per byte lane (channels 0-7, 8-15, ...): a 256-bit map of every value the lane took. A query that
+	needs a value or edge the summary says never happened can't match anywhere in the capture. The
+	signal table is kept too, so queries can be compiled without opening the capture.
+	
+	The archive keeps one next to every capture (see CaptureArchive::LoadSummary()).
+ */
+class CaptureSummary
+{
+public:
+	CaptureSummary();
+	
+	void Build(const Capture& cap);
+	
+	int width;
+	int depth;
+	std::vector<Signal> signals;
+	
+	//Per-channel masks, GetRowWords() words each
+	std::vector<uint64_t> everhigh;
+	std::vector<uint64_t> alwayshigh;
+	std::vector<uint64_t> rising;
+	std::vector<uint64_t> falling;
+	
+	///Values seen in each byte lane, four words per lane
+	std::vector<uint64_t> lanevalues;
+	
+	int GetRowWords() const
+	{ return (width + 63) >> 6; }
+	
+	bool LaneMightMatch(int lane, unsigned int value, unsigned int mask) const;
+};
+
+#endif
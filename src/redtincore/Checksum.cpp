@@ -0,0 +1,77 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Checksum.cpp
+	@author Andrew D. Zonenberg
+	@brief Checksums used by file formats and the capture protocol
+ */
+
+#include "Checksum.h"
+
+/**
+	@brief Lookup table for CRC32(), filled in at startup so it is safe to use from any thread
+ */
+class CRC32Table
+{
+public:
+	CRC32Table()
+	{
+		for(uint32_t i=0; i<256; i++)
+		{
+			uint32_t c = i;
+			for(int k=0; k<8; k++)
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			table[i] = c;
+		}
+	}
+	
+	uint32_t table[256];
+};
+
+static const CRC32Table g_crc32;
+
+/**
+	@brief Standard (zip/Ethernet) CRC-32, reflected polynomial 0xEDB88320
+	
+	Pass the result of a previous call as crc to checksum data in pieces.
+ */
+uint32_t CRC32(const void* data, size_t len, uint32_t crc)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+	crc = ~crc;
+	for(size_t i=0; i<len; i++)
+		crc = g_crc32.table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Measurement.h
+	@author Andrew D. Zonenberg
+	@brief A timing measurement between edges of two signals
+ */
+
+#ifndef Measurement_h
+#define Measurement_h
+
+#include <string>
+
+/**
+	@brief An event on a signal: an edge of one bit, or any change of the whole signal
+ */
+class MeasurementEdge
+{
+public:
+	enum EdgeTypes
+	{
+		EDGE_RISING,
+		EDGE_FALLING,
+		EDGE_CHANGE
+	};
+	
+	std::string signalname;
+	
+	///Bit number within the signal, or -1 for the whole signal
+	int nbit;
+	int edgetype;
+	
+	MeasurementEdge(std::string s = "", int b = -1, int t = EDGE_RISING)
+	: signalname(s)
+	, nbit(b)
+	, edgetype(t)
+	{
+	}
+};
+
+/**
+	@brief Time from each "from" event to the first "to" event at or after it, in .scfg files written as
+	
+		measure req_to_ack = delay(posedge req, posedge ack);
+	
+	A "from" event followed by another one before any "to" event is not counted, so the last change of a bus
+	before a strobe gives its setup time.
+ */
+class Measurement
+{
+public:
+	std::string name;
+	MeasurementEdge from;
+	MeasurementEdge to;
+};
+
+#endif
@@ -0,0 +1,96 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RawExporter.cpp
+	@author Andrew D. Zonenberg
+	@brief Raw binary export of packed sample rows
+ */
+
+#include "RawExporter.h"
+
+using namespace std;
+
+string RawExporter::GetFormatName()
+{
+	return "bin";
+}
+
+string RawExporter::GetFileExtension()
+{
+	return ".bin";
+}
+
+/**
+	@brief Writes each sample as width/8 bytes with channel 0 in the LSB of the first byte.
+	
+	There is no header; the layout is the same as the logic data in a sigrok session. Run-length encoded
+	captures are expanded, so there is always one sample per capture clock.
+ */
+bool RawExporter::Export(const Capture& cap, FILE* fp)
+{
+	if(cap.GetDepth() == 0)
+		return true;
+	
+	int rowbytes = cap.GetWidth() / 8;
+	if(!cap.IsRunLengthEncoded())
+	{
+		vector<unsigned char> buf(rowbytes * cap.GetDepth());
+		for(int i=0; i<cap.GetDepth(); i++)
+			cap.GetRowBytes(i, &buf[i * rowbytes]);
+		
+		if(buf.size() != fwrite(&buf[0], 1, buf.size(), fp))
+		{
+			perror("couldn't write samples");
+			return false;
+		}
+		return true;
+	}
+	
+	//Expanding could take a lot of memory, so write each row as many times as it lasted
+	vector<unsigned char> row(rowbytes);
+	for(int i=0; i<cap.GetDepth(); i++)
+	{
+		cap.GetRowBytes(i, &row[0]);
+		for(uint32_t j=0; j<cap.GetRunLength(i); j++)
+		{
+			if(row.size() != fwrite(&row[0], 1, row.size(), fp))
+			{
+				perror("couldn't write samples");
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,135 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RecordingTransport.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of RecordingTransport
+ */
+
+#include "RecordingTransport.h"
+#include "ByteOrder.h"
+
+#include <string.h>
+#include <time.h>
+
+using namespace std;
+
+static uint64_t GetMonotonicNs()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/**
+	@param transport	The transport to record, which must stay around as long as we do
+ */
+RecordingTransport::RecordingTransport(Transport* transport)
+: m_transport(transport)
+, m_fp(NULL)
+, m_start(0)
+{
+}
+
+RecordingTransport::~RecordingTransport()
+{
+	Close();
+}
+
+/**
+	@brief Starts recording to a file, replacing anything already in it
+ */
+bool RecordingTransport::Open(string fname)
+{
+	Close();
+	m_fp = fopen(fname.c_str(), "wb");
+	if(m_fp == NULL)
+	{
+		perror("couldn't create recording");
+		return false;
+	}
+	fwrite(RECORDING_MAGIC, 1, strlen(RECORDING_MAGIC), m_fp);
+	m_start = GetMonotonicNs();
+	return true;
+}
+
+void RecordingTransport::Close()
+{
+	if(m_fp != NULL)
+	{
+		if(0 != fclose(m_fp))
+			perror("couldn't write recording");
+		m_fp = NULL;
+	}
+}
+
+void RecordingTransport::Record(RecordType type, uint64_t time, const unsigned char* buf, int count)
+{
+	if( (m_fp == NULL) || (count <= 0) )
+		return;
+	
+	string header;
+	header += static_cast<char>(type);
+	AppendLE64(header, time - m_start);
+	AppendLE32(header, count);
+	fwrite(header.c_str(), 1, header.length(), m_fp);
+	fwrite(buf, 1, count, m_fp);
+}
+
+int RecordingTransport::Read(unsigned char* buf, int count)
+{
+	int x = m_transport->Read(buf, count);
+	Record(RECORD_READ, GetMonotonicNs(), buf, x);
+	return x;
+}
+
+int RecordingTransport::Write(const unsigned char* buf, int count)
+{
+	//Stamped with when the write started, since it can block until the bytes are out
+	uint64_t now = GetMonotonicNs();
+	int x = m_transport->Write(buf, count);
+	Record(RECORD_WRITE, now, buf, x);
+	return x;
+}
+
+bool RecordingTransport::WaitReadable(int timeout_ms)
+{
+	return m_transport->WaitReadable(timeout_ms);
+}
+
+void RecordingTransport::FlushInput()
+{
+	m_transport->FlushInput();
+}
@@ -0,0 +1,95 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RecordingTransport.h
+	@author Andrew D. Zonenberg
+	@brief Tap that records all traffic on another transport
+ */
+
+#ifndef RecordingTransport_h
+#define RecordingTransport_h
+
+#include "Transport.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+///First bytes of a recording file
+#define RECORDING_MAGIC "REDTINR1"
+
+/**
+	@brief Passes everything through to another transport, writing each chunk of data sent and received to a file
+	with the time it happened. ReplayTransport plays the file back later.
+	
+	The file starts with RECORDING_MAGIC, followed by one record per Read() or Write() call that moved any data:
+		1 byte		RECORD_WRITE or RECORD_READ
+		LE64		nanoseconds from opening the recording until the read returned or the write began
+		LE32		number of bytes
+		data
+	Bytes discarded by FlushInput() were never seen by the host and aren't recorded.
+ */
+class RecordingTransport : public Transport
+{
+public:
+	RecordingTransport(Transport* transport);
+	virtual ~RecordingTransport();
+	
+	bool Open(std::string fname);
+	void Close();
+	
+	virtual int Read(unsigned char* buf, int count);
+	virtual int Write(const unsigned char* buf, int count);
+	virtual bool WaitReadable(int timeout_ms);
+	virtual void FlushInput();
+	
+	enum RecordType
+	{
+		RECORD_WRITE = 'W',
+		RECORD_READ = 'R'
+	};
+	
+protected:
+	void Record(RecordType type, uint64_t time, const unsigned char* buf, int count);
+	
+	Transport* m_transport;
+	
+	FILE* m_fp;
+	
+	///Monotonic time the recording was opened, in nanoseconds
+	uint64_t m_start;
+};
+
+#endif
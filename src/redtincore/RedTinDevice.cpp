@@ -0,0 +1,543 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RedTinDevice.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of RedTinDevice
+ */
+
+#include "RedTinDevice.h"
+#include "Checksum.h"
+
+#include <memory.h>
+#include <stdio.h>
+#include <vector>
+
+///Requests kept in flight during framed readback (the wrapper can only hold one more than it's sending)
+#define BLOCK_WINDOW 2
+
+///How long to wait for a block before asking again
+#define BLOCK_TIMEOUT_MS 1000
+
+///How long the link has to be quiet after a damaged block before the next request
+#define BLOCK_QUIET_MS 20
+
+///Most passes over the missing blocks before giving up
+#define BLOCK_MAX_PASSES 8
+
+///How long to wait for the reply to an identify command
+#define IDENTIFY_TIMEOUT_MS 500
+
+RedTinDevice::RedTinDevice(Transport* transport)
+: m_transport(transport)
+, m_rle(false)
+, m_segments(0)
+, m_cores(0)
+, m_loaded(false)
+{
+	m_synctime.tv_sec = 0;
+	m_synctime.tv_nsec = 0;
+}
+
+/**
+	@brief Sets the number of segments to split the buffer into
+	
+	@param count	A power of two from 1 to MAX_SEGMENTS
+ */
+bool RedTinDevice::SetSegmentCount(int count)
+{
+	if(!IsValidSegmentCount(count))
+	{
+		printf("segment count must be a power of two from 1 to %d\n", MAX_SEGMENTS);
+		return false;
+	}
+	m_segments = 0;
+	while( (1 << m_segments) < count )
+		m_segments ++;
+	return true;
+}
+
+/**
+	@brief Checks if a segment count is a power of two from 1 to MAX_SEGMENTS
+ */
+bool RedTinDevice::IsValidSegmentCount(int count)
+{
+	for(int i=0; (1 << i) <= MAX_SEGMENTS; i++)
+	{
+		if(count == (1 << i))
+			return true;
+	}
+	return false;
+}
+
+/**
+	@brief Adds the framed readback, encoding and segment flags to a load (0x00) or re-arm (0x01) opcode
+ */
+unsigned char RedTinDevice::GetOpcode(unsigned char opcode) const
+{
+	opcode |= 0x02;
+	if(m_rle)
+		opcode |= 0x08;
+	if(m_segments != 0)
+		opcode |= 0x10;
+	return opcode;
+}
+
+bool RedTinDevice::SendCommand(unsigned char opcode)
+{
+	unsigned char header[5] = {0xfe, 0xed, 0xfa, 0xce, opcode};
+	if(5 != m_transport->WriteLooped(header, 5))
+	{
+		printf("couldn't send header\n");
+		m_loaded = false;
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Sends a load (0x00) or re-arm (0x01) command with the current flags, and the segment count if any
+ */
+bool RedTinDevice::SendStart(unsigned char opcode)
+{
+	if(!SendCommand(GetOpcode(opcode)))
+		return false;
+	if(m_segments != 0)
+	{
+		unsigned char count = m_segments;
+		if(1 != m_transport->WriteLooped(&count, 1))
+		{
+			printf("couldn't send segment count\n");
+			m_loaded = false;
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+	@brief Asks the board how many cores it has
+	
+	Does nothing if the core count is already known.
+ */
+bool RedTinDevice::Identify()
+{
+	if(m_cores != 0)
+		return true;
+	
+	m_transport->FlushInput();
+	if(!SendCommand(0x06))
+		return false;
+	
+	unsigned char reply[2] = {0};
+	if( (2 == m_transport->ReadLooped(reply, 2, IDENTIFY_TIMEOUT_MS)) && (reply[0] == 0x5A) &&
+		(reply[1] >= 1) && (reply[1] <= MAX_CORES) )
+	{
+		m_cores = reply[1];
+		printf("Board has %d core%s (%d channels)\n", m_cores, (m_cores == 1) ? "" : "s", GetWidth());
+		return true;
+	}
+	
+	//Wrappers from before multi-core support take anything they don't know for a framed load.
+	//Give them a bitstream so they go back to waiting for commands, and throw away the sync byte
+	//from the capture it starts.
+	printf("Board didn't identify itself, assuming an old single-core wrapper\n");
+	unsigned char blank[TRIGGER_BITSTREAM_SIZE] = {0};
+	if(TRIGGER_BITSTREAM_SIZE != m_transport->WriteLooped(blank, TRIGGER_BITSTREAM_SIZE))
+	{
+		printf("couldn't send bitstream\n");
+		return false;
+	}
+	m_transport->Drain(IDENTIFY_TIMEOUT_MS);
+	m_cores = 1;
+	m_loaded = false;
+	return true;
+}
+
+/**
+	@brief Sends new trigger configurations to the board and arms it
+ */
+bool RedTinDevice::LoadTrigger(const unsigned char* bitstream)
+{
+	if(!Identify())
+		return false;
+	
+	//Anything left over from the last capture would be mistaken for the sync byte
+	m_transport->FlushInput();
+	
+	for(int core=0; core<m_cores; core++)
+	{
+		//Old single-core wrappers don't know the select command
+		if(m_cores > 1)
+		{
+			if(!SendCommand(0x05))
+				return false;
+			unsigned char num = core;
+			if(1 != m_transport->WriteLooped(&num, 1))
+			{
+				printf("couldn't send core number\n");
+				m_loaded = false;
+				return false;
+			}
+		}
+		
+		if(!SendStart(0x00))
+			return false;
+		if(TRIGGER_BITSTREAM_SIZE != m_transport->WriteLooped(bitstream + core*TRIGGER_BITSTREAM_SIZE, TRIGGER_BITSTREAM_SIZE))
+		{
+			printf("couldn't send bitstream\n");
+			m_loaded = false;
+			return false;
+		}
+	}
+	
+	//Each load starts its own core as soon as it's done, so start them all again together
+	if( (m_cores > 1) && !SendStart(0x01) )
+		return false;
+	
+	m_bitstream.assign(bitstream, bitstream + m_cores*TRIGGER_BITSTREAM_SIZE);
+	m_loaded = true;
+	return true;
+}
+
+/**
+	@brief Arms the board again with the trigger configuration it already has
+ */
+bool RedTinDevice::Rearm()
+{
+	m_transport->FlushInput();
+	return SendStart(0x01);
+}
+
+/**
+	@brief Waits for the board to trigger, then reads the sample buffer
+ */
+bool RedTinDevice::ReadCapture(Capture& cap)
+{
+	if(m_segments != 0)
+	{
+		printf("segmented captures have to be read into a list of captures\n");
+		return false;
+	}
+	std::vector<Capture> caps;
+	if(!ReadCapture(caps))
+		return false;
+	cap = caps[0];
+	return true;
+}
+
+/**
+	@brief Waits for the board to trigger, then reads the sample buffer as one capture per segment
+ */
+bool RedTinDevice::ReadCapture(std::vector<Capture>& caps)
+{
+	//Wait for data to come back, then read it
+	unsigned char ch = 0;
+	while(ch != 0x55)
+	{
+		if(1 != m_transport->Read(&ch, 1))
+		{
+			perror("couldn't read sync byte");
+			m_loaded = false;
+			return false;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &m_synctime);
+	
+	std::vector<uint64_t> stamps;
+	if( (m_segments != 0) && !ReadStamps(stamps) )
+	{
+		m_loaded = false;
+		return false;
+	}
+	
+	int rowbytes = GetWidth() / 8;
+	std::vector<unsigned char> read_data(DEPTH * rowbytes);
+	std::vector<uint32_t> runs(DEPTH, 1);
+	if(!ReadBlocks(&read_data[0], &runs[0]))
+	{
+		m_loaded = false;
+		return false;
+	}
+	
+	//Segments follow one another in the buffer
+	int segments = 1 << m_segments;
+	int depth = DEPTH >> m_segments;
+	caps.resize(segments);
+	for(int i=0; i<segments; i++)
+	{
+		caps[i] = Capture(GetWidth(), depth);
+		caps[i].LoadRawSamples(&read_data[i * depth * rowbytes], depth);
+		if(m_rle)
+			caps[i].SetRunLengths(&runs[i * depth]);
+		if(!stamps.empty())
+			caps[i].SetTriggerClock(stamps[i]);
+		if(depth >= PRETRIGGER)
+			caps[i].SetTriggerRow(PRETRIGGER - 1);
+	}
+	return true;
+}
+
+/**
+	@brief Does one complete capture, only sending the bitstream if it's not already loaded
+ */
+bool RedTinDevice::RunCapture(const unsigned char* bitstream, Capture& cap)
+{
+	if(m_segments != 0)
+	{
+		printf("segmented captures have to be read into a list of captures\n");
+		return false;
+	}
+	std::vector<Capture> caps;
+	if(!RunCapture(bitstream, caps))
+		return false;
+	cap = caps[0];
+	return true;
+}
+
+/**
+	@brief Does one complete capture with one Capture per segment, only sending the bitstream if it's not
+	already loaded
+ */
+bool RedTinDevice::RunCapture(const unsigned char* bitstream, std::vector<Capture>& caps)
+{
+	if(!Identify())
+		return false;
+	
+	if(m_loaded && (0 == memcmp(&m_bitstream[0], bitstream, m_bitstream.size())))
+	{
+		if(!Rearm())
+			return false;
+	}
+	else if(!LoadTrigger(bitstream))
+		return false;
+	
+	return ReadCapture(caps);
+}
+
+/**
+	@brief Reads the sample buffer block by block, retransmitting any that are damaged or lost
+	
+	Blocks from all cores are interleaved into whole rows, highest core first.
+ */
+bool RedTinDevice::ReadBlocks(unsigned char* data, uint32_t* runs)
+{
+	int total = BLOCK_COUNT * m_cores;
+	std::vector<bool> have(total, false);
+	
+	for(int pass=0; pass<BLOCK_MAX_PASSES; pass++)
+	{
+		//Ask for block 0 of every core, then block 1, and so on
+		std::vector<int> todo;
+		for(int i=0; i<total; i++)
+		{
+			if(!have[i])
+				todo.push_back(i);
+		}
+		if(todo.empty())
+			return true;
+		
+		//Get rid of any partial blocks from the last pass before starting again
+		if(pass > 0)
+		{
+			printf("Retransmitting %d bad blocks\n", static_cast<int>(todo.size()));
+			m_transport->Drain(BLOCK_QUIET_MS);
+		}
+		
+		size_t next = 0;
+		int inflight = 0;
+		while( (next < todo.size()) || (inflight > 0) )
+		{
+			while( (inflight < BLOCK_WINDOW) && (next < todo.size()) )
+			{
+				int n = todo[next++];
+				if(!RequestBlock(n % m_cores, n / m_cores))
+					return false;
+				inflight ++;
+			}
+			
+			//Every good reply answers one request. After a bad one we can't trust where the next starts,
+			//so let everything in flight arrive and throw it away. If nothing comes back it's all lost.
+			int n = ReadBlock(data, runs);
+			if(n >= 0)
+			{
+				have[n] = true;
+				inflight --;
+			}
+			else
+			{
+				if(n == -1)
+					m_transport->Drain(BLOCK_QUIET_MS);
+				inflight = 0;
+			}
+		}
+	}
+	
+	printf("Couldn't read the capture after %d passes\n", BLOCK_MAX_PASSES);
+	return false;
+}
+
+bool RedTinDevice::RequestBlock(int core, int block)
+{
+	if(!SendCommand(0x04))
+		return false;
+	unsigned char num = (core << 5) | block;
+	if(1 != m_transport->WriteLooped(&num, 1))
+	{
+		printf("couldn't send block number\n");
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Reads one block reply and stores it in the sample buffer if it's intact
+	
+	@return The block's index in ReadBlocks() (block * cores + core), -1 if the block was damaged, or -2 if
+	nothing arrived in time
+ */
+int RedTinDevice::ReadBlock(unsigned char* data, uint32_t* runs)
+{
+	//Find the start of the reply
+	unsigned char ch = 0;
+	while(ch != 0xAA)
+	{
+		if(!m_transport->WaitReadable(BLOCK_TIMEOUT_MS) || (1 != m_transport->Read(&ch, 1)))
+			return -2;
+	}
+	
+	//Block number, samples (each with its count if run-length encoded), checksum
+	const int countbytes = m_rle ? COUNT_BYTES : 0;
+	const int blockbytes = BLOCK_SAMPLES * (countbytes + SAMPLE_BYTES);
+	unsigned char reply[1 + BLOCK_SAMPLES*(COUNT_BYTES + SAMPLE_BYTES) + 4];
+	if( (1 + blockbytes + 4) != m_transport->ReadLooped(reply, 1 + blockbytes + 4, BLOCK_TIMEOUT_MS))
+		return -2;
+	
+	uint32_t crc = reply[1 + blockbytes] |
+		(reply[2 + blockbytes] << 8) |
+		(reply[3 + blockbytes] << 16) |
+		(static_cast<uint32_t>(reply[4 + blockbytes]) << 24);
+	if(crc != CRC32(reply, 1 + blockbytes))
+		return -1;
+	int core = reply[0] >> 5;
+	int block = reply[0] & 0x1f;
+	if( (core >= m_cores) || (block >= BLOCK_COUNT) )
+		return -1;
+	
+	//Each sample goes in its core's slice of the row
+	const int row_bytes = SAMPLE_BYTES * m_cores;
+	for(int i=0; i<BLOCK_SAMPLES; i++)
+	{
+		int row = block*BLOCK_SAMPLES + i;
+		const unsigned char* src = reply + 1 + i*(countbytes + SAMPLE_BYTES);
+		if(m_rle)
+			runs[row] = (src[0] << 8) | src[1];
+		memcpy(data + row*row_bytes + (m_cores - 1 - core)*SAMPLE_BYTES, src + countbytes, SAMPLE_BYTES);
+	}
+	return block * m_cores + core;
+}
+
+/**
+	@brief Reads the segment timestamps that follow the sync byte of a segmented capture
+	
+	A damaged packet is asked for again.
+	
+	The board's 32-bit clock counts wrap, so they are unwrapped on the basis that each segment triggers
+	after the one before.
+ */
+bool RedTinDevice::ReadStamps(std::vector<uint64_t>& stamps)
+{
+	uint32_t raw[MAX_SEGMENTS];
+	int status = ReadStampPacket(raw);
+	for(int pass=1; (status < 0) && (pass < BLOCK_MAX_PASSES); pass++)
+	{
+		printf("Retransmitting segment timestamps\n");
+		if(status == -1)
+			m_transport->Drain(BLOCK_QUIET_MS);
+		if(!SendCommand(0x07))
+			return false;
+		status = ReadStampPacket(raw);
+	}
+	if(status < 0)
+	{
+		printf("Couldn't read the segment timestamps\n");
+		return false;
+	}
+	
+	stamps.resize(1 << m_segments);
+	uint64_t last = 0;
+	for(size_t i=0; i<stamps.size(); i++)
+	{
+		uint64_t t = (last & ~0xffffffffULL) | raw[i];
+		if(t < last)
+			t += 0x100000000ULL;
+		stamps[i] = last = t;
+	}
+	return true;
+}
+
+/**
+	@brief Reads one timestamp packet
+	
+	@return 0 if it arrived intact, -1 if it was damaged, or -2 if nothing arrived in time
+ */
+int RedTinDevice::ReadStampPacket(uint32_t* stamps)
+{
+	unsigned char ch = 0;
+	while(ch != 0xA5)
+	{
+		if(!m_transport->WaitReadable(BLOCK_TIMEOUT_MS) || (1 != m_transport->Read(&ch, 1)))
+			return -2;
+	}
+	
+	int count = 1 << m_segments;
+	unsigned char reply[4*MAX_SEGMENTS + 4];
+	if( (4*count + 4) != m_transport->ReadLooped(reply, 4*count + 4, BLOCK_TIMEOUT_MS))
+		return -2;
+	
+	uint32_t crc = reply[4*count] |
+		(reply[4*count + 1] << 8) |
+		(reply[4*count + 2] << 16) |
+		(static_cast<uint32_t>(reply[4*count + 3]) << 24);
+	if(crc != CRC32(reply, 4*count))
+		return -1;
+	
+	for(int i=0; i<count; i++)
+	{
+		const unsigned char* src = reply + 4*i;
+		stamps[i] = (static_cast<uint32_t>(src[0]) << 24) | (src[1] << 16) | (src[2] << 8) | src[3];
+	}
+	return 0;
+}
@@ -0,0 +1,189 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RedTinDevice.h
+	@author Andrew D. Zonenberg
+	@brief Host side of the UART wrapper protocol
+ */
+
+#ifndef RedTinDevice_h
+#define RedTinDevice_h
+
+#include "Capture.h"
+#include "Transport.h"
+#include "TriggerCompiler.h"
+
+#include <time.h>
+#include <vector>
+
+/**
+	@brief One or more logic analyzer cores behind a RedTinUARTWrapper.
+	
+	Every command starts with the magic number 0xFEEDFACE and an opcode byte:
+		0x00	load trigger, followed by the TRIGGER_BITSTREAM_SIZE byte bitstream. Resets and arms the
+				selected core.
+		0x01	re-arm every core using the triggers that are already loaded
+		0x02	as 0x00, with framed readback
+		0x03	as 0x01, with framed readback
+		0x04	read block, followed by the core number (top 3 bits) and block number (low 5 bits)
+		0x05	select the core the next load goes to, followed by the core number
+		0x06	identify: the board replies 0x5A and the number of cores
+		0x07	send the segment timestamps again
+		0x08-0x0B	as 0x00-0x03, with run-length encoding
+		0x10-0x1B	as 0x00-0x0B, segmented; followed by log2 of the segment count
+	
+	Each core watches 128 channels; core 0 has channels 0-127, core 1 has 128-255, and so on. The cores
+	share one trigger: it fires when every core's trigger condition holds, and they all stop together.
+	
+	When the capture finishes the board sends a 0x55 sync byte. Samples are sent oldest first, 16 bytes per
+	sample per core with the highest channel in the MSB of the first byte.
+	
+	With run-length encoding the cores only store a sample when the inputs change, and each sample is
+	preceded by a 16-bit count (MSB first) of the clocks it lasted. The counts are the same in every core.
+	
+	A segmented capture splits the buffer into up to 16 equal segments. Each segment waits for its own
+	trigger, so one arm records a burst of events. The sync byte is followed by 0xA5, the clock at which
+	each segment triggered (32 bits, MSB first, counted from arming), and a CRC-32 of the timestamps. The
+	segments are read back one after another as one buffer.
+	
+	The board also supports unframed readback (opcodes 0x00/0x01), but the host never uses it.
+	
+	With framed readback the host asks for the buffer in blocks of BLOCK_SAMPLES samples. Each block comes
+	back as 0xAA, the block number, the samples, and a CRC-32 of the block number and samples. Blocks that
+	are corrupted or go missing are asked for again, so the capture survives a noisy link. Two requests are
+	kept in flight to hide the turnaround time.
+	
+	The device remembers the last bitstream it loaded and only re-arms the cores if the next capture
+	uses the same one, which saves sending the bitstream over the (slow) UART.
+	
+	Bitstreams passed in hold TRIGGER_BITSTREAM_SIZE bytes per core, core 0 first, as made by
+	CompileTriggers() for GetWidth() channels.
+ */
+class RedTinDevice
+{
+public:
+	RedTinDevice(Transport* transport);
+	
+	void SetRunLengthEncoding(bool rle)
+	{ m_rle = rle; }
+	bool GetRunLengthEncoding() const
+	{ return m_rle; }
+	
+	bool SetSegmentCount(int count);
+	static bool IsValidSegmentCount(int count);
+	
+	///Number of segments the buffer is split into
+	int GetSegmentCount() const
+	{ return 1 << m_segments; }
+	
+	bool Identify();
+	
+	///Number of cores on the board, or 0 if Identify() hasn't been called
+	int GetCoreCount() const
+	{ return m_cores; }
+	
+	///Number of channels on the board, or 0 if Identify() hasn't been called
+	int GetWidth() const
+	{ return m_cores * CORE_WIDTH; }
+	
+	bool LoadTrigger(const unsigned char* bitstream);
+	bool Rearm();
+	bool ReadCapture(Capture& cap);
+	bool ReadCapture(std::vector<Capture>& caps);
+	
+	bool RunCapture(const unsigned char* bitstream, Capture& cap);
+	bool RunCapture(const unsigned char* bitstream, std::vector<Capture>& caps);
+	
+	///When (CLOCK_MONOTONIC) the sync byte of the last capture arrived, to tell waiting from readback
+	const timespec& GetSyncTime() const
+	{ return m_synctime; }
+	
+	///Forgets what's loaded into the board, so the next capture identifies it and sends the bitstream again
+	void Invalidate()
+	{
+		m_loaded = false;
+		m_cores = 0;
+	}
+	
+	enum
+	{
+		DEPTH = 512,
+		MAX_CORES = 8,
+		
+		//Rows kept from before the trigger at the start of each segment. The last of them holds the sample the
+		//trigger fired on, since the trigger logic looks at the inputs a clock late.
+		PRETRIGGER = 16,
+		
+		MAX_SEGMENTS = 16,
+		
+		BLOCK_SAMPLES = 16,
+		BLOCK_COUNT = DEPTH / BLOCK_SAMPLES,
+		
+		//Size of one sample from one core, and its count with run-length encoding
+		SAMPLE_BYTES = CORE_WIDTH / 8,
+		COUNT_BYTES = 2
+	};
+	
+protected:
+	bool SendCommand(unsigned char opcode);
+	bool SendStart(unsigned char opcode);
+	
+	unsigned char GetOpcode(unsigned char opcode) const;
+	
+	bool ReadBlocks(unsigned char* data, uint32_t* runs);
+	bool RequestBlock(int core, int block);
+	int ReadBlock(unsigned char* data, uint32_t* runs);
+	bool ReadStamps(std::vector<uint64_t>& stamps);
+	int ReadStampPacket(uint32_t* stamps);
+
+	Transport* m_transport;
+	
+	///Run-length encode the next capture
+	bool m_rle;
+	
+	///Log2 of the number of segments in the next capture
+	int m_segments;
+	
+	///Number of cores, 0 if unknown
+	int m_cores;
+	
+	///True if m_bitstream is known to be loaded into the cores
+	bool m_loaded;
+	std::vector<unsigned char> m_bitstream;
+	
+	timespec m_synctime;
+};
+
+#endif
@@ -0,0 +1,536 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RedTinModel.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of RedTinModel
+ */
+
+#include "RedTinModel.h"
+#include "Checksum.h"
+
+using namespace std;
+
+///Clocks to wait for a trigger by default
+#define DEFAULT_TIMEOUT (1 << 24)
+
+RedTinModel::RedTinModel(int cores)
+: m_cores(cores)
+, m_words(2 * cores)
+, m_rxstate(RX_MAGIC)
+, m_magic(0)
+, m_loadcount(0)
+, m_loadcore(0)
+, m_framed(false)
+, m_rle(false)
+, m_armed(false)
+, m_segments(0)
+, m_startop(0)
+, m_srl(cores * 8 * 8, 0)
+, m_configured(cores, false)
+, m_state(STATE_RESET)
+, m_start(0)
+, m_end(DEPTH - 1)
+, m_waddr(PRETRIGGER)
+, m_runcount(MAX_RUN)
+, m_segment(0)
+, m_segstart(MAX_SEGMENTS, 0)
+, m_segstamp(MAX_SEGMENTS, 0)
+, m_clockcount(0)
+, m_buffer(DEPTH * m_words, 0)
+, m_counts(DEPTH, 0)
+, m_din(m_words, 0)
+, m_dinbuf(m_words, 0)
+, m_dinbuf2(m_words, 0)
+, m_trigger(false)
+, m_triggerdirty(true)
+, m_clock(0)
+, m_timeout(DEFAULT_TIMEOUT)
+{
+}
+
+RedTinModel::~RedTinModel()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transport
+
+int RedTinModel::Read(unsigned char* buf, int count)
+{
+	int n = 0;
+	while( (n < count) && !m_output.empty() )
+	{
+		buf[n++] = m_output.front();
+		m_output.pop_front();
+	}
+	return n;
+}
+
+int RedTinModel::Write(const unsigned char* buf, int count)
+{
+	for(int i=0; i<count; i++)
+		OnByte(buf[i]);
+	return count;
+}
+
+bool RedTinModel::WaitReadable(int /*timeout_ms*/)
+{
+	return !m_output.empty();
+}
+
+void RedTinModel::FlushInput()
+{
+	m_output.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Wrapper
+
+/**
+	@brief Handles one byte from the host, as RedTinUARTWrapper's receive logic does
+ */
+void RedTinModel::OnByte(unsigned char ch)
+{
+	switch(m_rxstate)
+	{
+		case RX_MAGIC:
+			if(m_magic == 0xfeedface)
+			{
+				m_magic = 0;
+				OnOpcode(ch);
+			}
+			else
+				m_magic = (m_magic << 8) | ch;
+			break;
+		
+		case RX_LOAD:
+			ShiftConfig(m_loadcore, ch);
+			if(++m_loadcount == 256)
+			{
+				if(m_loadcore < m_cores)
+					m_configured[m_loadcore] = true;
+				m_rxstate = RX_MAGIC;
+				if(m_armed)
+					Arm();
+			}
+			break;
+		
+		case RX_CORE:
+			m_loadcore = ch & 7;
+			m_rxstate = RX_MAGIC;
+			break;
+		
+		case RX_BLOCK:
+			if(m_state == STATE_DONE)
+				SendBlock(ch);
+			m_rxstate = RX_MAGIC;
+			break;
+		
+		case RX_SEGMENTS:
+			m_segments = (ch & 7) > 4 ? 4 : (ch & 7);
+			m_rxstate = RX_MAGIC;
+			Start(m_startop);
+			break;
+	}
+}
+
+void RedTinModel::OnOpcode(unsigned char opcode)
+{
+	//Block read
+	if(opcode == 0x04)
+		m_rxstate = RX_BLOCK;
+	
+	//Core select
+	else if(opcode == 0x05)
+		m_rxstate = RX_CORE;
+	
+	//Identify
+	else if(opcode == 0x06)
+	{
+		m_output.push_back(0x5A);
+		m_output.push_back(m_cores);
+	}
+	
+	//Segment timestamps again
+	else if(opcode == 0x07)
+	{
+		if( (m_state == STATE_DONE) && (m_segments != 0) )
+			SendStamps();
+	}
+	
+	//Load or re-arm, segmented ones once the segment count arrives
+	else if(opcode & 0x10)
+	{
+		m_startop = opcode;
+		m_rxstate = RX_SEGMENTS;
+	}
+	else
+	{
+		m_segments = 0;
+		Start(opcode);
+	}
+}
+
+/**
+	@brief Acts on a load or re-arm opcode
+ */
+void RedTinModel::Start(unsigned char opcode)
+{
+	m_framed = (opcode & 0x02) != 0;
+	m_rle = (opcode & 0x08) != 0;
+	if(opcode & 0x01)
+	{
+		m_armed = true;
+		Arm();
+	}
+	
+	//Loading resets the core. With several cores nothing triggers until they're re-armed.
+	else
+	{
+		m_rxstate = RX_LOAD;
+		m_loadcount = 0;
+		if(m_loadcore < m_cores)
+			m_configured[m_loadcore] = false;
+		m_armed = (m_cores == 1);
+		m_state = STATE_RESET;
+	}
+}
+
+/**
+	@brief Clocks one byte of trigger configuration into a core's SRL chains
+	
+	Each bit of the byte feeds one column of eight SRLC32Es, with bit 31 of each SRL shifting into the next.
+ */
+void RedTinModel::ShiftConfig(int core, unsigned char ch)
+{
+	if(core >= m_cores)
+		return;
+	
+	for(int col=0; col<8; col++)
+	{
+		uint32_t* srl = &m_srl[(core*8 + col) * 8];
+		for(int s=7; s>0; s--)
+			srl[s] = (srl[s] << 1) | (srl[s-1] >> 31);
+		srl[0] = (srl[0] << 1) | ((ch >> col) & 1);
+	}
+}
+
+/**
+	@brief Restarts the capture and simulates it until it finishes or times out
+ */
+void RedTinModel::Arm()
+{
+	m_state = STATE_IDLE;
+	m_start = 0;
+	m_end = DEPTH - 1;
+	m_waddr = PRETRIGGER;
+	m_runcount = MAX_RUN;
+	m_segment = 0;
+	m_clockcount = 0;
+	m_triggerdirty = true;
+	
+	//Before the first clock the inputs are taken to have been steady, rather than all zero
+	if(m_clock == 0)
+	{
+		GetInput(0, &m_dinbuf[0]);
+		m_dinbuf2 = m_dinbuf;
+	}
+	
+	for(uint64_t i=0; i<m_timeout; i++)
+	{
+		if(Clock())
+		{
+			m_output.push_back(0x55);
+			if(m_segments != 0)
+				SendStamps();
+			if(!m_framed)
+				SendDump();
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Capture cores
+
+/**
+	@brief Simulates one capture clock of every core
+	
+	@return true if the capture is done
+ */
+bool RedTinModel::Clock()
+{
+	GetInput(m_clock, &m_din[0]);
+	m_clock ++;
+	
+	bool trigger = CheckTrigger() && m_armed;
+	
+	//Pointers count within the current segment
+	unsigned int mask = (DEPTH - 1) >> m_segments;
+	unsigned int base = m_segment * (DEPTH >> m_segments);
+	
+	//Run-length encoding
+	bool store = !m_rle || (m_din != m_dinbuf) || (m_runcount == MAX_RUN);
+	unsigned int run_addr = (m_waddr - 1) & (DEPTH - 1);
+	bool full = m_rle && store && (m_state == STATE_CAPTURING) && (((run_addr ^ m_end) & mask) == 0);
+	bool segdone = (m_state == STATE_CAPTURING) && (m_rle ? full : (((m_waddr ^ m_end) & mask) == 0));
+	
+	//Write to the buffer
+	if( ( (m_state == STATE_IDLE) || (m_state == STATE_CAPTURING) ) && !full)
+	{
+		if(store)
+		{
+			unsigned int addr = base | (m_waddr & mask);
+			for(int w=0; w<m_words; w++)
+				m_buffer[addr*m_words + w] = m_din[w];
+			m_counts[addr] = 1;
+		}
+		else
+			m_counts[base | (run_addr & mask)] = m_runcount + 1;
+	}
+	
+	//End of a segment: go on to the next, or stop after the last
+	if(segdone)
+	{
+		m_segstart[m_segment] = m_start & mask;
+		if(m_segment == (1 << m_segments) - 1)
+			m_state = STATE_DONE;
+		else
+		{
+			m_state = STATE_IDLE;
+			m_runcount = MAX_RUN;
+			m_segment ++;
+			m_start = 0;
+			m_end = DEPTH - 1;
+			m_waddr = PRETRIGGER;
+		}
+	}
+	
+	else switch(m_state)
+	{
+		//Move the pre-trigger window along until triggered
+		case STATE_IDLE:
+			m_runcount = store ? 1 : (m_runcount + 1);
+			if(trigger)
+			{
+				m_state = STATE_CAPTURING;
+				m_segstamp[m_segment] = m_clockcount;
+			}
+			else if(store)
+			{
+				m_start = (m_start + 1) & (DEPTH - 1);
+				m_end = (m_end + 1) & (DEPTH - 1);
+			}
+			if(store)
+				m_waddr = (m_waddr + 1) & (DEPTH - 1);
+			break;
+		
+		//Fill up the rest of the segment
+		case STATE_CAPTURING:
+			if(!m_rle)
+				m_waddr = (m_waddr + 1) & (DEPTH - 1);
+			else
+			{
+				m_runcount = store ? 1 : (m_runcount + 1);
+				if(store)
+					m_waddr = (m_waddr + 1) & (DEPTH - 1);
+			}
+			break;
+		
+		default:
+			break;
+	}
+	m_clockcount ++;
+	
+	//The trigger only needs working out again when the last two clocks' inputs change
+	if( (m_din != m_dinbuf) || (m_dinbuf != m_dinbuf2) )
+		m_triggerdirty = true;
+	m_dinbuf2.swap(m_dinbuf);
+	m_dinbuf.swap(m_din);
+	
+	return (m_state == STATE_DONE);
+}
+
+/**
+	@brief Checks if every core's trigger conditions are met by the last two clocks' inputs
+	
+	Each SRL is addressed by {0, old[2n+1], current[2n+1], old[2n], current[2n]} for a pair of channels.
+	SRL S of column C looks at channels 16*S + 2*C and 16*S + 2*C + 1.
+ */
+bool RedTinModel::CheckTrigger()
+{
+	if(!m_triggerdirty)
+		return m_trigger;
+	m_triggerdirty = false;
+	m_trigger = false;
+	
+	for(int core=0; core<m_cores; core++)
+	{
+		if(!m_configured[core])
+			return false;
+		
+		for(int col=0; col<8; col++)
+		{
+			const uint32_t* srl = &m_srl[(core*8 + col) * 8];
+			for(int s=0; s<8; s++)
+			{
+				int c = 128*core + 16*s + 2*col;
+				int cur0 = (m_dinbuf[c >> 6] >> (c & 63)) & 1;
+				int old0 = (m_dinbuf2[c >> 6] >> (c & 63)) & 1;
+				int cur1 = (m_dinbuf[c >> 6] >> ((c + 1) & 63)) & 1;
+				int old1 = (m_dinbuf2[c >> 6] >> ((c + 1) & 63)) & 1;
+				int addr = (old1 << 3) | (cur1 << 2) | (old0 << 1) | cur0;
+				if(!( (srl[s] >> addr) & 1 ))
+					return false;
+			}
+		}
+	}
+	
+	m_trigger = true;
+	return true;
+}
+
+/**
+	@brief Default inputs: a slow bus
+	
+	The low 32 channels of each core count up every 40 clocks and the rest change every 1000 clocks.
+ */
+void RedTinModel::GetInput(uint64_t clock, uint64_t* din)
+{
+	for(int w=0; w<m_words; w++)
+	{
+		uint64_t slow = (clock / 1000 + w) * 0x9E3779B97F4A7C15ULL;
+		if(w & 1)
+			din[w] = slow;
+		else
+			din[w] = (slow & 0xffffffff00000000ULL) | ((clock / 40) & 0xffffffff);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Readback
+
+/**
+	@brief Gets the buffer address of a row as read back, allowing for where each segment started
+ */
+unsigned int RedTinModel::GetReadAddress(int row)
+{
+	unsigned int mask = (DEPTH - 1) >> m_segments;
+	unsigned int segment = row >> (9 - m_segments);
+	return (row & ~mask) | ((row + m_segstart[segment]) & mask);
+}
+
+/**
+	@brief Formats the count of one sample as the wrapper sends it, MSB first
+ */
+void RedTinModel::SendCount(vector<unsigned char>& out, int row)
+{
+	unsigned int addr = GetReadAddress(row);
+	out.push_back(m_counts[addr] >> 8);
+	out.push_back(m_counts[addr] & 0xff);
+}
+
+/**
+	@brief Formats one sample of one core as the wrapper sends it, MSB first
+ */
+void RedTinModel::SendRow(vector<unsigned char>& out, int row, int core)
+{
+	unsigned int addr = GetReadAddress(row);
+	const uint64_t* din = &m_buffer[addr*m_words + 2*core];
+	for(int j=0; j<16; j++)
+	{
+		int base = 120 - 8*j;
+		out.push_back((din[base >> 6] >> (base & 63)) & 0xff);
+	}
+}
+
+void RedTinModel::SendBlock(unsigned char num)
+{
+	int core = num >> 5;
+	int block = num & 0x1f;
+	if(core >= m_cores)
+		return;
+	
+	vector<unsigned char> data;
+	data.push_back(num);
+	for(int i=0; i<BLOCK_SAMPLES; i++)
+	{
+		if(m_rle)
+			SendCount(data, block*BLOCK_SAMPLES + i);
+		SendRow(data, block*BLOCK_SAMPLES + i, core);
+	}
+	uint32_t crc = CRC32(&data[0], data.size());
+	
+	m_output.push_back(0xAA);
+	m_output.insert(m_output.end(), data.begin(), data.end());
+	for(int i=0; i<4; i++)
+		m_output.push_back((crc >> (8*i)) & 0xff);
+}
+
+/**
+	@brief Sends the whole buffer, each row with its count and then every core, highest first
+ */
+void RedTinModel::SendDump()
+{
+	vector<unsigned char> data;
+	for(int row=0; row<DEPTH; row++)
+	{
+		if(m_rle)
+			SendCount(data, row);
+		for(int core=m_cores-1; core>=0; core--)
+			SendRow(data, row, core);
+	}
+	m_output.insert(m_output.end(), data.begin(), data.end());
+}
+
+/**
+	@brief Sends the trigger clock of every segment, with a checksum
+ */
+void RedTinModel::SendStamps()
+{
+	vector<unsigned char> data;
+	for(int i=0; i<(1 << m_segments); i++)
+	{
+		for(int j=3; j>=0; j--)
+			data.push_back((m_segstamp[i] >> (8*j)) & 0xff);
+	}
+	uint32_t crc = CRC32(&data[0], data.size());
+	
+	m_output.push_back(0xA5);
+	m_output.insert(m_output.end(), data.begin(), data.end());
+	for(int i=0; i<4; i++)
+		m_output.push_back((crc >> (8*i)) & 0xff);
+}
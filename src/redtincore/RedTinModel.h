@@ -0,0 +1,183 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RedTinModel.h
+	@author Andrew D. Zonenberg
+	@brief Software model of the capture hardware
+ */
+
+#ifndef RedTinModel_h
+#define RedTinModel_h
+
+#include "Transport.h"
+
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+/**
+	@brief Software model of a RedTinUARTWrapper and its RedTinLogicAnalyzer cores, for trying out the host
+	software without a board.
+	
+	Commands written to the model are handled the way the wrapper handles them, and replies are queued up
+	for Read(). Captures are simulated one capture clock at a time with the same trigger LUTs, circular
+	buffer, run-length encoding and segmenting as the cores. A capture runs to completion as soon as the board is armed,
+	so there is never anything to wait for; if the trigger doesn't fire within the timeout the sync byte
+	never arrives, as with a real board.
+	
+	The inputs come from GetInput(). The default is a slow bus that only changes every few dozen clocks;
+	override it to model a particular circuit.
+ */
+class RedTinModel : public Transport
+{
+public:
+	RedTinModel(int cores = 1);
+	virtual ~RedTinModel();
+	
+	virtual int Read(unsigned char* buf, int count);
+	virtual int Write(const unsigned char* buf, int count);
+	virtual bool WaitReadable(int timeout_ms);
+	virtual void FlushInput();
+	
+	int GetCoreCount() const
+	{ return m_cores; }
+	
+	///Number of capture clocks simulated so far
+	uint64_t GetClock() const
+	{ return m_clock; }
+	
+	///Sets the most clocks to wait for a trigger
+	void SetTimeout(uint64_t clocks)
+	{ m_timeout = clocks; }
+	
+	enum
+	{
+		DEPTH = 512,
+		PRETRIGGER = 16,
+		MAX_RUN = 0xFFFF,
+		BLOCK_SAMPLES = 16,
+		MAX_SEGMENTS = 16
+	};
+	
+protected:
+	virtual void GetInput(uint64_t clock, uint64_t* din);
+	
+	void OnByte(unsigned char ch);
+	void OnOpcode(unsigned char opcode);
+	void Start(unsigned char opcode);
+	void ShiftConfig(int core, unsigned char ch);
+	void Arm();
+	bool Clock();
+	bool CheckTrigger();
+	
+	unsigned int GetReadAddress(int row);
+	void SendCount(std::vector<unsigned char>& out, int row);
+	void SendRow(std::vector<unsigned char>& out, int row, int core);
+	void SendBlock(unsigned char num);
+	void SendDump();
+	void SendStamps();
+	
+	int m_cores;
+	
+	///Words of input per clock, two for each core
+	int m_words;
+	
+	//Command parsing
+	enum
+	{
+		RX_MAGIC,
+		RX_LOAD,
+		RX_CORE,
+		RX_BLOCK,
+		RX_SEGMENTS
+	} m_rxstate;
+	uint32_t m_magic;
+	int m_loadcount;
+	int m_loadcore;
+	
+	//Wrapper settings
+	bool m_framed;
+	bool m_rle;
+	bool m_armed;
+	
+	///Log2 of the number of segments
+	int m_segments;
+	
+	///Segmented load or re-arm waiting for its segment count
+	unsigned char m_startop;
+	
+	///Trigger shift registers: 8 columns of 8 SRLs for each core
+	std::vector<uint32_t> m_srl;
+	std::vector<bool> m_configured;
+	
+	//Capture state. The cores always run in lockstep so they share it.
+	enum
+	{
+		STATE_IDLE,
+		STATE_CAPTURING,
+		STATE_DONE,
+		STATE_RESET
+	} m_state;
+	unsigned int m_start;
+	unsigned int m_end;
+	unsigned int m_waddr;
+	uint32_t m_runcount;
+	
+	///Segment being captured, and where each one started and when it triggered
+	int m_segment;
+	std::vector<unsigned int> m_segstart;
+	std::vector<uint32_t> m_segstamp;
+	uint32_t m_clockcount;
+	
+	std::vector<uint64_t> m_buffer;
+	std::vector<uint16_t> m_counts;
+	
+	///Inputs this clock, last clock and the one before
+	std::vector<uint64_t> m_din;
+	std::vector<uint64_t> m_dinbuf;
+	std::vector<uint64_t> m_dinbuf2;
+	
+	///Last trigger result, and whether the inputs have changed since it was worked out
+	bool m_trigger;
+	bool m_triggerdirty;
+	
+	uint64_t m_clock;
+	uint64_t m_timeout;
+	
+	///Bytes sent by the board and not read yet
+	std::deque<unsigned char> m_output;
+};
+
+#endif
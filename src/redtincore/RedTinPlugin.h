@@ -0,0 +1,136 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file RedTinPlugin.h
+	@author Andrew D. Zonenberg
+	@brief Interface between the host software and capture analysis plugins
+	
+	This header is plain C so plugins can be written in C or C++ and built without the rest of the host
+	software. A plugin is a shared object exporting two functions:
+	
+		int redtin_plugin_version(void);
+			Returns REDTIN_PLUGIN_API_VERSION as it was when the plugin was built.
+		
+		int redtin_plugin_analyze(const struct redtin_capture* cap, struct redtin_host* host);
+			Called once for every capture (every segment of a segmented capture), right after readback.
+			Returns one of the REDTIN_VERDICT_* values.
+	
+	Everything in the capture points straight into the host's copy of the samples and is only valid for the
+	duration of the call. Plugins must not write to it.
+ */
+
+#ifndef RedTinPlugin_h
+#define RedTinPlugin_h
+
+#include <stdint.h>
+
+#define REDTIN_PLUGIN_API_VERSION 1
+
+#define REDTIN_VERDICT_NONE	0
+#define REDTIN_VERDICT_PASS	1
+#define REDTIN_VERDICT_FAIL	2
+
+/**
+	@brief One signal of a capture
+ */
+struct redtin_signal
+{
+	const char* name;
+	int width;
+	
+	///Channel of the signal's LSB in the packed rows
+	int lowbit;
+	
+	///Value at each sample, colwords 64-bit words per sample with the LSB in the first word
+	int colwords;
+	const uint64_t* column;
+};
+
+/**
+	@brief Read-only view of a capture
+ */
+struct redtin_capture
+{
+	///Number of channels
+	int width;
+	
+	///Number of samples
+	int depth;
+	
+	///Packed samples, rowwords 64-bit words each. Bit N of a row is channel N: word 0 holds channels
+	///63...0, word 1 holds 127...64, and so on.
+	int rowwords;
+	const uint64_t* rows;
+	
+	///Start time of each sample in capture clocks, plus the end of the capture (depth + 1 entries), or NULL
+	///if sample N starts at time N
+	const uint64_t* times;
+	
+	///Sample rate in MHz
+	double samplerate;
+	
+	///Time the capture was taken (seconds since the epoch)
+	int64_t timestamp;
+	
+	///Hash of the signal and trigger configuration
+	uint64_t confighash;
+	
+	///Capture clock, counted from arming, at which a segment of a segmented capture triggered
+	uint64_t triggerclock;
+	
+	int nsignals;
+	const struct redtin_signal* signals;
+};
+
+/**
+	@brief Services the host offers a plugin during redtin_plugin_analyze()
+ */
+struct redtin_host
+{
+	///Host's own state, not for plugin use
+	void* context;
+	
+	///Gets a parameter from the signal configuration file, or NULL if it's not set
+	const char* (*get_parameter)(struct redtin_host* host, const char* name);
+	
+	///Attaches a message to a sample of the capture (sample -1 for the capture as a whole)
+	void (*annotate)(struct redtin_host* host, int sample, const char* message);
+	
+	///File name, without extension, that exports of this capture are written to. Plugins writing files of
+	///their own should name them after this.
+	const char* export_path;
+};
+
+#endif
@@ -0,0 +1,270 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file ReplayTransport.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of ReplayTransport
+ */
+
+#include "ReplayTransport.h"
+#include "ByteOrder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+using namespace std;
+
+static uint64_t GetMonotonicNs()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void SleepNs(uint64_t ns)
+{
+	timespec t;
+	t.tv_sec = ns / 1000000000ULL;
+	t.tv_nsec = ns % 1000000000ULL;
+	nanosleep(&t, NULL);
+}
+
+ReplayTransport::ReplayTransport()
+: m_readevent(0)
+, m_readpos(0)
+, m_writeevent(0)
+, m_writepos(0)
+, m_realtime(false)
+, m_lastwriterecorded(0)
+, m_lastwritereal(0)
+, m_diverged(false)
+{
+}
+
+/**
+	@brief Loads a recording
+	
+	@param fname		The file written by RecordingTransport
+	@param realtime		True to deliver data with the original timing, false for as fast as possible
+ */
+bool ReplayTransport::Open(string fname, bool realtime)
+{
+	FILE* fp = fopen(fname.c_str(), "rb");
+	if(fp == NULL)
+	{
+		perror("couldn't open recording");
+		return false;
+	}
+	m_data.clear();
+	char buf[65536];
+	size_t len;
+	while( (len = fread(buf, 1, sizeof(buf), fp)) > 0)
+		m_data.append(buf, len);
+	fclose(fp);
+	
+	size_t pos = strlen(RECORDING_MAGIC);
+	if(m_data.compare(0, pos, RECORDING_MAGIC) != 0)
+	{
+		printf("%s is not a RED TIN recording\n", fname.c_str());
+		return false;
+	}
+	
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(m_data.c_str());
+	m_events.clear();
+	while(pos + 13 <= m_data.length())
+	{
+		ReplayEvent event;
+		event.type = data[pos];
+		event.time = ReadLE64(data + pos + 1);
+		event.length = ReadLE32(data + pos + 9);
+		event.offset = pos + 13;
+		if(event.offset + event.length > m_data.length())
+			break;
+		m_events.push_back(event);
+		pos = event.offset + event.length;
+	}
+	if(pos != m_data.length())
+		printf("warning: recording %s is truncated\n", fname.c_str());
+	
+	m_readevent = 0;
+	m_readpos = 0;
+	m_writeevent = 0;
+	m_writepos = 0;
+	SkipTo(m_readevent, RecordingTransport::RECORD_READ);
+	SkipTo(m_writeevent, RecordingTransport::RECORD_WRITE);
+	m_realtime = realtime;
+	m_lastwriterecorded = 0;
+	m_lastwritereal = GetMonotonicNs();
+	m_diverged = false;
+	return true;
+}
+
+/**
+	@brief Moves forward to the next event of a type, or the end
+ */
+void ReplayTransport::SkipTo(size_t& event, char type)
+{
+	while( (event < m_events.size()) && (m_events[event].type != type) )
+		event++;
+}
+
+/**
+	@brief Checks if the host has written everything that came before the next chunk of read data
+ */
+bool ReplayTransport::IsReadable() const
+{
+	return (m_readevent < m_events.size()) && (m_readevent < m_writeevent);
+}
+
+/**
+	@brief Monotonic time at which the next chunk of read data arrives with the original timing
+ */
+uint64_t ReplayTransport::GetReadyTime() const
+{
+	uint64_t t = m_events[m_readevent].time;
+	if(t < m_lastwriterecorded)
+		return m_lastwritereal;
+	return m_lastwritereal + (t - m_lastwriterecorded);
+}
+
+int ReplayTransport::Read(unsigned char* buf, int count)
+{
+	//End of the recording, or the host wants data it hadn't asked for yet when recording
+	if(!IsReadable())
+		return 0;
+	
+	if(m_realtime)
+	{
+		uint64_t now = GetMonotonicNs();
+		uint64_t ready = GetReadyTime();
+		if(ready > now)
+			SleepNs(ready - now);
+	}
+	
+	//At full speed, run on into as many chunks as are readable
+	int n = 0;
+	while( (n < count) && IsReadable() )
+	{
+		const ReplayEvent& event = m_events[m_readevent];
+		size_t len = event.length - m_readpos;
+		if(len > static_cast<size_t>(count - n))
+			len = count - n;
+		memcpy(buf + n, m_data.c_str() + event.offset + m_readpos, len);
+		n += len;
+		m_readpos += len;
+		
+		if(m_readpos == event.length)
+		{
+			m_readevent++;
+			m_readpos = 0;
+			SkipTo(m_readevent, RecordingTransport::RECORD_READ);
+			if(m_realtime)
+				break;
+		}
+	}
+	return n;
+}
+
+int ReplayTransport::Write(const unsigned char* buf, int count)
+{
+	int n = 0;
+	while( (n < count) && (m_writeevent < m_events.size()) )
+	{
+		const ReplayEvent& event = m_events[m_writeevent];
+		size_t len = event.length - m_writepos;
+		if(len > static_cast<size_t>(count - n))
+			len = count - n;
+		if(!m_diverged && (0 != memcmp(buf + n, m_data.c_str() + event.offset + m_writepos, len)) )
+		{
+			printf("warning: host wrote something different than in the recording, replay has diverged\n");
+			m_diverged = true;
+		}
+		n += len;
+		m_writepos += len;
+		
+		if(m_writepos == event.length)
+		{
+			m_lastwriterecorded = event.time;
+			m_lastwritereal = GetMonotonicNs();
+			m_writeevent++;
+			m_writepos = 0;
+			SkipTo(m_writeevent, RecordingTransport::RECORD_WRITE);
+		}
+	}
+	
+	//Writing past the end of the recording
+	if( (n < count) && !m_diverged)
+	{
+		printf("warning: host wrote more than in the recording, replay has diverged\n");
+		m_diverged = true;
+	}
+	
+	return count;
+}
+
+bool ReplayTransport::WaitReadable(int timeout_ms)
+{
+	uint64_t timeout = static_cast<uint64_t>(timeout_ms) * 1000000ULL;
+	
+	//Nothing more is coming until the host writes something, so it was a timeout in the recording too
+	if(!IsReadable())
+	{
+		if(m_realtime && (timeout_ms > 0))
+			SleepNs(timeout);
+		return false;
+	}
+	
+	if(m_realtime)
+	{
+		uint64_t now = GetMonotonicNs();
+		uint64_t ready = GetReadyTime();
+		if( (timeout_ms >= 0) && (ready > now + timeout) )
+		{
+			SleepNs(timeout);
+			return false;
+		}
+		if(ready > now)
+			SleepNs(ready - now);
+	}
+	return true;
+}
+
+/**
+	@brief Does nothing, since anything the board sent that the host flushed was never recorded
+ */
+void ReplayTransport::FlushInput()
+{
+}
@@ -0,0 +1,119 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file ReplayTransport.h
+	@author Andrew D. Zonenberg
+	@brief Plays back traffic recorded by RecordingTransport
+ */
+
+#ifndef ReplayTransport_h
+#define ReplayTransport_h
+
+#include "RecordingTransport.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+	@brief One chunk of recorded data
+ */
+class ReplayEvent
+{
+public:
+	char type;
+	
+	///Nanoseconds since the start of the recording
+	uint64_t time;
+	
+	///Position of the data in the file
+	size_t offset;
+	size_t length;
+};
+
+/**
+	@brief Stands in for the board by playing back a recording, so host-side changes can be profiled and compared on
+	identical traffic.
+	
+	Data received from the board only becomes readable once the host has written everything it had written
+	before that data arrived in the recording, so timeouts (e.g. waiting for an identify reply from an old board)
+	happen just as they did originally. Writes are checked against the recording; if they differ, the host no
+	longer behaves the way it did when the recording was made and the replay is reported as diverged.
+	
+	At full speed, data is readable as soon as the host has caught up to it. At original timing, each chunk
+	arrives as long after the host's last write as it did in the recording.
+ */
+class ReplayTransport : public Transport
+{
+public:
+	ReplayTransport();
+	
+	bool Open(std::string fname, bool realtime);
+	
+	virtual int Read(unsigned char* buf, int count);
+	virtual int Write(const unsigned char* buf, int count);
+	virtual bool WaitReadable(int timeout_ms);
+	virtual void FlushInput();
+	
+	/**
+		@brief True if the host wrote anything other than what was recorded
+	 */
+	bool HasDiverged() const
+	{ return m_diverged; }
+	
+protected:
+	void SkipTo(size_t& event, char type);
+	bool IsReadable() const;
+	uint64_t GetReadyTime() const;
+	
+	std::string m_data;
+	std::vector<ReplayEvent> m_events;
+	
+	//Next event of each type with data left, and how much of it has been used
+	size_t m_readevent;
+	size_t m_readpos;
+	size_t m_writeevent;
+	size_t m_writepos;
+	
+	bool m_realtime;
+	
+	//Recorded and actual monotonic times, in nanoseconds, of the host's last write
+	uint64_t m_lastwriterecorded;
+	uint64_t m_lastwritereal;
+	
+	bool m_diverged;
+};
+
+#endif
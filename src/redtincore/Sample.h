@@ -0,0 +1,212 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Sample.h
+	@author Andrew D. Zonenberg
+	@brief Fixed-width sample rows and the kernels specialized on them
+ */
+
+#ifndef Sample_h
+#define Sample_h
+
+#include <stdint.h>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+	@brief One packed sample row of N 64-bit words, in the same layout as Capture rows
+	
+	Captures are as wide as the board they came from, so the row width is only known at run time. The inner loops
+	that touch every row are instantiated here for each common width, where the per-word loops unroll completely,
+	and callers pick an instantiation with a switch on Capture::GetRowWords(). Any other width takes the callers'
+	existing run-time width loops.
+ */
+template<int N> class Sample
+{
+public:
+	uint64_t words[N];
+	
+	void Load(const uint64_t* row)
+	{
+		for(int k=0; k<N; k++)
+			words[k] = row[k];
+	}
+	
+	/**
+		@brief Loads a row as sent by the capture module, N*8 bytes with the highest channels first
+	 */
+	void LoadRaw(const unsigned char* raw)
+	{
+		for(int k=0; k<N; k++)
+		{
+			const unsigned char* p = raw + 8*(N - 1 - k);
+			uint64_t v = 0;
+			for(int b=0; b<8; b++)
+				v = (v << 8) | p[b];
+			words[k] = v;
+		}
+	}
+	
+	void Store(uint64_t* row) const
+	{
+		for(int k=0; k<N; k++)
+			row[k] = words[k];
+	}
+	
+	/**
+		@brief Bits which differ from a value where the mask is set, ORed together
+		
+		With SSE2 two words are compared at a time and the halves ORed at the end.
+	 */
+	uint64_t Miss(const Sample& value, const Sample& mask) const
+	{
+		uint64_t miss = 0;
+		int k = 0;
+#ifdef __SSE2__
+		__m128i vmiss = _mm_setzero_si128();
+		for(; k+1<N; k+=2)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + k));
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value.words + k));
+			__m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask.words + k));
+			vmiss = _mm_or_si128(vmiss, _mm_and_si128(_mm_xor_si128(x, v), m));
+		}
+		vmiss = _mm_or_si128(vmiss, _mm_unpackhi_epi64(vmiss, vmiss));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(&miss), vmiss);
+#endif
+		for(; k<N; k++)
+			miss |= (words[k] ^ value.words[k]) & mask.words[k];
+		return miss;
+	}
+	
+	/**
+		@brief Gets 64 channels starting at lowbit; channels past the end of the row read as zero
+	 */
+	uint64_t Extract(int lowbit) const
+	{
+		int nword = lowbit >> 6;
+		int shift = lowbit & 63;
+		uint64_t v = words[nword] >> shift;
+		if( (shift != 0) && (nword + 1 < N) )
+			v |= words[nword + 1] << (64 - shift);
+		return v;
+	}
+};
+
+/**
+	@brief Converts raw rows from the capture module into packed rows
+ */
+template<int N> void LoadRawRows(const unsigned char* raw, int depth, uint64_t* rows)
+{
+	Sample<N> s;
+	for(int i=0; i<depth; i++)
+	{
+		s.LoadRaw(raw + i*N*8);
+		s.Store(rows + i*N);
+	}
+}
+
+/**
+	@brief Pulls a signal of at most 64 bits out of every row, one word per row
+ */
+template<int N> void ExtractNarrowColumn(const uint64_t* rows, int depth, int lowbit, int width, uint64_t* out)
+{
+	uint64_t mask = (width == 64) ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << width) - 1);
+	Sample<N> s;
+	for(int i=0; i<depth; i++)
+	{
+		s.Load(rows + i*N);
+		out[i] = s.Extract(lowbit) & mask;
+	}
+}
+
+/**
+	@brief Finds every row that matches a value under a mask, and optionally whose previous row matches another
+	
+	@param rows			Packed rows
+	@param depth		Number of rows
+	@param value		Value the row must have where mask is set
+	@param mask			Bits of the row that matter
+	@param prevvalue	Value the previous row must have where prevmask is set
+	@param prevmask		Bits of the previous row that matter, or NULL to ignore it
+	@param matches		Row numbers are appended here
+ */
+template<int N> void SearchRows(
+	const uint64_t* rows,
+	int depth,
+	const uint64_t* value,
+	const uint64_t* mask,
+	const uint64_t* prevvalue,
+	const uint64_t* prevmask,
+	std::vector<int>& matches)
+{
+	Sample<N> v;
+	Sample<N> m;
+	v.Load(value);
+	m.Load(mask);
+	
+	if(prevmask == NULL)
+	{
+		Sample<N> row;
+		for(int i=0; i<depth; i++)
+		{
+			row.Load(rows + i*N);
+			if(row.Miss(v, m) == 0)
+				matches.push_back(i);
+		}
+		return;
+	}
+	
+	Sample<N> pv;
+	Sample<N> pm;
+	pv.Load(prevvalue);
+	pm.Load(prevmask);
+	Sample<N> prev;
+	Sample<N> row;
+	if(depth > 0)
+		row.Load(rows);
+	for(int i=1; i<depth; i++)
+	{
+		prev = row;
+		row.Load(rows + i*N);
+		if( (row.Miss(v, m) | prev.Miss(pv, pm)) == 0)
+			matches.push_back(i);
+	}
+}
+
+#endif
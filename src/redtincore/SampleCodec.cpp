@@ -0,0 +1,269 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file SampleCodec.cpp
+	@author Andrew D. Zonenberg
+	@brief Compression of sample data for the capture archive
+	
+	Samples are XOR-delta coded against the previous row, which turns every channel that didn't change
+	into zero bits, and the result is packed with a byte-oriented LZ77 coder using the LZ4 block format.
+	Most signals are idle most of the time so this typically compresses a capture by one to two orders
+	of magnitude while decoding at memory speed.
+ */
+
+#include "SampleCodec.h"
+
+#include <string.h>
+
+using namespace std;
+
+//LZ4 block format constants
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5;			//the last 5 bytes are always literals
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 12;
+
+static inline uint32_t Read32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint32_t HashSequence(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static void WriteLength(vector<unsigned char>& out, size_t len)
+{
+	while(len >= 255)
+	{
+		out.push_back(255);
+		len -= 255;
+	}
+	out.push_back(len);
+}
+
+static void WriteSequence(
+	vector<unsigned char>& out,
+	const unsigned char* literals,
+	size_t nliterals,
+	size_t offset,
+	size_t matchlen)
+{
+	//Token: literal count in the high nibble, match length (minus the minimum) in the low nibble
+	size_t mlcode = (matchlen == 0) ? 0 : (matchlen - MIN_MATCH);
+	unsigned char token = ((nliterals < 15) ? nliterals : 15) << 4;
+	if(matchlen != 0)
+		token |= (mlcode < 15) ? mlcode : 15;
+	out.push_back(token);
+	
+	if(nliterals >= 15)
+		WriteLength(out, nliterals - 15);
+	out.insert(out.end(), literals, literals + nliterals);
+	
+	//Final sequence has no match
+	if(matchlen == 0)
+		return;
+		
+	out.push_back(offset & 0xff);
+	out.push_back(offset >> 8);
+	if(mlcode >= 15)
+		WriteLength(out, mlcode - 15);
+}
+
+/**
+	@brief Compresses a block of data in LZ4 block format (appended to out)
+ */
+void LZCompress(const unsigned char* in, size_t len, std::vector<unsigned char>& out)
+{
+	vector<size_t> table(1 << HASH_BITS, static_cast<size_t>(-1));
+	
+	size_t anchor = 0;
+	size_t pos = 0;
+	if(len > LAST_LITERALS + MIN_MATCH)
+	{
+		size_t limit = len - LAST_LITERALS - MIN_MATCH;
+		while(pos <= limit)
+		{
+			uint32_t seq = Read32(in + pos);
+			uint32_t h = HashSequence(seq);
+			size_t candidate = table[h];
+			table[h] = pos;
+			
+			if( (candidate == static_cast<size_t>(-1)) || (pos - candidate > MAX_OFFSET) ||
+				(Read32(in + candidate) != seq) )
+			{
+				pos ++;
+				continue;
+			}
+			
+			//Found a match, see how far it goes
+			size_t matchlen = MIN_MATCH;
+			size_t maxlen = len - LAST_LITERALS - pos;
+			while( (matchlen < maxlen) && (in[candidate + matchlen] == in[pos + matchlen]) )
+				matchlen ++;
+				
+			WriteSequence(out, in + anchor, pos - anchor, pos - candidate, matchlen);
+			pos += matchlen;
+			anchor = pos;
+		}
+	}
+	
+	//Everything left over is literals
+	WriteSequence(out, in + anchor, len - anchor, 0, 0);
+}
+
+/**
+	@brief Decompresses a block produced by LZCompress()
+	
+	@return true if the block decoded to exactly outlen bytes
+ */
+bool LZDecompress(const unsigned char* in, size_t len, unsigned char* out, size_t outlen)
+{
+	size_t ipos = 0;
+	size_t opos = 0;
+	while(ipos < len)
+	{
+		unsigned char token = in[ipos++];
+		
+		//Literals
+		size_t nliterals = token >> 4;
+		if(nliterals == 15)
+		{
+			unsigned char b;
+			do
+			{
+				if(ipos >= len)
+					return false;
+				b = in[ipos++];
+				nliterals += b;
+			} while(b == 255);
+		}
+		if( (nliterals > len - ipos) || (nliterals > outlen - opos) )
+			return false;
+		memcpy(out + opos, in + ipos, nliterals);
+		ipos += nliterals;
+		opos += nliterals;
+		
+		//End of the block
+		if(ipos == len)
+			break;
+			
+		//Match
+		if(ipos + 2 > len)
+			return false;
+		size_t offset = in[ipos] | (in[ipos+1] << 8);
+		ipos += 2;
+		size_t matchlen = (token & 0xf);
+		if(matchlen == 15)
+		{
+			unsigned char b;
+			do
+			{
+				if(ipos >= len)
+					return false;
+				b = in[ipos++];
+				matchlen += b;
+			} while(b == 255);
+		}
+		matchlen += MIN_MATCH;
+		if( (offset == 0) || (offset > opos) || (matchlen > outlen - opos) )
+			return false;
+			
+		//Matches may overlap the output so copy a byte at a time
+		for(size_t i=0; i<matchlen; i++, opos++)
+			out[opos] = out[opos - offset];
+	}
+	
+	return (opos == outlen);
+}
+
+/**
+	@brief XOR-delta codes and compresses the samples of a capture
+ */
+void CompressSamples(const Capture& cap, std::vector<unsigned char>& out)
+{
+	int rowwords = cap.GetRowWords();
+	vector<unsigned char> delta(cap.GetDepth() * rowwords * 8);
+	
+	unsigned char* p = delta.empty() ? NULL : &delta[0];
+	for(int i=0; i<cap.GetDepth(); i++)
+	{
+		const uint64_t* row = cap.GetRow(i);
+		for(int k=0; k<rowwords; k++)
+		{
+			uint64_t v = row[k];
+			if(i != 0)
+				v ^= row[k - rowwords];
+			for(int b=0; b<8; b++)
+				*p++ = (v >> (8*b)) & 0xff;
+		}
+	}
+	
+	LZCompress(delta.empty() ? NULL : &delta[0], delta.size(), out);
+}
+
+/**
+	@brief Decompresses samples produced by CompressSamples() into a capture of the right width and depth
+ */
+bool DecompressSamples(const unsigned char* in, size_t len, Capture& cap)
+{
+	int rowwords = cap.GetRowWords();
+	vector<unsigned char> delta(cap.GetDepth() * rowwords * 8);
+	if(delta.empty())
+		return true;
+	if(!LZDecompress(in, len, &delta[0], delta.size()))
+		return false;
+	
+	vector<uint64_t> rows(cap.GetDepth() * rowwords);
+	const unsigned char* p = &delta[0];
+	for(int i=0; i<cap.GetDepth(); i++)
+	{
+		for(int k=0; k<rowwords; k++)
+		{
+			uint64_t v = 0;
+			for(int b=0; b<8; b++)
+				v |= static_cast<uint64_t>(*p++) << (8*b);
+			if(i != 0)
+				v ^= rows[(i-1)*rowwords + k];
+			rows[i*rowwords + k] = v;
+		}
+	}
+	
+	cap.LoadRows(&rows[0], cap.GetDepth());
+	return true;
+}
@@ -0,0 +1,342 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file SignalConditioner.cpp
+	@author Andrew D. Zonenberg
+	@brief Cleaning up noisy inputs before a capture is exported or analyzed
+ */
+
+#include "SignalConditioner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+SignalConditioner::SignalConditioner()
+: m_rowwords(0)
+, m_empty(true)
+, m_counterbits(0)
+, m_maxlimit(0)
+{
+}
+
+/**
+	@brief Compiles the filters of a config
+	
+	@param config	The config, for its filters and UNUSED_CHANNELS
+	@param signals	Signals (with bit positions assigned) the filters refer to
+	@param width	Width of the captures to be filtered, in channels
+	
+	@return true on success, false if a filter is invalid (see GetError())
+ */
+bool SignalConditioner::Compile(const CaptureConfig& config, const vector<Signal>& signals, int width)
+{
+	m_rowwords = (width + 63) >> 6;
+	m_invert.assign(m_rowwords, 0);
+	m_keep.assign(m_rowwords, ~static_cast<uint64_t>(0));
+	m_debounce.assign(m_rowwords, 0);
+	m_deglitch.assign(m_rowwords, 0);
+	m_limit.clear();
+	m_counterbits = 0;
+	m_maxlimit = 0;
+	m_empty = true;
+	m_error = "";
+	
+	//Everything that isn't a signal goes, if asked
+	if(config.MasksUnusedChannels())
+	{
+		m_keep.assign(m_rowwords, 0);
+		for(size_t i=0; i<signals.size(); i++)
+		{
+			for(int c=signals[i].lowbit; c<=signals[i].highbit; c++)
+			{
+				if( (c >= 0) && (c < m_rowwords*64) )
+					m_keep[c >> 6] |= static_cast<uint64_t>(1) << (c & 63);
+			}
+		}
+	}
+	
+	vector<int> limits(m_rowwords * 64, 0);
+	for(size_t i=0; i<config.filters.size(); i++)
+	{
+		const SignalFilter& f = config.filters[i];
+		
+		size_t nsig = 0;
+		while( (nsig < signals.size()) && (signals[nsig].name != f.signalname) )
+			nsig ++;
+		if(nsig == signals.size())
+		{
+			m_error = "filter on \"" + f.signalname + "\", which isn't one of the captured signals";
+			return false;
+		}
+		const Signal& sig = signals[nsig];
+		if( (sig.lowbit < 0) || (sig.lowbit + sig.width > m_rowwords * 64) )
+		{
+			m_error = "signal \"" + sig.name + "\" is not in the capture";
+			return false;
+		}
+		bool timed = (f.filtertype == SignalFilter::FILTER_DEGLITCH) || (f.filtertype == SignalFilter::FILTER_DEBOUNCE);
+		if( timed && ( (f.clocks < 1) || (f.clocks > MAX_CLOCKS) ) )
+		{
+			char msg[256];
+			snprintf(msg, sizeof(msg), "filter on \"%s\" must be between 1 and %d clocks", sig.name.c_str(), MAX_CLOCKS);
+			m_error = msg;
+			return false;
+		}
+		
+		for(int c=sig.lowbit; c<sig.lowbit+sig.width; c++)
+		{
+			uint64_t b = static_cast<uint64_t>(1) << (c & 63);
+			int w = c >> 6;
+			switch(f.filtertype)
+			{
+				case SignalFilter::FILTER_INVERT:
+					m_invert[w] |= b;
+					break;
+				case SignalFilter::FILTER_MASK:
+					m_keep[w] &= ~b;
+					break;
+				default:
+					if(limits[c] != 0)
+					{
+						m_error = "signal \"" + sig.name + "\" has more than one deglitch or debounce filter";
+						return false;
+					}
+					limits[c] = f.clocks;
+					
+					//One clock is the shortest anything can be, so there's nothing to do
+					if(f.clocks == 1)
+						break;
+					if(f.filtertype == SignalFilter::FILTER_DEGLITCH)
+						m_deglitch[w] |= b;
+					else
+						m_debounce[w] |= b;
+					if(f.clocks > m_maxlimit)
+						m_maxlimit = f.clocks;
+					break;
+			}
+		}
+	}
+	
+	//Counters have to hold a level's age plus one row's run length before it's clamped to the limit,
+	//so one bit more than the largest limit needs
+	if(m_maxlimit > 0)
+	{
+		m_counterbits = 1;
+		while( (1 << (m_counterbits - 1)) <= m_maxlimit )
+			m_counterbits ++;
+	}
+	m_limit.assign(m_counterbits * m_rowwords, 0);
+	for(int c=0; c<m_rowwords*64; c++)
+	{
+		int w = c >> 6;
+		uint64_t b = static_cast<uint64_t>(1) << (c & 63);
+		if( (limits[c] < 2) || !( (m_deglitch[w] | m_debounce[w]) & b ) )
+			continue;
+		for(int k=0; k<m_counterbits; k++)
+		{
+			if( (limits[c] >> k) & 1 )
+				m_limit[k*m_rowwords + w] |= b;
+		}
+	}
+	
+	for(int w=0; w<m_rowwords; w++)
+	{
+		if( (m_invert[w] != 0) || (~m_keep[w] != 0) || (m_deglitch[w] != 0) || (m_debounce[w] != 0) )
+			m_empty = false;
+	}
+	return true;
+}
+
+/**
+	@brief Finds the channels that, by the end of each row, have held their level for at least their limit
+	
+	Channels without a deglitch or debounce filter have a limit of zero, so are always stable.
+	
+	@param rows		The rows being filtered, already inverted and masked
+	@param cap		The capture, for run lengths
+	@param stable	One row's worth of words for each row
+ */
+void SignalConditioner::FindStable(const vector<uint64_t>& rows, const Capture& cap, vector<uint64_t>& stable) const
+{
+	int depth = cap.GetDepth();
+	int rw = m_rowwords;
+	int nbits = m_counterbits;
+	stable.resize(depth * rw);
+	
+	//Bit-sliced age of every channel's current level, in capture clocks, clamped to its limit
+	vector<uint64_t> age(nbits * rw, 0);
+	for(int i=0; i<depth; i++)
+	{
+		uint64_t d = cap.GetRunLength(i);
+		const uint64_t* row = &rows[i * rw];
+		for(int w=0; w<rw; w++)
+		{
+			uint64_t* a = &age[w];
+			const uint64_t* limit = &m_limit[w];
+			
+			//A row longer than any limit makes everything stable
+			if(d >= static_cast<uint64_t>(m_maxlimit))
+			{
+				for(int k=0; k<nbits; k++)
+					a[k*rw] = limit[k*rw];
+				stable[i*rw + w] = ~static_cast<uint64_t>(0);
+				continue;
+			}
+			
+			//Channels that changed start over, then everything ages by the run length
+			uint64_t changed = (i == 0) ? ~static_cast<uint64_t>(0) : (row[w] ^ row[w - rw]);
+			uint64_t carry = 0;
+			for(int k=0; k<nbits; k++)
+			{
+				uint64_t x = a[k*rw] & ~changed;
+				uint64_t dk = ( (d >> k) & 1 ) ? ~static_cast<uint64_t>(0) : 0;
+				a[k*rw] = x ^ dk ^ carry;
+				carry = (x & dk) | (carry & (x ^ dk));
+			}
+			
+			//Age >= limit if subtracting the limit doesn't borrow
+			uint64_t borrow = 0;
+			for(int k=0; k<nbits; k++)
+			{
+				uint64_t x = a[k*rw];
+				uint64_t n = limit[k*rw];
+				borrow = (~x & n) | (~(x ^ n) & borrow);
+			}
+			uint64_t ge = ~borrow;
+			
+			for(int k=0; k<nbits; k++)
+				a[k*rw] = (a[k*rw] & ~ge) | (limit[k*rw] & ge);
+			stable[i*rw + w] = ge;
+		}
+	}
+}
+
+/**
+	@brief Filters a capture in place
+	
+	Captures of a different width than the conditioner was compiled for are left alone.
+ */
+void SignalConditioner::Apply(Capture& cap) const
+{
+	if(m_empty || (cap.GetRowWords() != m_rowwords))
+		return;
+	
+	int depth = cap.GetDepth();
+	int rw = m_rowwords;
+	if(depth == 0)
+		return;
+	
+	vector<uint64_t> rows(depth * rw);
+	for(int i=0; i<depth; i++)
+	{
+		const uint64_t* in = cap.GetRow(i);
+		uint64_t* out = &rows[i * rw];
+		for(int w=0; w<rw; w++)
+			out[w] = (in[w] ^ m_invert[w]) & m_keep[w];
+	}
+	
+	if(m_maxlimit > 0)
+	{
+		//Work out which channels take their input at each row, and which hold their previous output.
+		//Debounced channels take it once it's stable. Deglitched channels take it for the whole of a level
+		//that was stable by its last row, which means going backwards.
+		vector<uint64_t> take;
+		FindStable(rows, cap, take);
+		for(int i=depth-1; i>=0; i--)
+		{
+			for(int w=0; w<rw; w++)
+			{
+				uint64_t deb = m_debounce[w];
+				uint64_t deg = m_deglitch[w];
+				uint64_t st = take[i*rw + w];
+				uint64_t levelend;
+				uint64_t next;
+				if(i == depth-1)
+				{
+					levelend = ~static_cast<uint64_t>(0);
+					next = ~static_cast<uint64_t>(0);
+					st |= deg;
+				}
+				else
+				{
+					levelend = rows[(i+1)*rw + w] ^ rows[i*rw + w];
+					next = take[(i+1)*rw + w];
+				}
+				take[i*rw + w] = (st & deb) | (deg & ( (st & levelend) | (next & ~levelend) )) | ~(deb | deg);
+			}
+		}
+		
+		for(int i=1; i<depth; i++)
+		{
+			uint64_t* cur = &rows[i * rw];
+			const uint64_t* prev = cur - rw;
+			const uint64_t* t = &take[i * rw];
+			for(int w=0; w<rw; w++)
+				cur[w] = (cur[w] & t[w]) | (prev[w] & ~t[w]);
+		}
+	}
+	
+	if(!cap.IsRunLengthEncoded())
+	{
+		cap.TakeRows(rows, depth);
+		return;
+	}
+	
+	//Merge rows that filtering has made the same as the one before. The trigger row is left where it
+	//starts so that captures still line up on it.
+	vector<uint32_t> runs;
+	int n = 0;
+	int trigger = cap.GetTriggerRow();
+	for(int i=0; i<depth; i++)
+	{
+		uint32_t len = cap.GetRunLength(i);
+		if(i == trigger)
+			cap.SetTriggerRow(n);
+		else if( (n > 0) && (0 == memcmp(&rows[i*rw], &rows[(n-1)*rw], rw * sizeof(uint64_t))) &&
+			(runs[n-1] + static_cast<uint64_t>(len) <= 0xffffffff) )
+		{
+			runs[n-1] += len;
+			continue;
+		}
+		if(n != i)
+			memcpy(&rows[n*rw], &rows[i*rw], rw * sizeof(uint64_t));
+		runs.push_back(len);
+		n ++;
+	}
+	cap.TakeRows(rows, n);
+	cap.SetRunLengths(&runs[0]);
+}
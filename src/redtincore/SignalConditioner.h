@@ -0,0 +1,114 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file SignalConditioner.h
+	@author Andrew D. Zonenberg
+	@brief Cleaning up noisy inputs before a capture is exported or analyzed
+ */
+
+#ifndef SignalConditioner_h
+#define SignalConditioner_h
+
+#include "Capture.h"
+#include "CaptureConfig.h"
+
+#include <string>
+#include <vector>
+
+/**
+	@brief The filters of a config compiled down to per-channel masks, applied to whole packed rows at once.
+	
+	Inversion and masking are an XOR and an AND per row word. Deglitching and debouncing both need to know
+	how long each channel has held its level. That is kept as a bit-sliced counter, with one word per counter
+	bit and one bit per channel in each word, so adding a row's run length to every channel's counter and
+	comparing each against its own limit takes a handful of word operations per counter bit.
+	
+		debounce N		A new level is only passed on once it has held for N capture clocks, so the output
+						lags the input by N-1 clocks (or to the start of the run-length encoded row it
+						settled in)
+		deglitch N		Pulses (of either level) shorter than N capture clocks are removed and the signal
+						holds its previous level instead. Nothing is delayed. The first and last levels
+						are always kept since they may have been cut short by the capture.
+		
+	Run-length encoded captures come out with rows that have become identical merged together.
+ */
+class SignalConditioner
+{
+public:
+	SignalConditioner();
+	
+	bool Compile(const CaptureConfig& config, const std::vector<Signal>& signals, int width);
+	
+	/**
+		@brief Description of what went wrong in the last call to Compile()
+	 */
+	std::string GetError() const
+	{ return m_error; }
+	
+	/**
+		@brief Checks if the conditioner would leave captures unchanged
+	 */
+	bool IsEmpty() const
+	{ return m_empty; }
+	
+	void Apply(Capture& cap) const;
+	
+	///Longest pulse width or settling time allowed, in capture clocks
+	static const int MAX_CLOCKS = 65535;
+	
+protected:
+	void FindStable(const std::vector<uint64_t>& rows, const Capture& cap, std::vector<uint64_t>& stable) const;
+
+	int m_rowwords;
+	bool m_empty;
+	
+	std::vector<uint64_t> m_invert;
+	std::vector<uint64_t> m_keep;
+	std::vector<uint64_t> m_debounce;
+	std::vector<uint64_t> m_deglitch;
+	
+	///Number of bits in each channel's counter
+	int m_counterbits;
+	
+	///Bit-sliced limit for each channel: word k*m_rowwords + w holds bit k of the limits of the channels in word w
+	std::vector<uint64_t> m_limit;
+	
+	///Largest limit of any channel
+	int m_maxlimit;
+	
+	std::string m_error;
+};
+
+#endif
@@ -0,0 +1,234 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file SigrokExporter.cpp
+	@author Andrew D. Zonenberg
+	@brief sigrok session (.sr) export
+ */
+
+#include "SigrokExporter.h"
+#include "ByteOrder.h"
+#include "Checksum.h"
+
+#include <algorithm>
+
+using namespace std;
+
+string SigrokExporter::GetFormatName()
+{
+	return "sr";
+}
+
+string SigrokExporter::GetFileExtension()
+{
+	return ".sr";
+}
+
+/**
+	@brief Writes a sigrok session file.
+	
+	A session is a zip archive containing a version file, an INI style metadata file and the raw logic
+	data. The logic data is every channel of the capture at width/8 bytes per sample (unit size 16 for
+	a 128 channel core), channel 0 in the LSB of the first byte. Entries are stored uncompressed so we
+	don't need zlib.
+ */
+bool SigrokExporter::Export(const Capture& cap, FILE* fp)
+{
+	const vector<Signal>& signals = cap.GetSignals();
+	int rowbytes = cap.GetWidth() / 8;
+	
+	//Name every probe, using the signal bit names where we have them
+	vector<string> probenames(cap.GetWidth());
+	for(int i=0; i<cap.GetWidth(); i++)
+	{
+		char str[32];
+		snprintf(str, sizeof(str), "din[%d]", i);
+		probenames[i] = str;
+	}
+	for(size_t j=0; j<signals.size(); j++)
+	{
+		const Signal& sig = signals[j];
+		for(int k=0; k<sig.width; k++)
+		{
+			int nbit = sig.lowbit + k;
+			if( (nbit < 0) || (nbit >= cap.GetWidth()) )
+				continue;
+			if(sig.width == 1)
+				probenames[nbit] = sig.name;
+			else
+			{
+				char str[32];
+				snprintf(str, sizeof(str), "[%d]", k);
+				probenames[nbit] = sig.name + str;
+			}
+		}
+	}
+	
+	//Format the metadata
+	string metadata = "[global]\nsigrok version=0.2.0\n\n[device 1]\ncapturefile=logic-1\n";
+	char line[256];
+	snprintf(line, sizeof(line), "total probes=%d\nsamplerate=%.0f\ntotal analog=0\n",
+		cap.GetWidth(), cap.GetSampleRate() * 1000000.0);
+	metadata += line;
+	for(int i=0; i<cap.GetWidth(); i++)
+	{
+		snprintf(line, sizeof(line), "probe%d=", i+1);
+		metadata += line;
+		metadata += probenames[i];
+		metadata += "\n";
+	}
+	snprintf(line, sizeof(line), "unitsize=%d\n", rowbytes);
+	metadata += line;
+	
+	//Pack the samples. Sessions can only hold evenly spaced samples, so run-length encoded captures are
+	//expanded (as far as will fit in a zip file without the 64-bit extensions).
+	string logic;
+	if(cap.IsRunLengthEncoded())
+	{
+		uint64_t maxdepth = 0xffffffffULL / rowbytes;
+		if(cap.GetDuration() > maxdepth)
+			printf("Capture too long for a sigrok session, only the first %llu samples will be exported\n",
+				static_cast<unsigned long long>(maxdepth));
+		
+		logic.reserve(rowbytes * std::min(cap.GetDuration(), maxdepth));
+		vector<unsigned char> row(rowbytes);
+		for(int i=0; (i<cap.GetDepth()) && (logic.size() / rowbytes < maxdepth); i++)
+		{
+			cap.GetRowBytes(i, &row[0]);
+			for(uint32_t j=0; (j < cap.GetRunLength(i)) && (logic.size() / rowbytes < maxdepth); j++)
+				logic.append(reinterpret_cast<const char*>(&row[0]), rowbytes);
+		}
+	}
+	else
+	{
+		logic.assign(rowbytes * cap.GetDepth(), '\0');
+		for(int i=0; i<cap.GetDepth(); i++)
+			cap.GetRowBytes(i, reinterpret_cast<unsigned char*>(&logic[i * rowbytes]));
+	}
+	
+	vector<ZipEntry> entries;
+	if(!WriteZipEntry(fp, entries, "version", "2"))
+		return false;
+	if(!WriteZipEntry(fp, entries, "metadata", metadata))
+		return false;
+	if(!WriteZipEntry(fp, entries, "logic-1-1", logic))
+		return false;
+	return WriteZipDirectory(fp, entries);
+}
+
+/**
+	@brief Writes one uncompressed file into a zip archive
+ */
+bool SigrokExporter::WriteZipEntry(FILE* fp, std::vector<ZipEntry>& entries, std::string name, const std::string& data)
+{
+	ZipEntry entry;
+	entry.name = name;
+	entry.crc = CRC32(data.c_str(), data.length());
+	entry.size = data.length();
+	entry.offset = 0;
+	if(!entries.empty())
+	{
+		const ZipEntry& last = entries[entries.size() - 1];
+		entry.offset = last.offset + 30 + last.name.length() + last.size;
+	}
+	
+	string header;
+	AppendLE32(header, 0x04034b50);		//local file header signature
+	AppendLE16(header, 10);				//version needed to extract
+	AppendLE16(header, 0);				//flags
+	AppendLE16(header, 0);				//compression method: stored
+	AppendLE16(header, 0);				//modification time
+	AppendLE16(header, 0x21);			//modification date (1980-01-01)
+	AppendLE32(header, entry.crc);
+	AppendLE32(header, entry.size);		//compressed size
+	AppendLE32(header, entry.size);		//uncompressed size
+	AppendLE16(header, name.length());
+	AppendLE16(header, 0);				//extra field length
+	header += name;
+	
+	if(header.length() != fwrite(header.c_str(), 1, header.length(), fp))
+		return false;
+	if(data.length() != fwrite(data.c_str(), 1, data.length(), fp))
+		return false;
+	
+	entries.push_back(entry);
+	return true;
+}
+
+/**
+	@brief Writes the central directory of a zip archive after all of the entries
+ */
+bool SigrokExporter::WriteZipDirectory(FILE* fp, const std::vector<ZipEntry>& entries)
+{
+	string dir;
+	uint32_t diroffset = 0;
+	for(size_t i=0; i<entries.size(); i++)
+	{
+		const ZipEntry& entry = entries[i];
+		AppendLE32(dir, 0x02014b50);	//central directory header signature
+		AppendLE16(dir, 10);			//version made by
+		AppendLE16(dir, 10);			//version needed to extract
+		AppendLE16(dir, 0);				//flags
+		AppendLE16(dir, 0);				//compression method: stored
+		AppendLE16(dir, 0);				//modification time
+		AppendLE16(dir, 0x21);			//modification date
+		AppendLE32(dir, entry.crc);
+		AppendLE32(dir, entry.size);
+		AppendLE32(dir, entry.size);
+		AppendLE16(dir, entry.name.length());
+		AppendLE16(dir, 0);				//extra field length
+		AppendLE16(dir, 0);				//comment length
+		AppendLE16(dir, 0);				//disk number
+		AppendLE16(dir, 0);				//internal attributes
+		AppendLE32(dir, 0);				//external attributes
+		AppendLE32(dir, entry.offset);
+		dir += entry.name;
+		
+		diroffset = entry.offset + 30 + entry.name.length() + entry.size;
+	}
+	
+	//End of central directory record
+	uint32_t dirsize = dir.length();
+	AppendLE32(dir, 0x06054b50);
+	AppendLE16(dir, 0);					//this disk
+	AppendLE16(dir, 0);					//disk with the directory
+	AppendLE16(dir, entries.size());
+	AppendLE16(dir, entries.size());
+	AppendLE32(dir, dirsize);
+	AppendLE32(dir, diroffset);
+	AppendLE16(dir, 0);					//comment length
+	
+	return (dir.length() == fwrite(dir.c_str(), 1, dir.length(), fp));
+}
@@ -0,0 +1,134 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Transport.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of Transport
+ */
+
+#include "Transport.h"
+
+#include <stdio.h>
+#include <time.h>
+
+static long GetMonotonicMs()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000L + t.tv_nsec / 1000000L;
+}
+
+Transport::~Transport()
+{
+}
+
+/**
+	@brief Reads exactly count bytes
+	
+	@param buf			Output buffer
+	@param count		Number of bytes to read
+	@param timeout_ms	Time limit for the whole read, or -1 for none
+	
+	@return count on success, -1 on failure or timeout
+ */
+int Transport::ReadLooped(unsigned char* buf, int count, int timeout_ms)
+{
+	long deadline = GetMonotonicMs() + timeout_ms;
+	unsigned char* p = buf;
+	int bytes_left = count;
+	while(bytes_left > 0)
+	{
+		if(timeout_ms >= 0)
+		{
+			long left = deadline - GetMonotonicMs();
+			if( (left < 0) || !WaitReadable(left) )
+			{
+				printf("fail to read: timed out with %d of %d bytes left\n", bytes_left, count);
+				return -1;
+			}
+		}
+		
+		int x = Read(p, bytes_left);
+		if(x <= 0)
+		{
+			if(x == 0)
+				printf("fail to read: end of file\n");
+			else
+				perror("fail to read");
+			return -1;
+		}
+		bytes_left -= x;
+		p += x;
+	}
+	
+	return count;
+}
+
+/**
+	@brief Writes exactly count bytes
+	
+	@return count on success, -1 on failure
+ */
+int Transport::WriteLooped(const unsigned char* buf, int count)
+{
+	const unsigned char* p = buf;
+	int bytes_left = count;
+	while(bytes_left > 0)
+	{
+		int x = Write(p, bytes_left);
+		if(x <= 0)
+		{
+			perror("fail to write");
+			return -1;
+		}
+		bytes_left -= x;
+		p += x;
+	}
+	
+	return count;
+}
+
+/**
+	@brief Reads and throws away data until nothing has arrived for a while
+ */
+void Transport::Drain(int quiet_ms)
+{
+	unsigned char buf[256];
+	while(WaitReadable(quiet_ms))
+	{
+		if(Read(buf, sizeof(buf)) <= 0)
+			break;
+	}
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file Transport.h
+	@author Andrew D. Zonenberg
+	@brief Byte stream connection to the logic analyzer
+ */
+
+#ifndef Transport_h
+#define Transport_h
+
+/**
+	@brief A byte stream to and from the board, e.g. a UART.
+	
+	Read() and Write() behave like read(2) and write(2) and may transfer fewer bytes than asked for.
+ */
+class Transport
+{
+public:
+	virtual ~Transport();
+	
+	virtual int Read(unsigned char* buf, int count) =0;
+	virtual int Write(const unsigned char* buf, int count) =0;
+	
+	/**
+		@brief Waits until Read() won't block
+		
+		@param timeout_ms	How long to wait, or -1 for forever
+		
+		@return false if nothing arrived in time
+	 */
+	virtual bool WaitReadable(int timeout_ms) =0;
+	
+	///Discards anything received but not read yet
+	virtual void FlushInput() =0;
+	
+	int ReadLooped(unsigned char* buf, int count, int timeout_ms = -1);
+	int WriteLooped(const unsigned char* buf, int count);
+	void Drain(int quiet_ms);
+};
+
+#endif
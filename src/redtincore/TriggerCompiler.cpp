@@ -0,0 +1,223 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file TriggerCompiler.cpp
+	@author Andrew D. Zonenberg
+	@brief Generation of the trigger configuration bitstream
+ */
+
+#include "TriggerCompiler.h"
+
+#include <map>
+#include <stdio.h>
+
+using namespace std;
+
+static void CompileCore(const int* state_vector, unsigned char* bitstream);
+static int bit_test_pair(int state_0, int state_1, int current_1, int old_1, int current_0, int old_0);
+static int bit_test(int state, int current, int old);
+
+/**
+	@brief Packs the signals into the capture channels, the first signal in the highest channels
+	
+	@return false if the signals don't fit
+ */
+bool AssignSignalBits(vector<Signal>& signals, int width)
+{
+	int bitpos = width - 1;
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		Signal& sig = signals[i];
+		sig.highbit = bitpos;
+		sig.lowbit = bitpos - sig.width + 1;
+		bitpos -= sig.width;
+		
+		if((bitpos+1) < 0)
+		{
+			printf("Too many signals specified!\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+	@brief Generates the trigger configuration bitstreams
+	
+	Bit positions must already have been assigned to the signals by AssignSignalBits(). Signals may span
+	cores; the cores are cross-triggered so the conditions are ANDed across all of them.
+	
+	@param signals		The signals being captured
+	@param triggers		Trigger conditions, all of which must be met at once
+	@param width		Total width of all cores, a multiple of CORE_WIDTH
+	@param bitstream	TRIGGER_BITSTREAM_SIZE bytes of output per core, core 0 first
+	
+	@return false if a trigger condition is invalid
+ */
+bool CompileTriggers(const vector<Signal>& signals, const vector<Trigger>& triggers, int width, unsigned char* bitstream)
+{
+	vector<int> state_vector(width, Trigger::TRIGGER_TYPE_DONTCARE);
+	
+	std::map<string, const Signal*> signalmap;
+	for(size_t i=0; i<signals.size(); i++)
+		signalmap[signals[i].name] = &signals[i];
+	
+	//Set up the trigger array
+	for(size_t i=0; i<triggers.size(); i++)
+	{
+		const Trigger& trig = triggers[i];
+		if(signalmap.find(trig.signalname) == signalmap.end())
+		{
+			printf("Trigger on unknown signal \"%s\"\n", trig.signalname.c_str());
+			return false;
+		}
+		const Signal& sig = *signalmap[trig.signalname];
+		
+		if( (trig.triggertype < 0) || (trig.triggertype > 5) )
+		{
+			printf("Invalid trigger type\n");
+			return false;
+		}
+		if( (trig.nbit < 0) || (trig.nbit >= sig.width) || (sig.lowbit + trig.nbit >= width) )
+		{
+			printf("Trigger on nonexistent bit %s[%d]\n", sig.name.c_str(), trig.nbit);
+			return false;
+		}
+		
+		//Get the bit number for the signal
+		int nbit = sig.lowbit + trig.nbit;
+		state_vector[nbit] = trig.triggertype;
+	}
+	
+	for(int core=0; core < width/CORE_WIDTH; core++)
+		CompileCore(&state_vector[core * CORE_WIDTH], bitstream + core*TRIGGER_BITSTREAM_SIZE);
+	
+	return true;
+}
+
+/**
+	@brief Generates the bitstream for one core from the conditions on each of its channels
+ */
+static void CompileCore(const int* state_vector, unsigned char* bitstream)
+{
+	//Build the full bitmask set
+	int truth_tables[CORE_WIDTH / 2] = {0};
+	for(int i=0; i<CORE_WIDTH / 2; i++)
+		truth_tables[i] = MakeTruthTable(state_vector[2*i], state_vector[2*i + 1]);
+	
+	/*
+		128 channels packed into 64 LUTs (two bits for each).
+		Configuration is done in eight columns of 8 LUTs (16 channels) each.
+		
+		Channels [0,1]....[14,15] are loaded at once, with one bit of data per clock.
+		[16,17]...[30,31] are in the next row, etc.
+		
+		Only the low 16 bits of each LUT are meaningful; 16 "don't care" bytes must be clocked
+		into the high half.
+		
+		In total the configuration bitstream is 256 bytes (256 bits per column).
+		
+		The first configuration word is bit masks 56...63.
+	*/
+	
+	//Generate the configuration bitstream for the proper column format
+	for(int i=0; i<TRIGGER_BITSTREAM_SIZE; i++)
+	{
+		int flipped_bitnum = 255 - i;				//index from the start of the shift register
+		int bitnum = flipped_bitnum & 0x1F;			//Index of the current bit in this LUT
+		int lutnum = flipped_bitnum >> 5;			//Index of the current LUT
+			
+		//Find the appropriate truth tables and pull bits out	
+		unsigned char cword = 0;
+		for(int col=0; col<8; col++)
+		{
+			int masknum = 8*lutnum + col;
+			int bitval = (truth_tables[masknum] >> bitnum) & 0x1;
+			cword |= (bitval << col);
+		}
+		
+		bitstream[i] = cword;
+	}
+}
+
+static int bit_test_pair(int state_0, int state_1, int current_1, int old_1, int current_0, int old_0)
+{
+	return bit_test(state_0, current_0, old_0) && bit_test(state_1, current_1, old_1);
+}
+
+static int bit_test(int state, int current, int old)
+{
+	switch(state)
+	{
+		case Trigger::TRIGGER_TYPE_LOW:
+			return (!current);
+		case Trigger::TRIGGER_TYPE_HIGH:
+			return (current);
+		case Trigger::TRIGGER_TYPE_RISING:
+			return (current && !old);
+		case Trigger::TRIGGER_TYPE_FALLING:
+			return (!current && old);
+		case Trigger::TRIGGER_TYPE_CHANGE:
+			return (current != old);
+		case Trigger::TRIGGER_TYPE_DONTCARE:
+			return 1;
+	}
+	
+	return 0;
+}
+
+/**
+	@brief Computes the SRL truth table for one pair of channels
+ */
+int MakeTruthTable(int state_0, int state_1)
+{
+	int table = 0;
+	for(int current_0 = 0; current_0 <= 1; current_0 ++)
+	{
+		for(int current_1 = 0; current_1 <= 1; current_1 ++)
+		{
+			for(int old_0 = 0; old_0 <= 1; old_0 ++)
+			{
+				for(int old_1 = 0; old_1 <= 1; old_1 ++)
+				{
+					int bitnum = (old_1 << 3) | (current_1 << 2) | (old_0 << 1) | (current_0);
+					int bitval = bit_test_pair(state_0, state_1, current_1, old_1, current_0, old_0);
+					table |= (bitval << bitnum);
+				}
+			}					
+		}
+	}
+	return table;
+}
@@ -0,0 +1,164 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file UARTTransport.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of UARTTransport
+ */
+
+#include "UARTTransport.h"
+
+#include <fcntl.h>
+#include <memory.h>
+#include <poll.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace std;
+
+UARTTransport::UARTTransport()
+: m_fd(-1)
+{
+}
+
+UARTTransport::~UARTTransport()
+{
+	Close();
+}
+
+static speed_t GetBaudConstant(int baud)
+{
+	switch(baud)
+	{
+		case 9600:		return B9600;
+		case 19200:		return B19200;
+		case 38400:		return B38400;
+		case 57600:		return B57600;
+		case 115200:	return B115200;
+		case 230400:	return B230400;
+		case 460800:	return B460800;
+		case 500000:	return B500000;
+		case 921600:	return B921600;
+		case 1000000:	return B1000000;
+		case 1500000:	return B1500000;
+		case 2000000:	return B2000000;
+		case 3000000:	return B3000000;
+		case 4000000:	return B4000000;
+		default:		return B0;
+	}
+}
+
+/**
+	@brief Opens the serial port and sets it up for talking to the UART wrapper (8N1)
+	
+	The baud rate must match UART_CLKDIV in the wrapper.
+ */
+bool UARTTransport::Open(string path, int baud)
+{
+	Close();
+	
+	speed_t speed = GetBaudConstant(baud);
+	if(speed == B0)
+	{
+		printf("unsupported baud rate %d\n", baud);
+		return false;
+	}
+	
+	m_fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if(m_fd < 0)
+	{
+		perror("couldn't open uart");
+		return false;
+	}
+	
+	//Set flags
+	termios flags;
+	memset(&flags, 0, sizeof(flags));
+	tcgetattr(m_fd, &flags);
+	flags.c_cflag = CS8 | CLOCAL | CREAD;
+	flags.c_iflag = 0;
+	flags.c_oflag = 0;
+	flags.c_lflag = 0;
+	flags.c_cc[VMIN] = 1;
+	flags.c_cc[VTIME] = 0;
+	cfsetispeed(&flags, speed);
+	cfsetospeed(&flags, speed);
+	if(0 != tcflush(m_fd, TCIFLUSH))
+	{
+		perror("fail to flush tty");
+		Close();
+		return false;
+	}
+	if(0 != tcsetattr(m_fd, TCSANOW, &flags))
+	{
+		perror("fail to set attr");
+		Close();
+		return false;
+	}
+	
+	return true;
+}
+
+void UARTTransport::Close()
+{
+	if(m_fd >= 0)
+		close(m_fd);
+	m_fd = -1;
+}
+
+int UARTTransport::Read(unsigned char* buf, int count)
+{
+	return read(m_fd, buf, count);
+}
+
+int UARTTransport::Write(const unsigned char* buf, int count)
+{
+	return write(m_fd, buf, count);
+}
+
+bool UARTTransport::WaitReadable(int timeout_ms)
+{
+	pollfd pfd;
+	pfd.fd = m_fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return (poll(&pfd, 1, timeout_ms) > 0);
+}
+
+void UARTTransport::FlushInput()
+{
+	tcflush(m_fd, TCIFLUSH);
+}
@@ -0,0 +1,144 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file VCDExporter.cpp
+	@author Andrew D. Zonenberg
+	@brief Value change dump (VCD) export
+ */
+
+#include "VCDExporter.h"
+
+using namespace std;
+
+string VCDExporter::GetFormatName()
+{
+	return "vcd";
+}
+
+string VCDExporter::GetFileExtension()
+{
+	return ".vcd";
+}
+
+/**
+	@brief Makes a short VCD identifier code out of the printable ASCII characters
+ */
+string VCDExporter::MakeIdentifier(int n)
+{
+	string ret;
+	do
+	{
+		ret += static_cast<char>('!' + (n % 94));
+		n /= 94;
+	} while(n != 0);
+	return ret;
+}
+
+bool VCDExporter::Export(const Capture& cap, FILE* fp)
+{
+	const vector<Signal>& signals = cap.GetSignals();
+	
+	//Get the capture time
+	time_t now = cap.GetTimestamp();
+	struct tm now_split;
+	localtime_r(&now, &now_split);
+	
+	//Get sampling frequency
+	float frequency = cap.GetSampleRate();		//in MHz
+	float period = 1000000 / frequency;			//in picoseconds
+	
+	//Format the VCD header
+	fprintf(fp, "$timescale %.0fps $end\n", period/2);	//period of 1/2 clock cycle
+														//so we can show falling edges
+	fprintf(fp, "$date %4d-%02d-%02d %02d:%02d:%02d $end\n",
+		now_split.tm_year+1900, now_split.tm_mon+1, now_split.tm_mday,
+		now_split.tm_hour, now_split.tm_min, now_split.tm_sec);
+	fprintf(fp, "$version RED TIN v0.1 $end\n");
+	
+	//The special signal "capture_clk" is the clock of our sampling module and gets the first identifier
+	vector<string> ids;
+	for(size_t i=0; i<signals.size(); i++)
+		ids.push_back(MakeIdentifier(i + 1));
+	string clkid = MakeIdentifier(0);
+	fprintf(fp, "$var reg 1 %s capture_clk $end\n", clkid.c_str());
+	for(size_t i=0; i<signals.size(); i++)
+		fprintf(fp, "$var wire %d %s %s $end\n", signals[i].width, ids[i].c_str(), signals[i].name.c_str());
+	fprintf(fp, "$enddefinitions $end\n");
+	
+	//Write the data to the VCD. With run-length encoding there's only a clock pulse for each stored
+	//sample, at the time it was taken.
+	for(int i=0; i<cap.GetDepth(); i++)
+	{
+		unsigned long long t = cap.GetSampleTime(i);
+		
+		//Clock goes high
+		fprintf(fp,
+				"#%llu\n"
+				"1%s\n",
+				t*2,
+				clkid.c_str()
+			);
+			
+		//Everything changes on the rising edge, but only write the signals that actually changed
+		for(size_t j=0; j<signals.size(); j++)
+		{
+			if(!cap.ColumnValueChanged(j, i))
+				continue;
+			
+			string value = cap.FormatBinary(j, i);
+			
+			//1-bit signal
+			if(signals[j].width == 1)
+				fprintf(fp, "%s%s\n", value.c_str(), ids[j].c_str());
+			
+			//Multi-bit signal
+			else
+				fprintf(fp, "b%s %s\n", value.c_str(), ids[j].c_str());
+		}
+		
+		//then clock goes low
+		fprintf(fp,
+				"#%llu\n"
+				"0%s\n",
+				t*2 + 1,
+				clkid.c_str()
+			);
+	}
+	
+	//Mark where the capture ends, since the last sample may have lasted more than one clock
+	fprintf(fp, "#%llu\n", static_cast<unsigned long long>(cap.GetDuration()) * 2);
+	
+	return (0 == ferror(fp));
+}
@@ -0,0 +1,685 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file VCDImporter.cpp
+	@author Andrew D. Zonenberg
+	@brief Value change dump (VCD) import
+ */
+
+#include "VCDImporter.h"
+#include "CaptureConfig.h"
+#include "TriggerCompiler.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static inline bool IsSpace(char c)
+{
+	return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+/**
+	@brief Reads the next whitespace-separated word of the header
+	
+	@return false at the end of the file
+ */
+static bool NextWord(const char*& p, const char* end, string& word)
+{
+	while( (p < end) && IsSpace(*p) )
+		p++;
+	const char* start = p;
+	while( (p < end) && !IsSpace(*p) )
+		p++;
+	word.assign(start, p);
+	return (p != start);
+}
+
+/**
+	@brief Reads the words of a header section up to its $end
+ */
+static void ReadSection(const char*& p, const char* end, vector<string>& words)
+{
+	words.clear();
+	string word;
+	while(NextWord(p, end, word) && (word != "$end"))
+		words.push_back(word);
+}
+
+static uint64_t GCD(uint64_t a, uint64_t b)
+{
+	while(b != 0)
+	{
+		uint64_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/**
+	@brief Writes the low bits of a value into a packed row
+ */
+static inline void InsertBits(uint64_t* row, int lowbit, int width, uint64_t value)
+{
+	uint64_t mask = (width == 64) ? ~static_cast<uint64_t>(0) : ( (static_cast<uint64_t>(1) << width) - 1 );
+	int nword = lowbit >> 6;
+	int shift = lowbit & 63;
+	row[nword] = (row[nword] & ~(mask << shift)) | (value << shift);
+	if( (shift != 0) && (shift + width > 64) )
+		row[nword + 1] = (row[nword + 1] & ~(mask >> (64 - shift))) | (value >> (64 - shift));
+}
+
+VCDImporter::VCDImporter()
+	: m_timescale(1e-9)
+	, m_timestamp(0)
+	, m_ourexport(false)
+	, m_width(0)
+	, m_rowwords(0)
+{
+}
+
+static void* ParseThreadProc(void* p)
+{
+	VCDChunk* chunk = reinterpret_cast<VCDChunk*>(p);
+	chunk->importer->ParseChunk(*chunk);
+	return NULL;
+}
+
+/**
+	@brief Parses every chunk, each in its own thread
+ */
+static void ParseChunks(vector<VCDChunk>& chunks)
+{
+	//Not worth spinning up a thread for a single chunk
+	if(chunks.size() == 1)
+	{
+		ParseThreadProc(&chunks[0]);
+		return;
+	}
+	
+	vector<pthread_t> threads(chunks.size());
+	vector<bool> started(chunks.size(), false);
+	for(size_t i=0; i<chunks.size(); i++)
+	{
+		if(0 == pthread_create(&threads[i], NULL, ParseThreadProc, &chunks[i]))
+			started[i] = true;
+		
+		//Couldn't get a thread, do it ourselves
+		else
+			ParseThreadProc(&chunks[i]);
+	}
+	for(size_t i=0; i<chunks.size(); i++)
+	{
+		if(started[i])
+			pthread_join(threads[i], NULL);
+	}
+}
+
+/**
+	@brief Reads a VCD file into a capture
+	
+	@return true on success
+ */
+bool VCDImporter::Import(string fname, Capture& cap)
+{
+	int fd = open(fname.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		perror("couldn't open VCD file");
+		return false;
+	}
+	struct stat st;
+	if( (0 != fstat(fd, &st)) || (st.st_size == 0) )
+	{
+		printf("VCD file %s is empty\n", fname.c_str());
+		close(fd);
+		return false;
+	}
+	size_t size = st.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+	{
+		perror("couldn't map VCD file");
+		return false;
+	}
+	madvise(map, size, MADV_WILLNEED);
+	
+	const char* p = reinterpret_cast<const char*>(map);
+	const char* end = p + size;
+	bool ok = ParseHeader(p, end, st.st_mtime);
+	
+	//Split the value changes into a chunk per CPU, each starting on a timestamp line. Small files aren't
+	//worth splitting.
+	vector<VCDChunk> chunks;
+	if(ok)
+	{
+		const size_t min_chunk = 1024 * 1024;
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		size_t nchunks = (ncpus < 1) ? 1 : ncpus;
+		if(nchunks > (end - p) / min_chunk)
+			nchunks = (end - p) / min_chunk;
+		if(nchunks < 1)
+			nchunks = 1;
+		
+		const char* start = p;
+		for(size_t i=1; i<=nchunks; i++)
+		{
+			const char* split = end;
+			if(i < nchunks)
+			{
+				split = p + (end - p) * i / nchunks;
+				if(split < start)
+					split = start;
+				while(split < end)
+				{
+					const char* nl = reinterpret_cast<const char*>(memchr(split, '\n', end - split));
+					if(nl == NULL)
+						split = end;
+					else
+					{
+						split = nl + 1;
+						if( (split < end) && (*split == '#') )
+							break;
+					}
+				}
+			}
+			if(split == start)
+				continue;
+			
+			VCDChunk chunk;
+			chunk.importer = this;
+			chunk.start = start;
+			chunk.end = split;
+			chunk.state.resize(m_rowwords, 0);
+			chunk.lastvalue.resize(m_signals.size(), NULL);
+			chunk.lastlen.resize(m_signals.size(), 0);
+			chunk.nrows = 0;
+			chunk.rows = NULL;
+			chunk.times = NULL;
+			chunk.lasttime = 0;
+			chunk.hastime = false;
+			chunks.push_back(chunk);
+			start = split;
+		}
+	}
+	
+	//First pass: count rows and find the last value of each signal in each chunk
+	vector<uint64_t> rows;
+	vector<uint64_t> times;
+	uint64_t depth = 0;
+	if(ok)
+	{
+		ParseChunks(chunks);
+		for(size_t i=0; i<chunks.size(); i++)
+			depth += chunks[i].nrows;
+		if(depth == 0)
+		{
+			printf("VCD file %s has no value changes\n", fname.c_str());
+			ok = false;
+		}
+		else if(depth > INT_MAX)
+		{
+			printf("VCD file %s has too many timestamps\n", fname.c_str());
+			ok = false;
+		}
+	}
+	
+	//Each chunk starts with whatever the chunks before it left behind, then it's parsed again to fill in
+	//its rows
+	if(ok)
+	{
+		rows.resize(depth * m_rowwords);
+		times.resize(depth + 1);
+		vector<uint64_t> state(m_rowwords, 0);
+		uint64_t row = 0;
+		for(size_t i=0; i<chunks.size(); i++)
+		{
+			VCDChunk& chunk = chunks[i];
+			chunk.state = state;
+			chunk.rows = &rows[row * m_rowwords];
+			chunk.times = &times[row];
+			row += chunk.nrows;
+			
+			for(size_t j=0; j<m_signals.size(); j++)
+			{
+				if(chunk.lastvalue[j] != NULL)
+					SetValue(&state[0], j, chunk.lastvalue[j], chunk.lastlen[j]);
+			}
+		}
+		ParseChunks(chunks);
+	}
+	munmap(map, size);
+	if(!ok)
+		return false;
+	
+	//Rows last until the next one. The last goes on until the final timestamp in the file, if that's after it,
+	//as with our own exports where capture_clk falls half a clock after the last sample.
+	//Our exports are in half clocks. Anything else is in whatever step every row is a multiple of.
+	uint64_t unit = 0;
+	if(m_ourexport)
+		unit = 2;
+	else
+	{
+		for(uint64_t i=0; i+1<depth; i++)
+			unit = GCD(unit, times[i+1] - times[i]);
+	}
+	if(unit == 0)
+		unit = 1;
+	uint64_t last = times[depth - 1];
+	times[depth] = last + unit;
+	for(size_t i=0; i<chunks.size(); i++)
+	{
+		if(chunks[i].hastime && (chunks[i].lasttime > last))
+			times[depth] = last + (chunks[i].lasttime - last + unit - 1) / unit * unit;
+	}
+	
+	vector<uint32_t> runs(depth);
+	bool uniform = true;
+	bool clipped = false;
+	for(uint64_t i=0; i<depth; i++)
+	{
+		uint64_t run = (times[i+1] - times[i]) / unit;
+		if(run > 0xffffffff)
+		{
+			run = 0xffffffff;
+			clipped = true;
+		}
+		runs[i] = run;
+		if(run != 1)
+			uniform = false;
+	}
+	if(clipped)
+		printf("warning: gaps of more than 2^32 time steps in %s were shortened\n", fname.c_str());
+	times.clear();
+	
+	cap = Capture(m_width, 0);
+	cap.SetSignals(m_signals);
+	cap.TakeRows(rows, depth);
+	if(!uniform)
+		cap.SetRunLengths(&runs[0]);
+	cap.SetSampleRate(1e-6 / (m_timescale * unit));
+	cap.SetTimestamp(m_timestamp);
+	cap.SetConfigHash(CaptureConfig::HashConfig(m_signals, vector<Trigger>()));
+	return true;
+}
+
+/**
+	@brief Reads the declarations, leaving p at the start of the value changes
+ */
+bool VCDImporter::ParseHeader(const char*& p, const char* end, time_t mtime)
+{
+	m_signals.clear();
+	m_shortids.assign(ID_RADIX * ID_RADIX * ID_RADIX, -1);
+	m_longids.clear();
+	m_timescale = 1e-9;
+	m_timestamp = mtime;
+	m_ourexport = false;
+	
+	vector<string> scopes;
+	vector<string> words;
+	string word;
+	while(NextWord(p, end, word))
+	{
+		if(word == "$enddefinitions")
+		{
+			ReadSection(p, end, words);
+			
+			int width = 0;
+			for(size_t i=0; i<m_signals.size(); i++)
+				width += m_signals[i].width;
+			if(width == 0)
+			{
+				printf("VCD file has no signals\n");
+				return false;
+			}
+			
+			//Same layout as a live capture on a board with enough cores
+			m_width = (width + CORE_WIDTH - 1) / CORE_WIDTH * CORE_WIDTH;
+			m_rowwords = m_width / 64;
+			return AssignSignalBits(m_signals, m_width);
+		}
+		
+		ReadSection(p, end, words);
+		if(word == "$timescale")
+		{
+			//Number and unit may or may not be separated
+			string text;
+			for(size_t i=0; i<words.size(); i++)
+				text += words[i];
+			char* unit;
+			double scale = strtod(text.c_str(), &unit);
+			if(scale <= 0)
+				scale = 1;
+			string units = unit;
+			if(units == "s")
+				m_timescale = scale;
+			else if(units == "ms")
+				m_timescale = scale * 1e-3;
+			else if(units == "us")
+				m_timescale = scale * 1e-6;
+			else if(units == "ns")
+				m_timescale = scale * 1e-9;
+			else if(units == "ps")
+				m_timescale = scale * 1e-12;
+			else if(units == "fs")
+				m_timescale = scale * 1e-15;
+			else
+				printf("warning: unrecognized VCD timescale \"%s\", assuming ns\n", text.c_str());
+		}
+		else if(word == "$date")
+		{
+			//Only our own format is understood, anything else keeps the file modification time
+			struct tm split;
+			memset(&split, 0, sizeof(split));
+			if( (words.size() == 2) &&
+				(3 == sscanf(words[0].c_str(), "%d-%d-%d", &split.tm_year, &split.tm_mon, &split.tm_mday)) &&
+				(3 == sscanf(words[1].c_str(), "%d:%d:%d", &split.tm_hour, &split.tm_min, &split.tm_sec)) )
+			{
+				split.tm_year -= 1900;
+				split.tm_mon -= 1;
+				split.tm_isdst = -1;
+				m_timestamp = mktime(&split);
+			}
+		}
+		else if(word == "$version")
+		{
+			if( (words.size() >= 2) && (words[0] == "RED") && (words[1] == "TIN") )
+				m_ourexport = true;
+		}
+		else if(word == "$scope")
+		{
+			if(words.size() >= 2)
+				scopes.push_back(words[1]);
+		}
+		else if(word == "$upscope")
+		{
+			if(!scopes.empty())
+				scopes.pop_back();
+		}
+		else if(word == "$var")
+			AddVariable(words, scopes);
+		
+		//Anything else ($comment etc) is skipped
+	}
+	
+	printf("VCD file has no $enddefinitions\n");
+	return false;
+}
+
+/**
+	@brief Adds a signal for a $var declaration: type, width, identifier, name and maybe a bit range
+ */
+void VCDImporter::AddVariable(const vector<string>& words, const vector<string>& scopes)
+{
+	if(words.size() < 4)
+		return;
+	
+	//Later declarations with the same identifier are aliases of the first
+	const string& id = words[2];
+	if( (m_longids.find(id) != m_longids.end()) ||
+		( (id.length() <= SHORT_ID_LEN) && (LookupIdentifier(id.c_str(), id.length()) >= 0) ) )
+	{
+		return;
+	}
+	
+	//Real numbers and our own sampling clock aren't signals
+	int nsignal = -1;
+	if( (words[0] != "real") && (words[0] != "realtime") && !(m_ourexport && (words[3] == "capture_clk")) )
+	{
+		string name;
+		for(size_t i=0; i<scopes.size(); i++)
+			name += scopes[i] + ".";
+		name += words[3];
+		
+		int width = atoi(words[1].c_str());
+		if(width < 1)
+			width = 1;
+		
+		nsignal = m_signals.size();
+		m_signals.push_back(Signal(width, name));
+	}
+	
+	//Codes are only worked out for short identifiers, since longer ones would overflow
+	bool isshort = (id.length() <= SHORT_ID_LEN);
+	int code = 0;
+	for(size_t i=0; isshort && (i<id.length()); i++)
+	{
+		if( (id[i] < '!') || (id[i] > '~') )
+			isshort = false;
+		code = code*ID_RADIX + (id[i] - '!' + 1);
+	}
+	if(isshort)
+		m_shortids[code] = nsignal;
+	else
+		m_longids[id] = nsignal;
+}
+
+/**
+	@brief Finds the signal for an identifier code
+	
+	@return The signal number, or -1 if the variable isn't imported
+ */
+int VCDImporter::LookupIdentifier(const char* id, size_t len) const
+{
+	if(len <= SHORT_ID_LEN)
+	{
+		int code = 0;
+		size_t i = 0;
+		for(; i<len; i++)
+		{
+			if( (id[i] < '!') || (id[i] > '~') )
+				break;
+			code = code*ID_RADIX + (id[i] - '!' + 1);
+		}
+		if(i == len)
+			return m_shortids[code];
+	}
+	
+	map<string, int>::const_iterator it = m_longids.find(string(id, len));
+	if(it == m_longids.end())
+		return -1;
+	return it->second;
+}
+
+/**
+	@brief Sets a signal in a packed row from a string of binary digits, MSB first.
+	
+	Leading zeroes are often left off, so bits above the ones given are zero. So are x and z.
+ */
+void VCDImporter::SetValue(uint64_t* row, int nsignal, const char* bits, int nbits) const
+{
+	const Signal& sig = m_signals[nsignal];
+	const char* lsb = bits + nbits - 1;
+	for(int base=0; base<sig.width; base+=64)
+	{
+		int n = sig.width - base;
+		if(n > 64)
+			n = 64;
+		int ndigits = nbits - base;
+		if(ndigits > n)
+			ndigits = n;
+		
+		uint64_t value = 0;
+		for(int i=0; i<ndigits; i++)
+			value |= static_cast<uint64_t>(lsb[-base - i] == '1') << i;
+		InsertBits(row, sig.lowbit + base, n, value);
+	}
+}
+
+/**
+	@brief Applies a value change. Counting rows only needs the last value of each signal, so the digits
+	aren't decoded until the rows are written.
+ */
+inline void VCDImporter::Change(VCDChunk& chunk, int nsignal, const char* bits, int nbits) const
+{
+	if(chunk.rows != NULL)
+		SetValue(&chunk.state[0], nsignal, bits, nbits);
+	else
+	{
+		chunk.lastvalue[nsignal] = bits;
+		chunk.lastlen[nsignal] = nbits;
+	}
+}
+
+/**
+	@brief Parses the value changes in one chunk.
+	
+	A row is written for every timestamp at which an imported signal changed, holding every signal's value
+	once all of the changes at that time are done. Changes before the first timestamp are at time zero.
+ */
+void VCDImporter::ParseChunk(VCDChunk& chunk) const
+{
+	uint64_t* state = &chunk.state[0];
+	uint64_t now = 0;
+	bool dirty = false;
+	int nrows = 0;
+	
+	const char* p = chunk.start;
+	const char* end = chunk.end;
+	while(p < end)
+	{
+		char c = *p;
+		if(IsSpace(c))
+		{
+			p++;
+			continue;
+		}
+		
+		const char* word = p;
+		while( (p < end) && !IsSpace(*p) )
+			p++;
+		
+		switch(c)
+		{
+			case '#':
+				if(dirty)
+				{
+					if(chunk.rows != NULL)
+					{
+						memcpy(chunk.rows + nrows*m_rowwords, state, m_rowwords * sizeof(uint64_t));
+						chunk.times[nrows] = now;
+					}
+					nrows++;
+					dirty = false;
+				}
+				now = 0;
+				for(word++; word < p; word++)
+					now = now*10 + (*word - '0');
+				chunk.lasttime = now;
+				chunk.hastime = true;
+				break;
+			
+			//Scalar: value followed directly by the identifier
+			case '0':
+			case '1':
+			case 'x':
+			case 'X':
+			case 'z':
+			case 'Z':
+				{
+					int n = LookupIdentifier(word + 1, p - word - 1);
+					if(n >= 0)
+					{
+						Change(chunk, n, word, 1);
+						dirty = true;
+					}
+				}
+				break;
+			
+			//Vector: b, the digits, then the identifier as a separate word
+			case 'b':
+			case 'B':
+			case 'r':
+			case 'R':
+				{
+					const char* bitsend = p;
+					while( (p < end) && IsSpace(*p) )
+						p++;
+					const char* id = p;
+					while( (p < end) && !IsSpace(*p) )
+						p++;
+					
+					int n = LookupIdentifier(id, p - id);
+					if( (n >= 0) && ( (c == 'b') || (c == 'B') ) )
+					{
+						Change(chunk, n, word + 1, bitsend - word - 1);
+						dirty = true;
+					}
+				}
+				break;
+			
+			//Keywords. $dumpvars and friends just hold ordinary value changes, but comments must be skipped.
+			case '$':
+				if( (p - word == 8) && (0 == memcmp(word, "$comment", 8)) )
+				{
+					while(p < end)
+					{
+						while( (p < end) && IsSpace(*p) )
+							p++;
+						const char* w = p;
+						while( (p < end) && !IsSpace(*p) )
+							p++;
+						if( (p - w == 4) && (0 == memcmp(w, "$end", 4)) )
+							break;
+					}
+				}
+				break;
+			
+			default:
+				break;
+		}
+	}
+	
+	if(dirty)
+	{
+		if(chunk.rows != NULL)
+		{
+			memcpy(chunk.rows + nrows*m_rowwords, state, m_rowwords * sizeof(uint64_t));
+			chunk.times[nrows] = now;
+		}
+		nrows++;
+	}
+	chunk.nrows = nrows;
+}
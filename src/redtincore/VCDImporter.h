@@ -0,0 +1,139 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file VCDImporter.h
+	@author Andrew D. Zonenberg
+	@brief Value change dump (VCD) import
+ */
+
+#ifndef VCDImporter_h
+#define VCDImporter_h
+
+#include "Capture.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class VCDImporter;
+
+/**
+	@brief A run of value changes starting at a timestamp, parsed by one thread
+ */
+class VCDChunk
+{
+public:
+	const VCDImporter* importer;
+	
+	const char* start;
+	const char* end;
+	
+	///Packed row of every signal's value at the start of the chunk
+	std::vector<uint64_t> state;
+	
+	///Digits of the last value each signal changed to in the chunk, NULL if it didn't change
+	std::vector<const char*> lastvalue;
+	std::vector<int> lastlen;
+	
+	///Number of rows in the chunk
+	int nrows;
+	
+	///Where to write the rows and their times, or NULL to only count them
+	uint64_t* rows;
+	uint64_t* times;
+	
+	///Last timestamp seen, even if nothing changed at it
+	uint64_t lasttime;
+	bool hastime;
+};
+
+/**
+	@brief Reads value change dumps from simulations or older captures, so they can be searched, compared and
+	exported like live captures.
+	
+	The file is memory-mapped and the value changes split into chunks at timestamps. The chunks are parsed in
+	parallel twice: once to count their rows and find the last value each one leaves on every signal, then
+	again, starting from the values left by the chunks before, to write the rows straight into place.
+	
+	Every timestamp at which a signal changes becomes a row, run-length encoded in units of the largest step
+	that every timestamp is a multiple of. Captures we exported ourselves come back at their original sample
+	rate instead, with the capture_clk signal dropped.
+ */
+class VCDImporter
+{
+public:
+	VCDImporter();
+	
+	bool Import(std::string fname, Capture& cap);
+	
+	void ParseChunk(VCDChunk& chunk) const;
+	
+protected:
+	bool ParseHeader(const char*& p, const char* end, time_t mtime);
+	void AddVariable(const std::vector<std::string>& words, const std::vector<std::string>& scopes);
+	int LookupIdentifier(const char* id, size_t len) const;
+	void SetValue(uint64_t* row, int nsignal, const char* bits, int nbits) const;
+	void Change(VCDChunk& chunk, int nsignal, const char* bits, int nbits) const;
+	
+	enum
+	{
+		///Identifiers this long or shorter are looked up in a flat table
+		SHORT_ID_LEN = 3,
+		
+		///One more than the number of printable characters, so that identifiers of any length get unique codes
+		ID_RADIX = 95
+	};
+	
+	std::vector<Signal> m_signals;
+	
+	///Signal number for each short identifier, or -1
+	std::vector<int> m_shortids;
+	
+	///Signal number for longer identifiers, or -1 for variables we don't import
+	std::map<std::string, int> m_longids;
+	
+	///Length of one VCD time unit, in seconds
+	double m_timescale;
+	
+	time_t m_timestamp;
+	
+	///True if the file was written by our own exporter, so capture_clk is ours and not a real signal
+	bool m_ourexport;
+	
+	int m_width;
+	int m_rowwords;
+};
+
+#endif
@@ -0,0 +1,391 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file WaveformViewer.cpp
+	@author Andrew D. Zonenberg
+	@brief Hands captures off to gtkwave
+ */
+
+#include "WaveformViewer.h"
+#include "VCDExporter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char* g_viewerpath = "/usr/bin/gtkwave";
+
+WaveformViewer::WaveformViewer()
+: m_mode(VIEWER_MODE_SPAWN)
+, m_linkcount(0)
+, m_viewerpid(-1)
+, m_console(-1)
+{
+	m_captures[0] = -1;
+	m_captures[1] = -1;
+}
+
+WaveformViewer::~WaveformViewer()
+{
+	CloseViewer();
+	CloseCaptures();
+	ReapChildren();
+	
+	//Viewers that are still running have opened their files by now, so the links can go
+	for(size_t i=0; i<m_children.size(); i++)
+		unlink(m_children[i].linkpath.c_str());
+	if(!m_linkpath.empty())
+		unlink(m_linkpath.c_str());
+	if(!m_linkdir.empty())
+		rmdir(m_linkdir.c_str());
+}
+
+const char* WaveformViewer::GetModeName(int mode)
+{
+	switch(mode)
+	{
+		case VIEWER_MODE_SPAWN:
+			return "spawn";
+		case VIEWER_MODE_REUSE:
+			return "reuse";
+		default:
+			return "none";
+	}
+}
+
+/**
+	@brief Converts a mode name as used in config files to a ViewerModes value
+	
+	@return The mode, or -1 if the name is unknown
+ */
+int WaveformViewer::ParseModeName(std::string name)
+{
+	if(name == "spawn")
+		return VIEWER_MODE_SPAWN;
+	else if(name == "reuse")
+		return VIEWER_MODE_REUSE;
+	else if(name == "none")
+		return VIEWER_MODE_NONE;
+	return -1;
+}
+
+void WaveformViewer::SetMode(int mode)
+{
+	//Leaving reuse mode? Let the running viewer go
+	if( (m_mode == VIEWER_MODE_REUSE) && (mode != VIEWER_MODE_REUSE) )
+	{
+		CloseViewer();
+		CloseCaptures();
+	}
+	m_mode = mode;
+}
+
+/**
+	@brief Writes a capture as VCD into a new in-memory file
+	
+	@return The file descriptor (close-on-exec), or -1 on failure
+ */
+int WaveformViewer::CreateCaptureFile(const Capture& cap)
+{
+	int fd = memfd_create("redtin-capture", MFD_CLOEXEC);
+	
+	//Kernels before 3.17 don't have memfd, so use an unlinked file on tmpfs instead
+	if(fd < 0)
+	{
+		char tmpl[] = "/dev/shm/redtin-capture-XXXXXX";
+		fd = mkostemp(tmpl, O_CLOEXEC);
+		if(fd < 0)
+		{
+			perror("couldn't create capture file");
+			return -1;
+		}
+		unlink(tmpl);
+	}
+	
+	//Let stdio own a duplicate so fclose() doesn't take our descriptor with it
+	FILE* fp = fdopen(fcntl(fd, F_DUPFD_CLOEXEC, 0), "w");
+	if(fp == NULL)
+	{
+		perror("couldn't open capture file");
+		close(fd);
+		return -1;
+	}
+	
+	VCDExporter exporter;
+	bool ok = exporter.Export(cap, fp);
+	if(0 != fclose(fp))
+		ok = false;
+	if(!ok)
+	{
+		printf("failed to write capture file\n");
+		close(fd);
+		return -1;
+	}
+	
+	return fd;
+}
+
+/**
+	@brief Creates the private tmpfs directory for viewer links, if we haven't yet
+ */
+bool WaveformViewer::MakeLinkDir()
+{
+	if(!m_linkdir.empty())
+		return true;
+		
+	char tmpl[] = "/dev/shm/redtin-XXXXXX";
+	char* dir = mkdtemp(tmpl);
+	if(dir == NULL)
+	{
+		char tmpl2[] = "/tmp/redtin-XXXXXX";
+		dir = mkdtemp(tmpl2);
+		if(dir == NULL)
+		{
+			perror("couldn't create viewer directory");
+			return false;
+		}
+	}
+	m_linkdir = dir;
+	return true;
+}
+
+/**
+	@brief Writes a capture to a new file and shows it in the viewer
+ */
+bool WaveformViewer::ShowCapture(const Capture& cap)
+{
+	ReapChildren();
+	
+	if(m_mode == VIEWER_MODE_NONE)
+		return true;
+	
+	int fd = CreateCaptureFile(cap);
+	if(fd < 0)
+		return false;
+	return ShowFile(fd);
+}
+
+/**
+	@brief Shows an already written VCD in the viewer. Takes ownership of the file descriptor.
+ */
+bool WaveformViewer::ShowFile(int fd)
+{
+	if( (m_mode == VIEWER_MODE_NONE) || !MakeLinkDir() )
+	{
+		close(fd);
+		return false;
+	}
+	
+	char target[64];
+	
+	//New viewer every time. The viewer inherits the descriptor, so the link points at its own copy.
+	if(m_mode == VIEWER_MODE_SPAWN)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "/capture-%d.vcd", m_linkcount++);
+		string linkpath = m_linkdir + name;
+		snprintf(target, sizeof(target), "/proc/self/fd/%d", fd);
+		if(0 != symlink(target, linkpath.c_str()))
+		{
+			perror("couldn't link capture file");
+			close(fd);
+			return false;
+		}
+		
+		pid_t pid = SpawnViewer(linkpath, fd, NULL);
+		close(fd);
+		if(pid < 0)
+		{
+			unlink(linkpath.c_str());
+			return false;
+		}
+		m_children.push_back(ViewerProcess(pid, linkpath));
+		return true;
+	}
+	
+	//Keep the last capture around too, the viewer might not have finished reloading it
+	if(m_captures[1] >= 0)
+		close(m_captures[1]);
+	m_captures[1] = m_captures[0];
+	m_captures[0] = fd;
+	
+	//Atomically retarget the link at the new capture
+	m_linkpath = m_linkdir + "/capture.vcd";
+	string tmppath = m_linkpath + ".new";
+	snprintf(target, sizeof(target), "/proc/%d/fd/%d", static_cast<int>(getpid()), fd);
+	unlink(tmppath.c_str());
+	if( (0 != symlink(target, tmppath.c_str())) || (0 != rename(tmppath.c_str(), m_linkpath.c_str())) )
+	{
+		perror("couldn't link capture file");
+		return false;
+	}
+	
+	//Ask the running viewer to reload
+	if(m_viewerpid > 0)
+	{
+		static const char cmd[] = "gtkwave::reLoadFile\n";
+		if(send(m_console, cmd, strlen(cmd), MSG_NOSIGNAL) == static_cast<ssize_t>(strlen(cmd)))
+			return true;
+		
+		//Console is gone, so is the viewer
+		CloseViewer();
+	}
+	
+	//Nothing running yet, start it
+	m_viewerpid = SpawnViewer(m_linkpath, -1, &m_console);
+	if(m_viewerpid < 0)
+		return false;
+	m_children.push_back(ViewerProcess(m_viewerpid, m_linkpath));
+	return true;
+}
+
+/**
+	@brief Starts the viewer
+	
+	@param path		File to open
+	@param keepfd	Descriptor the viewer should inherit, or -1
+	@param console	If not NULL, the viewer is started with a Tcl console and the socket to it is
+					returned here
+	
+	@return Process ID of the viewer, or -1 on failure
+ */
+pid_t WaveformViewer::SpawnViewer(std::string path, int keepfd, int* console)
+{
+	//Parse arguments
+	char* psargs = new char[m_args.length() + 1];
+	strcpy(psargs, m_args.c_str());
+	std::vector<const char*> args;
+	args.push_back(g_viewerpath);
+	if(console != NULL)
+		args.push_back("--wish");
+	args.push_back(path.c_str());
+	for(char* s = strtok(psargs, " "); s != NULL; s = strtok(NULL, " "))
+		args.push_back(s);
+	args.push_back(NULL);
+	
+	int sv[2] = {-1, -1};
+	if( (console != NULL) && (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) )
+	{
+		perror("couldn't create viewer console");
+		delete[] psargs;
+		return -1;
+	}
+	
+	//Spawn gtkwave
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		if(console != NULL)
+			dup2(sv[1], STDIN_FILENO);
+		if(keepfd >= 0)
+			fcntl(keepfd, F_SETFD, 0);
+		execv(g_viewerpath, (char**)&args[0]);
+		perror("child: failed to spawn gtkwave");
+		_exit(-1);
+	}
+	else if(pid == -1)
+	{
+		perror("failed to spawn gtkwave");
+		if(console != NULL)
+		{
+			close(sv[0]);
+			close(sv[1]);
+		}
+	}
+	else if(console != NULL)
+	{
+		close(sv[1]);
+		*console = sv[0];
+	}
+	
+	delete[] psargs;
+	return pid;
+}
+
+/**
+	@brief Stops talking to the viewer used in reuse mode. It keeps running until the user closes it.
+ */
+void WaveformViewer::CloseViewer()
+{
+	if(m_console >= 0)
+		close(m_console);
+	m_console = -1;
+	m_viewerpid = -1;
+}
+
+/**
+	@brief Closes the files kept open for the viewer used in reuse mode
+ */
+void WaveformViewer::CloseCaptures()
+{
+	for(int i=0; i<2; i++)
+	{
+		if(m_captures[i] >= 0)
+			close(m_captures[i]);
+		m_captures[i] = -1;
+	}
+}
+
+/**
+	@brief Cleans up after any viewers that have exited
+ */
+void WaveformViewer::ReapChildren()
+{
+	for(size_t i=0; i<m_children.size(); )
+	{
+		int status;
+		pid_t pid = waitpid(m_children[i].pid, &status, WNOHANG);
+		if( (pid == m_children[i].pid) || ( (pid < 0) && (errno == ECHILD) ) )
+		{
+			if(m_children[i].pid == m_viewerpid)
+				CloseViewer();
+			
+			//The reuse mode link is shared by every viewer and stays for the next one
+			if(m_children[i].linkpath != m_linkpath)
+				unlink(m_children[i].linkpath.c_str());
+			m_children.erase(m_children.begin() + i);
+		}
+		else
+			i++;
+	}
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file WaveformViewer.h
+	@author Andrew D. Zonenberg
+	@brief Hands captures off to gtkwave
+ */
+
+#ifndef WaveformViewer_h
+#define WaveformViewer_h
+
+#include "Capture.h"
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+/**
+	@brief Launches gtkwave on captures.
+	
+	Every capture is written to its own anonymous in-memory file (memfd) and gtkwave is pointed at it
+	through /proc, so nothing is ever written to a shared path on disk.
+	
+	In VIEWER_MODE_SPAWN a new viewer is started for each capture, like older releases did.
+	
+	In VIEWER_MODE_REUSE a single viewer is started with its Tcl console on a socket we hold. The viewer
+	opens a symlink in a private tmpfs directory; each new capture retargets the symlink at the new memfd
+	and tells the viewer to reload, which keeps the window and trace layout and skips viewer startup.
+ */
+class WaveformViewer
+{
+public:
+	enum ViewerModes
+	{
+		VIEWER_MODE_SPAWN,
+		VIEWER_MODE_REUSE,
+		VIEWER_MODE_NONE
+	};
+	
+	WaveformViewer();
+	~WaveformViewer();
+	
+	void SetMode(int mode);
+	int GetMode()
+	{ return m_mode; }
+	
+	void SetArguments(std::string args)
+	{ m_args = args; }
+	
+	bool ShowCapture(const Capture& cap);
+	bool ShowFile(int fd);
+	
+	void ReapChildren();
+	
+	static const char* GetModeName(int mode);
+	static int ParseModeName(std::string name);
+	
+protected:
+	int CreateCaptureFile(const Capture& cap);
+	bool MakeLinkDir();
+	pid_t SpawnViewer(std::string path, int keepfd, int* console);
+	void CloseViewer();
+	void CloseCaptures();
+
+	int m_mode;
+	std::string m_args;
+	
+	class ViewerProcess
+	{
+	public:
+		ViewerProcess(pid_t p, std::string l)
+		: pid(p)
+		, linkpath(l)
+		{
+		}
+		
+		pid_t pid;
+		std::string linkpath;
+	};
+	
+	///Viewers we started and have not yet reaped
+	std::vector<ViewerProcess> m_children;
+	
+	///Private tmpfs directory holding the links the viewers open
+	std::string m_linkdir;
+	int m_linkcount;
+	
+	//Reuse mode state
+	pid_t m_viewerpid;
+	int m_console;
+	std::string m_linkpath;
+	
+	///memfds for the current capture and the one before it, which the viewer may still be reading
+	int m_captures[2];
+};
+
+#endif
@@ -0,0 +1,730 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureServer.cpp
+	@author Andrew D. Zonenberg
+	@brief Implementation of CaptureServer
+ */
+
+#include "CaptureServer.h"
+#include "CaptureClient.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+///Most one-shot captures a single client may have waiting
+#define MAX_PENDING_CAPTURES 64
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CaptureRequest
+
+/**
+	@brief Parses a config sent by a client
+	
+	The trigger bitstream can't be made until the device thread knows how many channels the board has,
+	so this only checks that the config could fit the biggest board.
+	
+	@return false, with a message for the client in error, if the config is unusable
+ */
+bool CaptureRequest::Parse(string text, string& error)
+{
+	CaptureConfig config;
+	config.Parse(text);
+	
+	std::vector<unsigned char> bitstream;
+	signals = config.signals;
+	triggers = config.triggers;
+	samplerate = config.GetSampleRate();
+	rle = config.IsRunLengthEncoded();
+	segments = config.GetSegmentCount();
+	confighash = config.GetHash();
+	if( (segments < 1) || (segments > RedTinDevice::MAX_SEGMENTS) || (segments & (segments - 1)) )
+	{
+		error = "invalid segment count";
+		return false;
+	}
+	return Compile(RedTinDevice::MAX_CORES * CORE_WIDTH, bitstream, error);
+}
+
+/**
+	@brief Generates the trigger bitstream for a board with the given number of channels
+	
+	@return false, with a message for the client in error, if the config doesn't fit
+ */
+bool CaptureRequest::Compile(int width, std::vector<unsigned char>& bitstream, string& error) const
+{
+	std::vector<Signal> assigned = signals;
+	if(!AssignSignalBits(assigned, width))
+	{
+		error = "too many signals";
+		return false;
+	}
+	
+	bitstream.resize(width / CORE_WIDTH * TRIGGER_BITSTREAM_SIZE);
+	if(!CompileTriggers(assigned, triggers, width, &bitstream[0]))
+	{
+		error = "invalid trigger condition";
+		return false;
+	}
+	return true;
+}
+
+string CaptureRequest::GetKey() const
+{
+	//The config hash covers the signals and triggers
+	char key[64];
+	snprintf(key, sizeof(key), "%016llx %.6f %d %d", static_cast<unsigned long long>(confighash), samplerate, rle, segments);
+	return key;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+CaptureServer::CaptureServer(string devpath, int baud)
+: m_devpath(devpath)
+, m_baud(baud)
+, m_device(&m_uart)
+, m_listenfd(-1)
+, m_stop(0)
+, m_nextclient(0)
+, m_busy(false)
+, m_hasjob(false)
+, m_hasresult(false)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	
+	if(0 != pipe2(m_wakepipe, O_CLOEXEC | O_NONBLOCK))
+	{
+		perror("couldn't create pipe");
+		m_wakepipe[0] = m_wakepipe[1] = -1;
+	}
+}
+
+/**
+	@brief Closes the listening socket and all clients
+	
+	The device thread may still be blocked waiting for a trigger, so this should only happen on the way out.
+ */
+CaptureServer::~CaptureServer()
+{
+	while(!m_clients.empty())
+		DropClient(m_clients.begin()->first);
+	
+	if(m_listenfd >= 0)
+	{
+		close(m_listenfd);
+		unlink(m_sockpath.c_str());
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Main loop
+
+/**
+	@brief Creates the server socket
+	
+	@return false if it couldn't be created, or another server is already running there
+ */
+bool CaptureServer::Listen(string sockpath)
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(sockpath.length() >= sizeof(addr.sun_path))
+	{
+		printf("socket path %s is too long\n", sockpath.c_str());
+		return false;
+	}
+	strcpy(addr.sun_path, sockpath.c_str());
+	
+	//Don't pull the socket out from under a server that's still running
+	CaptureClient probe;
+	if(probe.Connect(sockpath))
+	{
+		printf("a server is already listening on %s\n", sockpath.c_str());
+		return false;
+	}
+	unlink(sockpath.c_str());
+	
+	m_listenfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if(m_listenfd < 0)
+	{
+		perror("couldn't create socket");
+		return false;
+	}
+	if(0 != bind(m_listenfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+	{
+		perror("couldn't bind socket");
+		close(m_listenfd);
+		m_listenfd = -1;
+		return false;
+	}
+	m_sockpath = sockpath;
+	
+	//Anyone allowed to use the analyzer (i.e. in our group) may connect
+	chmod(sockpath.c_str(), 0660);
+	
+	if(0 != listen(m_listenfd, 16))
+	{
+		perror("couldn't listen on socket");
+		return false;
+	}
+	
+	printf("Listening on %s\n", sockpath.c_str());
+	return true;
+}
+
+/**
+	@brief Serves clients until Stop() is called
+ */
+bool CaptureServer::Run()
+{
+	if( (m_listenfd < 0) || (m_wakepipe[0] < 0) )
+		return false;
+	
+	if(0 != pthread_create(&m_thread, NULL, DeviceThreadProc, this))
+	{
+		printf("couldn't start device thread\n");
+		return false;
+	}
+	pthread_detach(m_thread);
+	
+	while(!m_stop)
+	{
+		std::vector<pollfd> fds;
+		std::vector<int> ids;
+		pollfd pfd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		pfd.fd = m_listenfd;
+		fds.push_back(pfd);
+		pfd.fd = m_wakepipe[0];
+		fds.push_back(pfd);
+		for(std::map<int, ServerClient>::iterator it=m_clients.begin(); it!=m_clients.end(); it++)
+		{
+			pfd.fd = it->second.fd;
+			fds.push_back(pfd);
+			ids.push_back(it->first);
+		}
+		
+		if(poll(&fds[0], fds.size(), -1) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			perror("poll failed");
+			return false;
+		}
+		
+		//Finished captures first, so the device gets its next job as soon as possible
+		if(fds[1].revents)
+		{
+			char dummy[16];
+			while(read(m_wakepipe[0], dummy, sizeof(dummy)) > 0)
+			{}
+			OnJobDone();
+		}
+		
+		if(fds[0].revents)
+			OnAccept();
+		
+		for(size_t i=0; i<ids.size(); i++)
+		{
+			if(fds[i+2].revents && (m_clients.find(ids[i]) != m_clients.end()))
+				OnClientMessage(ids[i]);
+		}
+	}
+	
+	return true;
+}
+
+void CaptureServer::OnAccept()
+{
+	int fd = accept4(m_listenfd, NULL, NULL, SOCK_CLOEXEC);
+	if(fd < 0)
+	{
+		perror("couldn't accept connection");
+		return;
+	}
+	
+	int id = m_nextclient ++;
+	m_clients[id].fd = fd;
+	printf("client %d connected\n", id);
+}
+
+void CaptureServer::OnClientMessage(int id)
+{
+	char buf[CAPTURE_SERVER_MAX_MESSAGE + 1];
+	ssize_t len = recv(m_clients[id].fd, buf, CAPTURE_SERVER_MAX_MESSAGE, MSG_TRUNC | MSG_DONTWAIT);
+	if(len < 0)
+	{
+		if( (errno == EAGAIN) || (errno == EINTR) )
+			return;
+		DropClient(id);
+		return;
+	}
+	if(len == 0)
+	{
+		DropClient(id);
+		return;
+	}
+	if(len > CAPTURE_SERVER_MAX_MESSAGE)
+	{
+		SendReply(id, "ERROR message too large\n");
+		return;
+	}
+	buf[len] = '\0';
+	
+	string msg(buf, len);
+	size_t eol = msg.find('\n');
+	string command = msg.substr(0, eol);
+	string body = (eol == string::npos) ? "" : msg.substr(eol + 1);
+	
+	if( (command == "CAPTURE") || (command == "SUBSCRIBE") )
+	{
+		CaptureRequest request;
+		string error;
+		if(!request.Parse(body, error))
+		{
+			SendReply(id, "ERROR " + error + "\n");
+			return;
+		}
+		
+		ServerClient& client = m_clients[id];
+		if(command == "CAPTURE")
+		{
+			if(client.pending.size() >= MAX_PENDING_CAPTURES)
+			{
+				SendReply(id, "ERROR too many captures queued\n");
+				return;
+			}
+			client.pending.push_back(request);
+		}
+		else
+		{
+			Unsubscribe(id);
+			string key = request.GetKey();
+			CaptureStream& stream = m_streams[key];
+			stream.request = request;
+			stream.subscribers.insert(id);
+			client.stream = key;
+		}
+	}
+	else if(command == "UNSUBSCRIBE")
+		Unsubscribe(id);
+	else
+	{
+		SendReply(id, "ERROR unrecognized command\n");
+		return;
+	}
+	
+	Schedule();
+}
+
+void CaptureServer::Unsubscribe(int id)
+{
+	std::map<int, ServerClient>::iterator cit = m_clients.find(id);
+	if(cit == m_clients.end())
+		return;
+	ServerClient& client = cit->second;
+	if(client.stream.empty())
+		return;
+	
+	std::map<string, CaptureStream>::iterator it = m_streams.find(client.stream);
+	if(it != m_streams.end())
+	{
+		it->second.subscribers.erase(id);
+		if(it->second.subscribers.empty())
+			m_streams.erase(it);
+	}
+	client.stream = "";
+}
+
+void CaptureServer::DropClient(int id)
+{
+	std::map<int, ServerClient>::iterator it = m_clients.find(id);
+	if(it == m_clients.end())
+		return;
+	Unsubscribe(id);
+	close(it->second.fd);
+	m_clients.erase(it);
+	printf("client %d disconnected\n", id);
+}
+
+/**
+	@brief Sends a reply, plus optionally a result file descriptor
+	
+	Clients that don't keep up with their results are disconnected rather than holding up everyone else.
+	
+	@return false if the client is gone, or was dropped because the send failed
+ */
+bool CaptureServer::SendReply(int id, string text, int fd)
+{
+	std::map<int, ServerClient>::iterator it = m_clients.find(id);
+	if(it == m_clients.end())
+		return false;
+	
+	iovec iov;
+	iov.iov_base = const_cast<char*>(text.c_str());
+	iov.iov_len = text.length();
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	
+	char control[CMSG_SPACE(sizeof(int))];
+	if(fd >= 0)
+	{
+		memset(control, 0, sizeof(control));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+	}
+	
+	if(static_cast<ssize_t>(text.length()) != sendmsg(it->second.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT))
+	{
+		if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+			printf("client %d is not reading its results\n", id);
+		DropClient(id);
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scheduling
+
+/**
+	@brief Hands the next job to the device thread, if it's idle
+ */
+void CaptureServer::Schedule()
+{
+	if(m_busy)
+		return;
+	
+	//Everyone who wants the device. Clients are "c<id>", streams "s<key>".
+	std::set<string> sources;
+	for(std::map<int, ServerClient>::iterator it=m_clients.begin(); it!=m_clients.end(); it++)
+	{
+		if(!it->second.pending.empty())
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "c%08d", it->first);
+			sources.insert(name);
+		}
+	}
+	for(std::map<string, CaptureStream>::iterator it=m_streams.begin(); it!=m_streams.end(); it++)
+		sources.insert("s" + it->first);
+	if(sources.empty())
+		return;
+	
+	//Next one after whoever went last
+	std::set<string>::iterator next = sources.upper_bound(m_lastsource);
+	if(next == sources.end())
+		next = sources.begin();
+	m_lastsource = *next;
+	
+	CaptureJob job;
+	if((*next)[0] == 'c')
+	{
+		job.client = atoi(next->c_str() + 1);
+		ServerClient& client = m_clients[job.client];
+		job.request = client.pending.front();
+		client.pending.pop_front();
+	}
+	else
+	{
+		job.client = -1;
+		job.request = m_streams[next->substr(1)].request;
+	}
+	
+	pthread_mutex_lock(&m_mutex);
+	m_job = job;
+	m_hasjob = true;
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+	m_busy = true;
+}
+
+/**
+	@brief Sends a finished capture to everyone who's waiting for it
+ */
+void CaptureServer::OnJobDone()
+{
+	pthread_mutex_lock(&m_mutex);
+	if(!m_hasresult)
+	{
+		pthread_mutex_unlock(&m_mutex);
+		return;
+	}
+	JobResult result = m_result;
+	m_hasresult = false;
+	pthread_mutex_unlock(&m_mutex);
+	
+	//Get the device going again before dealing with the result
+	m_busy = false;
+	Schedule();
+	
+	//One result per segment
+	std::vector<string> replies;
+	if(result.ok)
+	{
+		for(size_t i=0; i<result.fds.size(); i++)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "RESULT %d %d %.6f %lld %016llx %d %llu %d\n",
+				result.width,
+				result.depth,
+				result.job.request.samplerate,
+				static_cast<long long>(result.timestamp),
+				static_cast<unsigned long long>(result.job.request.confighash),
+				result.rle ? 1 : 0,
+				static_cast<unsigned long long>(result.triggerclocks[i]),
+				result.triggerrows[i]);
+			replies.push_back(line);
+		}
+	}
+	else
+		replies.push_back("ERROR " + result.error + "\n");
+	
+	//Work out who gets it
+	std::vector<int> recipients;
+	if(result.job.client >= 0)
+	{
+		if(m_clients.find(result.job.client) != m_clients.end())
+			recipients.push_back(result.job.client);
+	}
+	else
+	{
+		std::map<string, CaptureStream>::iterator it = m_streams.find(result.job.request.GetKey());
+		if(it != m_streams.end())
+			recipients.insert(recipients.end(), it->second.subscribers.begin(), it->second.subscribers.end());
+	}
+	
+	//Everyone shares the same result files. A client dropped partway through a segmented capture gets no more.
+	for(size_t i=0; i<recipients.size(); i++)
+	{
+		for(size_t j=0; j<replies.size(); j++)
+		{
+			if(!SendReply(recipients[i], replies[j], result.ok ? result.fds[j] : -1))
+				break;
+		}
+	}
+	for(size_t i=0; i<result.fds.size(); i++)
+		close(result.fds[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Device thread
+
+void* CaptureServer::DeviceThreadProc(void* arg)
+{
+	reinterpret_cast<CaptureServer*>(arg)->DeviceThread();
+	return NULL;
+}
+
+void CaptureServer::DeviceThread()
+{
+	while(true)
+	{
+		pthread_mutex_lock(&m_mutex);
+		while(!m_hasjob)
+			pthread_cond_wait(&m_cond, &m_mutex);
+		CaptureJob job = m_job;
+		m_hasjob = false;
+		pthread_mutex_unlock(&m_mutex);
+		
+		JobResult result;
+		RunJob(job, result);
+		
+		pthread_mutex_lock(&m_mutex);
+		m_result = result;
+		m_hasresult = true;
+		pthread_mutex_unlock(&m_mutex);
+		
+		if(1 != write(m_wakepipe[1], "", 1))
+			perror("couldn't wake main thread");
+	}
+}
+
+void CaptureServer::RunJob(const CaptureJob& job, JobResult& result)
+{
+	result.job = job;
+	result.ok = false;
+	result.fds.clear();
+	result.triggerclocks.clear();
+	result.triggerrows.clear();
+	result.width = 0;
+	result.depth = 0;
+	result.rle = false;
+	result.timestamp = 0;
+	
+	//(Re)open the device if we don't have it yet or lost it.
+	//Failures are slowed down so a stream doesn't spin on a missing device.
+	if(!m_uart.IsOpen() && !m_uart.Open(m_devpath, m_baud))
+	{
+		m_device.Invalidate();
+		result.error = "couldn't open " + m_devpath;
+		sleep(1);
+		return;
+	}
+	
+	//The bitstream depends on how many cores the board has
+	if(!m_device.Identify())
+	{
+		m_uart.Close();
+		m_device.Invalidate();
+		result.error = "couldn't identify board";
+		sleep(1);
+		return;
+	}
+	std::vector<unsigned char> bitstream;
+	if(!job.request.Compile(m_device.GetWidth(), bitstream, result.error))
+		return;
+	
+	std::vector<Capture> caps;
+	m_device.SetRunLengthEncoding(job.request.rle);
+	m_device.SetSegmentCount(job.request.segments);
+	if(!m_device.RunCapture(&bitstream[0], caps))
+	{
+		m_uart.Close();
+		m_device.Invalidate();
+		result.error = "capture failed";
+		sleep(1);
+		return;
+	}
+	result.timestamp = time(NULL);
+	
+	for(size_t i=0; i<caps.size(); i++)
+	{
+		int fd = CreateResultFile(caps[i]);
+		if(fd < 0)
+		{
+			for(size_t j=0; j<result.fds.size(); j++)
+				close(result.fds[j]);
+			result.fds.clear();
+			result.error = "couldn't create result file";
+			return;
+		}
+		result.fds.push_back(fd);
+		result.triggerclocks.push_back(caps[i].GetTriggerClock());
+		result.triggerrows.push_back(caps[i].GetTriggerRow());
+	}
+	result.width = caps[0].GetWidth();
+	result.depth = caps[0].GetDepth();
+	result.rle = caps[0].IsRunLengthEncoded();
+	result.ok = true;
+}
+
+/**
+	@brief Writes the sample rows to an in-memory file that can be passed to clients and mapped
+	
+	The file is sealed (or, without memfd, reopened read-only) so no client can change what the others see.
+	
+	@return The file descriptor, or -1 on failure
+ */
+int CaptureServer::CreateResultFile(const Capture& cap)
+{
+	//Rows, then the run lengths if there are any
+	string buf(reinterpret_cast<const char*>(cap.GetRow(0)),
+		static_cast<size_t>(cap.GetDepth()) * cap.GetRowWords() * sizeof(uint64_t));
+	if(cap.IsRunLengthEncoded())
+	{
+		vector<uint32_t> runs(cap.GetDepth());
+		for(int i=0; i<cap.GetDepth(); i++)
+			runs[i] = cap.GetRunLength(i);
+		buf.append(reinterpret_cast<const char*>(&runs[0]), runs.size() * sizeof(uint32_t));
+	}
+	const char* data = buf.c_str();
+	size_t len = buf.length();
+	
+	int fd = memfd_create("redtin-result", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	string path;
+	if(fd < 0)
+	{
+		char tmpl[] = "/dev/shm/redtin-result-XXXXXX";
+		fd = mkostemp(tmpl, O_CLOEXEC);
+		if(fd < 0)
+		{
+			perror("couldn't create result file");
+			return -1;
+		}
+		path = tmpl;
+	}
+	
+	size_t done = 0;
+	while(done < len)
+	{
+		ssize_t x = write(fd, data + done, len - done);
+		if(x <= 0)
+		{
+			perror("couldn't write result file");
+			close(fd);
+			if(!path.empty())
+				unlink(path.c_str());
+			return -1;
+		}
+		done += x;
+	}
+	
+	if(path.empty())
+	{
+		if(0 != fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL))
+			perror("couldn't seal result file");
+		return fd;
+	}
+	
+	int rofd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(rofd < 0)
+		perror("couldn't reopen result file");
+	unlink(path.c_str());
+	close(fd);
+	return rofd;
+}
@@ -0,0 +1,206 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file CaptureServer.h
+	@author Andrew D. Zonenberg
+	@brief Capture server that shares one analyzer among many clients
+ */
+
+#ifndef CaptureServer_h
+#define CaptureServer_h
+
+#include "CaptureConfig.h"
+#include "RedTinDevice.h"
+#include "UARTTransport.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
+#include <pthread.h>
+
+/**
+	@brief Everything the analyzer needs to know to do a capture, compiled from a client's config
+ */
+class CaptureRequest
+{
+public:
+	bool Parse(std::string text, std::string& error);
+	bool Compile(int width, std::vector<unsigned char>& bitstream, std::string& error) const;
+	
+	///Requests with the same key produce the same capture
+	std::string GetKey() const;
+	
+	std::vector<Signal> signals;
+	std::vector<Trigger> triggers;
+	float samplerate;
+	bool rle;
+	int segments;
+	uint64_t confighash;
+};
+
+/**
+	@brief One capture handed to the device thread
+ */
+class CaptureJob
+{
+public:
+	CaptureRequest request;
+	
+	///Client that asked for it, or -1 if it's for a stream
+	int client;
+};
+
+/**
+	@brief What the device thread hands back for a job
+ */
+class JobResult
+{
+public:
+	CaptureJob job;
+	
+	bool ok;
+	std::string error;
+	
+	///Result files holding the sample rows and run lengths of each segment, if ok
+	std::vector<int> fds;
+	
+	///Capture clock at which each segment triggered
+	std::vector<uint64_t> triggerclocks;
+	
+	///Row each segment triggered on
+	std::vector<int> triggerrows;
+	
+	int width;
+	int depth;
+	bool rle;
+	time_t timestamp;
+};
+
+class ServerClient
+{
+public:
+	int fd;
+	
+	///One-shot captures waiting for the device
+	std::deque<CaptureRequest> pending;
+	
+	///Key of the stream this client is subscribed to, or empty
+	std::string stream;
+};
+
+/**
+	@brief A capture configuration being re-armed for as long as anybody is subscribed to it
+ */
+class CaptureStream
+{
+public:
+	CaptureRequest request;
+	std::set<int> subscribers;
+};
+
+/**
+	@brief The server. See CaptureClient for the protocol.
+	
+	The main thread handles the sockets and all scheduling state. A second thread owns the device and runs
+	one job at a time, handing the result back through a pipe so the main loop wakes up for it.
+	
+	Scheduling is round-robin over "sources": each client with one-shot captures queued is one source, and
+	each stream with at least one subscriber is another, so a client streaming captures can't starve anybody
+	else and a client queueing many captures gets them one turn at a time. The next job is handed over the
+	moment the last one finishes, before its result is sent out.
+ */
+class CaptureServer
+{
+public:
+	CaptureServer(std::string devpath, int baud);
+	~CaptureServer();
+	
+	bool Listen(std::string sockpath);
+	bool Run();
+	
+	///Makes Run() return, safe to call from a signal handler
+	void Stop()
+	{ m_stop = 1; }
+	
+	static void* DeviceThreadProc(void* arg);
+	
+protected:
+	void DeviceThread();
+	void RunJob(const CaptureJob& job, JobResult& result);
+	int CreateResultFile(const Capture& cap);
+
+	void OnAccept();
+	void OnClientMessage(int id);
+	void OnJobDone();
+	void DropClient(int id);
+	void Unsubscribe(int id);
+	
+	void Schedule();
+	bool SendReply(int id, std::string text, int fd = -1);
+	
+	std::string m_devpath;
+	int m_baud;
+	UARTTransport m_uart;
+	RedTinDevice m_device;
+	
+	int m_listenfd;
+	std::string m_sockpath;
+	volatile int m_stop;
+	
+	std::map<int, ServerClient> m_clients;
+	int m_nextclient;
+	
+	std::map<std::string, CaptureStream> m_streams;
+	
+	///Source that got the device last, for round-robin
+	std::string m_lastsource;
+	
+	///True while the device thread has a job (main thread only)
+	bool m_busy;
+	
+	//Handoff to and from the device thread
+	pthread_t m_thread;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	bool m_hasjob;
+	CaptureJob m_job;
+	bool m_hasresult;
+	JobResult m_result;
+	int m_wakepipe[2];
+};
+
+#endif
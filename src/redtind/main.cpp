@@ -0,0 +1,103 @@
+/******************************************************************************
+*                                                                             *
+* RED TIN logic analyzer v0.1                                                 *
+*                                                                             *
+* Copyright (c) 2012 Andrew D. Zonenberg                                      *
+* All rights reserved.                                                        *
+*                                                                             *
+* Redistribution and use in source and binary forms, with or without modifi-  *
+* cation, are permitted provided that the following conditions are met:       *
+*                                                                             *
+*    * Redistributions of source code must retain the above copyright notice  *
+*      this list of conditions and the following disclaimer.                  *
+*                                                                             *
+*    * Redistributions in binary form must reproduce the above copyright      *
+*      notice, this list of conditions and the following disclaimer in the    *
+*      documentation and/or other materials provided with the distribution.   *
+*                                                                             *
+*    * Neither the name of the author nor the names of any contributors may be*
+*      used to endorse or promote products derived from this software without *
+*      specific prior written permission.                                     *
+*                                                                             *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF        *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN     *
+* NO EVENT SHALL THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT,         *
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT    *
+* NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,   *
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY       *
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT         *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF    *
+* THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+*                                                                             *
+******************************************************************************/
+
+/**
+	@file main.cpp
+	@author Andrew D. Zonenberg
+	@brief Capture server daemon: owns the analyzer and runs captures for any number of local clients
+ */
+
+#include "CaptureClient.h"
+#include "CaptureServer.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace std;
+
+int ShowUsage();
+void OnSignal(int sig);
+
+CaptureServer* g_server = NULL;
+
+int main(int argc, char* argv[])
+{
+	string devpath = UARTTransport::GetDefaultPath();
+	string sockpath = CaptureClient::GetDefaultPath();
+	int baud = 115200;
+	for(int i=1; i<argc; i++)
+	{
+		string s = argv[i];
+		if( (s == "--device") && (i+1 < argc) )
+			devpath = argv[++i];
+		else if( (s == "--baud") && (i+1 < argc) )
+			baud = atoi(argv[++i]);
+		else if( (s == "--socket") && (i+1 < argc) )
+			sockpath = argv[++i];
+		else
+			return ShowUsage();
+	}
+	
+	//Log lines should show up as they happen even when redirected
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	
+	CaptureServer server(devpath, baud);
+	if(!server.Listen(sockpath))
+		return 1;
+	
+	g_server = &server;
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+	signal(SIGPIPE, SIG_IGN);
+	
+	return server.Run() ? 0 : 1;
+}
+
+void OnSignal(int /*sig*/)
+{
+	if(g_server != NULL)
+		g_server->Stop();
+}
+
+int ShowUsage()
+{
+	printf(
+		"Usage: redtind [--device /dev/ttyUSB0] [--baud 115200] [--socket path]\n"
+		"\n"
+		"The socket defaults to $REDTIND_SOCKET, or /tmp/redtind.sock if that's not set.\n"
+		);
+	return 1;
+}